@@ -26,6 +26,7 @@
 #include <Limelight.h>
 
 #include <sys/stat.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -43,22 +44,23 @@
 #define UNIQUE_FILE_NAME "uniqueid.dat"
 #define P12_FILE_NAME "client.p12"
 
-#define UNIQUEID_BYTES 8
-#define UNIQUEID_CHARS (UNIQUEID_BYTES*2)
-
 #define CHANNEL_COUNT_STEREO 2
 #define CHANNEL_COUNT_51_SURROUND 6
 
 #define CHANNEL_MASK_STEREO 0x3
 #define CHANNEL_MASK_51_SURROUND 0xFC
 
-static char unique_id[UNIQUEID_CHARS+1];
-static X509 *cert;
-static char cert_hex[4096];
-static EVP_PKEY *privateKey;
-
+// only set by discovery, everything else reports through its context
 const char* gs_error;
 
+// the context behind gs_init, rebuilt when it is asked for another key
+// directory or log level
+static pthread_mutex_t default_context_lock = PTHREAD_MUTEX_INITIALIZER;
+static GS_CONTEXT default_context;
+static bool default_context_ready;
+static char default_key_dir[4096];
+static int default_log_level;
+
 #ifdef __vita__
 #include "../src/graphics.h"
 #endif
@@ -92,7 +94,7 @@ static int mkdirtree(const char* directory) {
   return 0;
 }
 
-static int load_unique_id(const char* keyDirectory) {
+static int load_unique_id(PGS_CONTEXT ctx, const char* keyDirectory) {
   char uniqueFilePath[4096];
   sprintf(uniqueFilePath, "%s/%s", keyDirectory, UNIQUE_FILE_NAME);
 
@@ -101,23 +103,25 @@ static int load_unique_id(const char* keyDirectory) {
     unsigned char unique_data[UNIQUEID_BYTES];
     RAND_bytes(unique_data, UNIQUEID_BYTES);
     for (int i = 0; i < UNIQUEID_BYTES; i++) {
-      sprintf(unique_id + (i * 2), "%02x", unique_data[i]);
+      sprintf(ctx->unique_id + (i * 2), "%02x", unique_data[i]);
     }
     fd = fopen(uniqueFilePath, "w");
-    if (fd == NULL)
+    if (fd == NULL) {
+      ctx->error = "Can't save unique id";
       return GS_FAILED;
+    }
 
-    fwrite(unique_id, UNIQUEID_CHARS, 1, fd);
+    fwrite(ctx->unique_id, UNIQUEID_CHARS, 1, fd);
   } else {
-    fread(unique_id, UNIQUEID_CHARS, 1, fd);
+    fread(ctx->unique_id, UNIQUEID_CHARS, 1, fd);
   }
   fclose(fd);
-  unique_id[UNIQUEID_CHARS] = 0;
+  ctx->unique_id[UNIQUEID_CHARS] = 0;
 
   return GS_OK;
 }
 
-static int load_cert(const char* keyDirectory) {
+static int load_cert(PGS_CONTEXT ctx, const char* keyDirectory) {
   char certificateFilePath[4096];
   sprintf(certificateFilePath, "%s/%s", keyDirectory, CERTIFICATE_FILE_NAME);
 
@@ -128,24 +132,25 @@ static int load_cert(const char* keyDirectory) {
   if (fd == NULL) {
     printf("Generating certificate...");
     printf(" this is only done once and can take a long time on Vita, allow up to 5 minutes... ");
-    CERT_KEY_PAIR cert = mkcert_generate();
+    CERT_KEY_PAIR pair = mkcert_generate();
     printf("done\n");
 
     char p12FilePath[4096];
     sprintf(p12FilePath, "%s/%s", keyDirectory, P12_FILE_NAME);
 
-    mkcert_save(certificateFilePath, p12FilePath, keyFilePath, cert);
-    mkcert_free(cert);
+    mkcert_save(certificateFilePath, p12FilePath, keyFilePath, pair);
+    mkcert_free(pair);
     fd = fopen(certificateFilePath, "r");
   }
 
   if (fd == NULL) {
-    gs_error = "Can't open certificate file";
+    ctx->error = "Can't open certificate file";
     return GS_FAILED;
   }
 
-  if (!(cert = PEM_read_X509(fd, NULL, NULL, NULL))) {
-    gs_error = "Error loading cert into memory";
+  if (!(ctx->cert = PEM_read_X509(fd, NULL, NULL, NULL))) {
+    fclose(fd);
+    ctx->error = "Error loading cert into memory";
     return GS_FAILED;
   }
 
@@ -154,27 +159,27 @@ static int load_cert(const char* keyDirectory) {
   int c;
   int length = 0;
   while ((c = fgetc(fd)) != EOF) {
-    sprintf(cert_hex + length, "%02x", c);
+    sprintf(ctx->cert_hex + length, "%02x", c);
     length += 2;
   }
-  cert_hex[length] = 0;
+  ctx->cert_hex[length] = 0;
 
   fclose(fd);
 
   fd = fopen(keyFilePath, "r");
   if (fd == NULL) {
-    gs_error = "Error loading key into memory";
+    ctx->error = "Error loading key into memory";
     return GS_FAILED;
   }
 
-  PEM_read_PrivateKey(fd, &privateKey, NULL, NULL);
+  PEM_read_PrivateKey(fd, &ctx->privateKey, NULL, NULL);
   fclose(fd);
 
   return GS_OK;
 }
 
 static int load_server_status(PSERVER_DATA server) {
-
+  PGS_CONTEXT ctx = server->context;
   uuid_t uuid;
   char uuid_str[37];
 
@@ -184,11 +189,6 @@ static int load_server_status(PSERVER_DATA server) {
 
   i = 0;
   do {
-    char *pairedText = NULL;
-    char *currentGameText = NULL;
-    char *stateText = NULL;
-    char *serverCodecModeSupportText = NULL;
-
     ret = GS_INVALID;
 
     uuid_generate_random(uuid);
@@ -199,90 +199,54 @@ static int load_server_status(PSERVER_DATA server) {
     // make another request over HTTP if the HTTPS request fails. We can't just use HTTP
     // for everything because it doesn't accurately tell us if we're paired.
     sprintf(url, "%s://%s:%d/serverinfo?uniqueid=%s&uuid=%s",
-      i == 0 ? "https" : "http", server->serverInfo.address, i == 0 ? 47984 : 47989, unique_id, uuid_str);
+      i == 0 ? "https" : "http", server->serverInfo.address, i == 0 ? 47984 : 47989, ctx->unique_id, uuid_str);
 
-    PHTTP_DATA data = http_create_data();
-    if (data == NULL) {
+    PSERVERINFO info = &server->info;
+    PXML_STREAM stream = xml_serverinfo_stream(info, &ctx->error, ctx->message);
+    if (stream == NULL) {
       ret = GS_OUT_OF_MEMORY;
-      goto cleanup;
-    }
-    if (http_request(url, data) != GS_OK) {
-      ret = GS_IO_ERROR;
-      goto cleanup;
+      goto next;
     }
 
-    if (xml_status(data->memory, data->size) == GS_ERROR) {
-      ret = GS_ERROR;
-      goto cleanup;
-    }
-
-    if (xml_search(data->memory, data->size, "currentgame", &currentGameText) != GS_OK) {
-      goto cleanup;
-    }
-
-    if (xml_search(data->memory, data->size, "PairStatus", &pairedText) != GS_OK)
-      goto cleanup;
-
-    if (xml_search(data->memory, data->size, "appversion", (char**) &server->serverInfo.serverInfoAppVersion) != GS_OK)
-      goto cleanup;
-
-    if (xml_search(data->memory, data->size, "state", &stateText) != GS_OK)
-      goto cleanup;
-
-    if (xml_search(data->memory, data->size, "ServerCodecModeSupport", &serverCodecModeSupportText) != GS_OK)
-      goto cleanup;
-
-    if (xml_search(data->memory, data->size, "gputype", &server->gpuType) != GS_OK)
-      goto cleanup;
-
-    if (xml_search(data->memory, data->size, "GsVersion", &server->gsVersion) != GS_OK)
-      goto cleanup;
-
-    if (xml_search(data->memory, data->size, "GfeVersion", (char**) &server->serverInfo.serverInfoGfeVersion) != GS_OK)
-      goto cleanup;
-
-    if (xml_modelist(data->memory, data->size, &server->modes) != GS_OK)
-      goto cleanup;
-
-    // These fields are present on all version of GFE that this client supports
-    if (!strlen(currentGameText) || !strlen(pairedText) || !strlen(server->serverInfo.serverInfoAppVersion) || !strlen(stateText))
-      goto cleanup;
-
-    server->paired = pairedText != NULL && strcmp(pairedText, "1") == 0;
-    server->currentGame = currentGameText == NULL ? 0 : atoi(currentGameText);
-    server->supports4K = serverCodecModeSupportText != NULL;
-    server->serverMajorVersion = atoi(server->serverInfo.serverInfoAppVersion);
-
-    if (strstr(stateText, "_SERVER_BUSY") == NULL) {
+    // a failed request keeps its own error, the document is only
+    // finished once it arrived in full
+    int request = http_request_stream(ctx->http, url, xml_stream_write, stream);
+    if (request == GS_OK)
+      ret = xml_stream_end(stream);
+    else
+      ret = request == GS_INVALID ? GS_INVALID : GS_IO_ERROR;
+
+    xml_stream_free(stream);
+    if (ret != GS_OK)
+      goto next;
+
+    server->serverInfo.serverInfoAppVersion = info->appVersion;
+    server->serverInfo.serverInfoGfeVersion = info->gfeVersion;
+    server->gpuType = info->gpuType;
+    server->gsVersion = info->gsVersion;
+    server->modes = info->modes;
+    server->paired = info->paired;
+    server->currentGame = info->currentGame;
+    server->supports4K = info->codecModeSupport;
+    server->serverMajorVersion = atoi(info->appVersion);
+
+    if (strstr(info->state, "_SERVER_BUSY") == NULL) {
       // After GFE 2.8, current game remains set even after streaming
       // has ended. We emulate the old behavior by forcing it to zero
       // if streaming is not active.
       server->currentGame = 0;
     }
-    ret = GS_OK;
-
-    cleanup:
-    if (data != NULL)
-      http_free_data(data);
-
-    if (pairedText != NULL)
-      free(pairedText);
-
-    if (currentGameText != NULL)
-      free(currentGameText);
-
-    if (serverCodecModeSupportText != NULL)
-      free(serverCodecModeSupportText);
 
+    next:
     i++;
   } while (ret != GS_OK && i < 2);
 
   if (ret == GS_OK && !server->unsupported) {
     if (server->serverMajorVersion > MAX_SUPPORTED_GFE_VERSION) {
-      gs_error = "Ensure you're running the latest version of Moonlight Embedded or downgrade GeForce Experience and try again";
+      ctx->error = "Ensure you're running the latest version of Moonlight Embedded or downgrade GeForce Experience and try again";
       ret = GS_UNSUPPORTED_VERSION;
     } else if (server->serverMajorVersion < MIN_SUPPORTED_GFE_VERSION) {
-      gs_error = "Moonlight Embedded requires a newer version of GeForce Experience. Please upgrade GFE on your PC and try again.";
+      ctx->error = "Moonlight Embedded requires a newer version of GeForce Experience. Please upgrade GFE on your PC and try again.";
       ret = GS_UNSUPPORTED_VERSION;
     }
   }
@@ -377,6 +341,7 @@ static bool verifySignature(const char *data, int dataLength, char *signature, i
 }
 
 int gs_unpair(PSERVER_DATA server) {
+  PGS_CONTEXT ctx = server->context;
   int ret = GS_OK;
   char url[4096];
   uuid_t uuid;
@@ -387,14 +352,15 @@ int gs_unpair(PSERVER_DATA server) {
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "http://%s:47989/unpair?uniqueid=%s&uuid=%s", server->serverInfo.address, unique_id, uuid_str);
-  ret = http_request(url, data);
+  sprintf(url, "http://%s:47989/unpair?uniqueid=%s&uuid=%s", server->serverInfo.address, ctx->unique_id, uuid_str);
+  ret = http_request(ctx->http, url, data);
 
   http_free_data(data);
   return ret;
 }
 
 int gs_pair(PSERVER_DATA server, char* pin) {
+  PGS_CONTEXT ctx = server->context;
   int ret = GS_OK;
   char* result = NULL;
   char url[4096];
@@ -402,12 +368,12 @@ int gs_pair(PSERVER_DATA server, char* pin) {
   char uuid_str[37];
 
   if (server->paired) {
-    gs_error = "Already paired";
+    ctx->error = "Already paired";
     return GS_WRONG_STATE;
   }
 
   if (server->currentGame != 0) {
-    gs_error = "The computer is currently in a game. You must close the game before pairing";
+    ctx->error = "The computer is currently in a game. You must close the game before pairing";
     return GS_WRONG_STATE;
   }
 
@@ -418,31 +384,31 @@ int gs_pair(PSERVER_DATA server, char* pin) {
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&phrase=getservercert&salt=%s&clientcert=%s", server->serverInfo.address, unique_id, uuid_str, salt_hex, cert_hex);
+  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&phrase=getservercert&salt=%s&clientcert=%s", server->serverInfo.address, ctx->unique_id, uuid_str, salt_hex, ctx->cert_hex);
   PHTTP_DATA data = http_create_data();
   if (data == NULL)
     return GS_OUT_OF_MEMORY;
-  else if ((ret = http_request(url, data)) != GS_OK)
+  else if ((ret = http_request(ctx->http, url, data)) != GS_OK)
     goto cleanup;
 
-  if ((ret = xml_status(data->memory, data->size) != GS_OK))
+  if ((ret = xml_status(data->memory, data->size, &ctx->error, ctx->message) != GS_OK))
     goto cleanup;
-  else if ((ret = xml_search(data->memory, data->size, "paired", &result)) != GS_OK)
+  else if ((ret = xml_search(data->memory, data->size, "paired", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (strcmp(result, "1") != 0) {
-    gs_error = "Pairing failed";
+    ctx->error = "Pairing failed";
     ret = GS_FAILED;
     goto cleanup;
   }
 
   free(result);
   result = NULL;
-  if ((ret = xml_search(data->memory, data->size, "plaincert", &result)) != GS_OK)
+  if ((ret = xml_search(data->memory, data->size, "plaincert", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (strlen(result)/2 > 8191) {
-    gs_error = "Server certificate too big";
+    ctx->error = "Server certificate too big";
     ret = GS_FAILED;
     goto cleanup;
   }
@@ -478,26 +444,26 @@ int gs_pair(PSERVER_DATA server, char* pin) {
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&clientchallenge=%s", server->serverInfo.address, unique_id, uuid_str, challenge_hex);
-  if ((ret = http_request(url, data)) != GS_OK)
+  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&clientchallenge=%s", server->serverInfo.address, ctx->unique_id, uuid_str, challenge_hex);
+  if ((ret = http_request(ctx->http, url, data)) != GS_OK)
     goto cleanup;
 
   free(result);
   result = NULL;
-  if ((ret = xml_status(data->memory, data->size) != GS_OK))
+  if ((ret = xml_status(data->memory, data->size, &ctx->error, ctx->message) != GS_OK))
     goto cleanup;
-  else if ((ret = xml_search(data->memory, data->size, "paired", &result)) != GS_OK)
+  else if ((ret = xml_search(data->memory, data->size, "paired", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (strcmp(result, "1") != 0) {
-    gs_error = "Pairing failed";
+    ctx->error = "Pairing failed";
     ret = GS_FAILED;
     goto cleanup;
   }
 
   free(result);
   result = NULL;
-  if (xml_search(data->memory, data->size, "challengeresponse", &result) != GS_OK) {
+  if (xml_search(data->memory, data->size, "challengeresponse", &result, &ctx->error) != GS_OK) {
     ret = GS_INVALID;
     goto cleanup;
   }
@@ -520,7 +486,13 @@ int gs_pair(PSERVER_DATA server, char* pin) {
   char challenge_response_hash_enc[32];
   char challenge_response_hex[65];
   memcpy(challenge_response, challenge_response_data + hash_length, 16);
-  memcpy(challenge_response + 16, cert->signature->data, 256);
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  const ASN1_BIT_STRING *cert_signature;
+  X509_get0_signature(&cert_signature, NULL, ctx->cert);
+  memcpy(challenge_response + 16, ASN1_STRING_get0_data(cert_signature), 256);
+#else
+  memcpy(challenge_response + 16, ctx->cert->signature->data, 256);
+#endif
   memcpy(challenge_response + 16 + 256, client_secret_data, 16);
   if (server->serverMajorVersion >= 7)
     SHA256(challenge_response, 16 + 256 + 16, challenge_response_hash);
@@ -534,26 +506,26 @@ int gs_pair(PSERVER_DATA server, char* pin) {
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&serverchallengeresp=%s", server->serverInfo.address, unique_id, uuid_str, challenge_response_hex);
-  if ((ret = http_request(url, data)) != GS_OK)
+  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&serverchallengeresp=%s", server->serverInfo.address, ctx->unique_id, uuid_str, challenge_response_hex);
+  if ((ret = http_request(ctx->http, url, data)) != GS_OK)
     goto cleanup;
 
   free(result);
   result = NULL;
-  if ((ret = xml_status(data->memory, data->size) != GS_OK))
+  if ((ret = xml_status(data->memory, data->size, &ctx->error, ctx->message) != GS_OK))
     goto cleanup;
-  else if ((ret = xml_search(data->memory, data->size, "paired", &result)) != GS_OK)
+  else if ((ret = xml_search(data->memory, data->size, "paired", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (strcmp(result, "1") != 0) {
-    gs_error = "Pairing failed";
+    ctx->error = "Pairing failed";
     ret = GS_FAILED;
     goto cleanup;
   }
 
   free(result);
   result = NULL;
-  if (xml_search(data->memory, data->size, "pairingsecret", &result) != GS_OK) {
+  if (xml_search(data->memory, data->size, "pairingsecret", &result, &ctx->error) != GS_OK) {
     ret = GS_INVALID;
     goto cleanup;
   }
@@ -564,15 +536,15 @@ int gs_pair(PSERVER_DATA server, char* pin) {
   }
 
   if (!verifySignature(pairing_secret, 16, pairing_secret+16, 256, plaincert)) {
-    gs_error = "MITM attack detected";
+    ctx->error = "MITM attack detected";
     ret = GS_FAILED;
     goto cleanup;
   }
 
   unsigned char *signature = NULL;
   size_t s_len;
-  if (sign_it(client_secret_data, 16, &signature, &s_len, privateKey) != GS_OK) {
-      gs_error = "Failed to sign data";
+  if (sign_it(client_secret_data, 16, &signature, &s_len, ctx->privateKey) != GS_OK) {
+      ctx->error = "Failed to sign data";
       ret = GS_FAILED;
       goto cleanup;
   }
@@ -585,38 +557,38 @@ int gs_pair(PSERVER_DATA server, char* pin) {
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&clientpairingsecret=%s", server->serverInfo.address, unique_id, uuid_str, client_pairing_secret_hex);
-  if ((ret = http_request(url, data)) != GS_OK)
+  sprintf(url, "http://%s:47989/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&clientpairingsecret=%s", server->serverInfo.address, ctx->unique_id, uuid_str, client_pairing_secret_hex);
+  if ((ret = http_request(ctx->http, url, data)) != GS_OK)
     goto cleanup;
 
   free(result);
   result = NULL;
-  if ((ret = xml_status(data->memory, data->size) != GS_OK))
+  if ((ret = xml_status(data->memory, data->size, &ctx->error, ctx->message) != GS_OK))
     goto cleanup;
-  else if ((ret = xml_search(data->memory, data->size, "paired", &result)) != GS_OK)
+  else if ((ret = xml_search(data->memory, data->size, "paired", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (strcmp(result, "1") != 0) {
-    gs_error = "Pairing failed";
+    ctx->error = "Pairing failed";
     ret = GS_FAILED;
     goto cleanup;
   }
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "https://%s:47984/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&phrase=pairchallenge", server->serverInfo.address, unique_id, uuid_str);
-  if ((ret = http_request(url, data)) != GS_OK)
+  sprintf(url, "https://%s:47984/pair?uniqueid=%s&uuid=%s&devicename=roth&updateState=1&phrase=pairchallenge", server->serverInfo.address, ctx->unique_id, uuid_str);
+  if ((ret = http_request(ctx->http, url, data)) != GS_OK)
     goto cleanup;
 
   free(result);
   result = NULL;
-  if ((ret = xml_status(data->memory, data->size) != GS_OK))
+  if ((ret = xml_status(data->memory, data->size, &ctx->error, ctx->message) != GS_OK))
     goto cleanup;
-  else if ((ret = xml_search(data->memory, data->size, "paired", &result)) != GS_OK)
+  else if ((ret = xml_search(data->memory, data->size, "paired", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (strcmp(result, "1") != 0) {
-    gs_error = "Pairing failed";
+    ctx->error = "Pairing failed";
     ret = GS_FAILED;
     goto cleanup;
   }
@@ -635,30 +607,84 @@ int gs_pair(PSERVER_DATA server, char* pin) {
   return ret;
 }
 
+struct app_list_query {
+  PAPP_LIST apps;
+  // GS_OUT_OF_MEMORY when an app could not be added
+  int ret;
+};
+
+static void add_app(int id, const char *name, void *context) {
+  struct app_list_query *query = (struct app_list_query*) context;
+  if (query->ret != GS_OK)
+    return;
+
+  PAPP_LIST app = malloc(sizeof(APP_LIST));
+  if (app == NULL) {
+    query->ret = GS_OUT_OF_MEMORY;
+    return;
+  }
+
+  app->id = id;
+  app->name = strdup(name);
+  if (app->name == NULL) {
+    free(app);
+    query->ret = GS_OUT_OF_MEMORY;
+    return;
+  }
+
+  app->next = query->apps;
+  query->apps = app;
+}
+
+static void free_app_list(PAPP_LIST list) {
+  while (list != NULL) {
+    PAPP_LIST next = list->next;
+    free(list->name);
+    free(list);
+    list = next;
+  }
+}
+
 int gs_applist(PSERVER_DATA server, PAPP_LIST *list) {
+  PGS_CONTEXT ctx = server->context;
   int ret = GS_OK;
   char url[4096];
   uuid_t uuid;
   char uuid_str[37];
-  PHTTP_DATA data = http_create_data();
-  if (data == NULL)
+  struct app_list_query query = { NULL, GS_OK };
+  PXML_STREAM stream = xml_applist_stream(add_app, &query, &ctx->error, ctx->message);
+  if (stream == NULL)
     return GS_OUT_OF_MEMORY;
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "https://%s:47984/applist?uniqueid=%s&uuid=%s", server->serverInfo.address, unique_id, uuid_str);
-  if (http_request(url, data) != GS_OK)
-    ret = GS_IO_ERROR;
-  else if (xml_status(data->memory, data->size) == GS_ERROR)
-    ret = GS_ERROR;
-  else if (xml_applist(data->memory, data->size, list) != GS_OK)
+  sprintf(url, "https://%s:47984/applist?uniqueid=%s&uuid=%s", server->serverInfo.address, ctx->unique_id, uuid_str);
+  int request = http_request_stream(ctx->http, url, xml_stream_write, stream);
+  if (request == GS_INVALID) {
     ret = GS_INVALID;
+  } else if (request != GS_OK) {
+    ret = GS_IO_ERROR;
+  } else {
+    int parsed = xml_stream_end(stream);
+    if (parsed == GS_ERROR)
+      ret = GS_ERROR;
+    else if (parsed != GS_OK)
+      ret = GS_INVALID;
+    else if (query.ret != GS_OK)
+      ret = query.ret;
+  }
+  xml_stream_free(stream);
+
+  if (ret == GS_OK)
+    *list = query.apps;
+  else
+    free_app_list(query.apps);
 
-  http_free_data(data);
   return ret;
 }
 
 int gs_start_app(PSERVER_DATA server, STREAM_CONFIGURATION *config, int appId, bool sops, bool localaudio, int gamepad_mask) {
+  PGS_CONTEXT ctx = server->context;
   int ret = GS_OK;
   uuid_t uuid;
   char* result = NULL;
@@ -699,19 +725,19 @@ int gs_start_app(PSERVER_DATA server, STREAM_CONFIGURATION *config, int appId, b
   if (server->currentGame == 0) {
     int channelCounnt = config->audioConfiguration == AUDIO_CONFIGURATION_STEREO ? CHANNEL_COUNT_STEREO : CHANNEL_COUNT_51_SURROUND;
     int mask = config->audioConfiguration == AUDIO_CONFIGURATION_STEREO ? CHANNEL_MASK_STEREO : CHANNEL_MASK_51_SURROUND;
-    snprintf(url, sizeof(url), "https://%s:47984/launch?uniqueid=%s&uuid=%s&appid=%d&mode=%dx%dx%d&additionalStates=1&sops=%d&rikey=%s&rikeyid=%d&localAudioPlayMode=%d&surroundAudioInfo=%d&remoteControllersBitmap=%d&gcmap=%d", server->serverInfo.address, unique_id, uuid_str, appId, config->width, config->height, config->fps, sops, rikey_hex, rikeyid, localaudio, (mask << 16) + channelCounnt, gamepad_mask, gamepad_mask);
+    snprintf(url, sizeof(url), "https://%s:47984/launch?uniqueid=%s&uuid=%s&appid=%d&mode=%dx%dx%d&additionalStates=1&sops=%d&rikey=%s&rikeyid=%d&localAudioPlayMode=%d&surroundAudioInfo=%d&remoteControllersBitmap=%d&gcmap=%d", server->serverInfo.address, ctx->unique_id, uuid_str, appId, config->width, config->height, config->fps, sops, rikey_hex, rikeyid, localaudio, (mask << 16) + channelCounnt, gamepad_mask, gamepad_mask);
   } else
-    sprintf(url, "https://%s:47984/resume?uniqueid=%s&uuid=%s&rikey=%s&rikeyid=%d", server->serverInfo.address, unique_id, uuid_str, rikey_hex, rikeyid);
+    sprintf(url, "https://%s:47984/resume?uniqueid=%s&uuid=%s&rikey=%s&rikeyid=%d", server->serverInfo.address, ctx->unique_id, uuid_str, rikey_hex, rikeyid);
 
-  if ((ret = http_request(url, data)) == GS_OK)
+  if ((ret = http_request(ctx->http, url, data)) == GS_OK)
     server->currentGame = appId;
   else
     goto cleanup;
   printf("ret = 0x%x\n", ret);
 
-  if ((ret = xml_status(data->memory, data->size) != GS_OK))
+  if ((ret = xml_status(data->memory, data->size, &ctx->error, ctx->message) != GS_OK))
     goto cleanup;
-  else if ((ret = xml_search(data->memory, data->size, "gamesession", &result)) != GS_OK)
+  else if ((ret = xml_search(data->memory, data->size, "gamesession", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (!strcmp(result, "0")) {
@@ -728,6 +754,7 @@ int gs_start_app(PSERVER_DATA server, STREAM_CONFIGURATION *config, int appId, b
 }
 
 int gs_quit_app(PSERVER_DATA server) {
+  PGS_CONTEXT ctx = server->context;
   int ret = GS_OK;
   char url[4096];
   uuid_t uuid;
@@ -739,13 +766,13 @@ int gs_quit_app(PSERVER_DATA server) {
 
   uuid_generate_random(uuid);
   uuid_unparse(uuid, uuid_str);
-  sprintf(url, "https://%s:47984/cancel?uniqueid=%s&uuid=%s", server->serverInfo.address, unique_id, uuid_str);
-  if ((ret = http_request(url, data)) != GS_OK)
+  sprintf(url, "https://%s:47984/cancel?uniqueid=%s&uuid=%s", server->serverInfo.address, ctx->unique_id, uuid_str);
+  if ((ret = http_request(ctx->http, url, data)) != GS_OK)
     goto cleanup;
 
-  if ((ret = xml_status(data->memory, data->size) != GS_OK))
+  if ((ret = xml_status(data->memory, data->size, &ctx->error, ctx->message) != GS_OK))
     goto cleanup;
-  else if ((ret = xml_search(data->memory, data->size, "cancel", &result)) != GS_OK)
+  else if ((ret = xml_search(data->memory, data->size, "cancel", &result, &ctx->error)) != GS_OK)
     goto cleanup;
 
   if (strcmp(result, "0") == 0) {
@@ -761,18 +788,68 @@ int gs_quit_app(PSERVER_DATA server) {
   return ret;
 }
 
-int gs_init(PSERVER_DATA server, char *address, const char *keyDirectory, int log_level, bool unsupported) {
+int gs_context_init(PGS_CONTEXT ctx, const char *keyDirectory, int log_level) {
+  const char *error;
+  memset(ctx, 0, sizeof(GS_CONTEXT));
   mkdirtree(keyDirectory);
-  if (load_unique_id(keyDirectory) != GS_OK)
-    return GS_FAILED;
+  if (load_unique_id(ctx, keyDirectory) != GS_OK)
+    goto fail;
 
-  if (load_cert(keyDirectory))
-    return GS_FAILED;
+  if (load_cert(ctx, keyDirectory))
+    goto fail;
+
+  ctx->http = http_create(keyDirectory, log_level, &ctx->error);
+  if (ctx->http == NULL) {
+    ctx->error = "Can't create HTTP client";
+    goto fail;
+  }
+
+  return GS_OK;
 
-  http_init(keyDirectory, log_level);
+  fail:
+  // the cleanup clears the whole context, the reason has to outlive it
+  error = ctx->error;
+  gs_context_cleanup(ctx);
+  ctx->error = error;
+  return GS_FAILED;
+}
 
+void gs_context_cleanup(PGS_CONTEXT ctx) {
+  http_destroy(ctx->http);
+  X509_free(ctx->cert);
+  EVP_PKEY_free(ctx->privateKey);
+  memset(ctx, 0, sizeof(GS_CONTEXT));
+}
+
+int gs_init_context(PGS_CONTEXT ctx, PSERVER_DATA server, char *address, bool unsupported) {
+  server->context = ctx;
   LiInitializeServerInformation(&server->serverInfo);
   server->serverInfo.address = address;
   server->unsupported = unsupported;
   return load_server_status(server);
 }
+
+int gs_init(PSERVER_DATA server, char *address, const char *keyDirectory, int log_level, bool unsupported) {
+  server->context = &default_context;
+
+  pthread_mutex_lock(&default_context_lock);
+  if (default_context_ready &&
+      (strcmp(default_key_dir, keyDirectory) != 0 || default_log_level != log_level)) {
+    gs_context_cleanup(&default_context);
+    default_context_ready = false;
+  }
+
+  if (!default_context_ready) {
+    if (gs_context_init(&default_context, keyDirectory, log_level) != GS_OK) {
+      pthread_mutex_unlock(&default_context_lock);
+      return GS_FAILED;
+    }
+
+    snprintf(default_key_dir, sizeof(default_key_dir), "%s", keyDirectory);
+    default_log_level = log_level;
+    default_context_ready = true;
+  }
+  pthread_mutex_unlock(&default_context_lock);
+
+  return gs_init_context(&default_context, server, address, unsupported);
+}
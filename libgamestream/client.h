@@ -20,6 +20,7 @@
 #pragma once
 
 #include "xml.h"
+#include "http.h"
 
 #include <Limelight.h>
 
@@ -28,7 +29,26 @@
 #define MIN_SUPPORTED_GFE_VERSION 3
 #define MAX_SUPPORTED_GFE_VERSION 7
 
+#define UNIQUEID_BYTES 8
+#define UNIQUEID_CHARS (UNIQUEID_BYTES*2)
+
+// The identity of this client and its HTTP handle. Calls on servers of
+// the same context must come from one thread at a time, separate contexts
+// can be used in parallel to talk to several hosts.
+typedef struct _GS_CONTEXT {
+  char unique_id[UNIQUEID_CHARS+1];
+  struct x509_st *cert;
+  char cert_hex[4096];
+  struct evp_pkey_st *privateKey;
+  PHTTP_CLIENT http;
+  // message of the last failed call
+  const char *error;
+  // backs error when the message came from the host
+  char message[XML_MESSAGE_LENGTH];
+} GS_CONTEXT, *PGS_CONTEXT;
+
 typedef struct _SERVER_DATA {
+  PGS_CONTEXT context;
   const char* address;
   char* gpuType;
   bool paired;
@@ -39,8 +59,18 @@ typedef struct _SERVER_DATA {
   char* gsVersion;
   PDISPLAY_MODE modes;
   SERVER_INFORMATION serverInfo;
+  // backs the strings and modes above
+  SERVERINFO info;
 } SERVER_DATA, *PSERVER_DATA;
 
+int gs_context_init(PGS_CONTEXT context, const char *keyDirectory, int logLevel);
+void gs_context_cleanup(PGS_CONTEXT context);
+int gs_init_context(PGS_CONTEXT context, PSERVER_DATA server, char* address, bool unsupported);
+
+// Uses a context shared by all its callers. It is created on first use
+// and replaced when a call passes another key directory or log level, so
+// servers from earlier calls switch to the new identity. Callers that talk
+// to hosts from several threads need their own contexts.
 int gs_init(PSERVER_DATA server, char* address, const char *keyDirectory, int logLevel, bool unsupported);
 int gs_start_app(PSERVER_DATA server, PSTREAM_CONFIGURATION config, int appId, bool sops, bool localaudio, int gamepad_mask);
 int gs_applist(PSERVER_DATA server, PAPP_LIST *app_list);
@@ -24,15 +24,36 @@
 #include <string.h>
 #include <curl/curl.h>
 
+#ifdef __vita__
 #include <psp2/sysmodule.h>
 #include "../src/graphics.h"
-
-static CURL *curl;
+#endif
 
 static const char *pCertFile = "./client.pem";
 static const char *pKeyFile = "./key.pem";
 
-static bool debug;
+// Connections and TLS sessions are kept by the curl handle and reused for
+// the next request to the same host. Hosts that refuse a resumed TLS
+// session get a fresh handshake every time.
+#define MAX_CONNECTS 4
+#define MAX_HOSTS 8
+#define HOST_LENGTH 64
+
+struct host_list {
+  char hosts[MAX_HOSTS][HOST_LENGTH];
+  int count;
+};
+
+struct _HTTP_CLIENT {
+  CURL *curl;
+  bool debug;
+  // request errors are reported here
+  const char **error;
+  // hosts that do not accept reused connections
+  struct host_list fresh_hosts;
+  // hosts that completed a request, curl may hold a TLS session for them
+  struct host_list session_hosts;
+};
 
 static size_t _write_curl(void *contents, size_t size, size_t nmemb, void *userp)
 {
@@ -50,11 +71,41 @@ static size_t _write_curl(void *contents, size_t size, size_t nmemb, void *userp
   return realsize;
 }
 
-int http_init(const char* keyDirectory, int logLevel) {
-  curl = curl_easy_init();
-  debug = logLevel >= 2;
-  if (!curl)
-    return GS_FAILED;
+struct http_stream {
+  HTTP_WRITE write;
+  void *context;
+  size_t received;
+  bool rejected;
+};
+
+static size_t _write_stream(void *contents, size_t size, size_t nmemb, void *userp)
+{
+  size_t realsize = size * nmemb;
+  struct http_stream *stream = (struct http_stream*) userp;
+
+  stream->received += realsize;
+  if (!stream->write(contents, realsize, stream->context)) {
+    stream->rejected = true;
+    return 0;
+  }
+
+  return realsize;
+}
+
+PHTTP_CLIENT http_create(const char* keyDirectory, int logLevel, const char **error) {
+  PHTTP_CLIENT http = calloc(1, sizeof(HTTP_CLIENT));
+  if (http == NULL)
+    return NULL;
+
+  http->curl = curl_easy_init();
+  http->debug = logLevel >= 2;
+  http->error = error;
+  if (!http->curl) {
+    free(http);
+    return NULL;
+  }
+
+  CURL *curl = http->curl;
 
   char certificateFilePath[4096];
   sprintf(certificateFilePath, "%s/%s", keyDirectory, CERTIFICATE_FILE_NAME);
@@ -69,52 +120,161 @@ int http_init(const char* keyDirectory, int logLevel) {
   curl_easy_setopt(curl, CURLOPT_SSLKEYTYPE, "PEM");
   curl_easy_setopt(curl, CURLOPT_SSLKEY, keyFilePath);
   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _write_curl);
   curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-  curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
-  curl_easy_setopt(curl, CURLOPT_MAXCONNECTS, 0L);
-  curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
-  curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+  curl_easy_setopt(curl, CURLOPT_MAXCONNECTS, (long) MAX_CONNECTS);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
   curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
   curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
-  return GS_OK;
+  return http;
 }
 
-int http_request(char* url, PHTTP_DATA data) {
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, data);
-  curl_easy_setopt(curl, CURLOPT_URL, url);
+static void url_host(const char *url, char *host) {
+  const char *start = strstr(url, "://");
+  start = start ? start + 3 : url;
+  size_t length = strcspn(start, "/");
+  if (length >= HOST_LENGTH)
+    length = HOST_LENGTH - 1;
 
-  char url_tiny[48] = {0};
-  strncpy(url_tiny, url, sizeof(url_tiny) - 1);
-  if (debug)
-    printf("GET %s\n", url_tiny);
+  memcpy(host, start, length);
+  host[length] = 0;
+}
+
+static bool host_list_has(struct host_list *list, const char *host) {
+  for (int i = 0; i < list->count; i++) {
+    if (strcmp(list->hosts[i], host) == 0)
+      return true;
+  }
+  return false;
+}
+
+static bool host_list_add(struct host_list *list, const char *host) {
+  if (list->count == MAX_HOSTS || host_list_has(list, host))
+    return false;
+
+  strcpy(list->hosts[list->count++], host);
+  return true;
+}
+
+// A kept-alive connection the host closed while it was idle fails the
+// send, and a request that wasn't sent in full can't be acted on. An
+// empty reply or a receive error may come after the host ran the request
+// (launch, resume, pair), those are never sent again.
+static bool is_stale_connection_error(CURLcode res) {
+  return res == CURLE_SEND_ERROR;
+}
 
-  if (data->size > 0) {
+// data is reset before each try, streams can only be retried while
+// nothing has been passed on. reused tells whether the request went over
+// a kept-alive connection.
+static CURLcode http_perform(PHTTP_CLIENT http, PHTTP_DATA data, bool fresh_connect, bool session_cache, bool *reused) {
+  CURL *curl = http->curl;
+  if (data != NULL && data->size > 0) {
     free(data->memory);
     data->memory = malloc(1);
     if(data->memory == NULL)
-      return GS_OUT_OF_MEMORY;
+      return CURLE_OUT_OF_MEMORY;
 
     data->size = 0;
   }
+
+  curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, fresh_connect ? 1L : 0L);
+  curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, session_cache ? 1L : 0L);
   CURLcode res = curl_easy_perform(curl);
 
-  if(res != CURLE_OK) {
-    gs_error = curl_easy_strerror(res);
-    return GS_FAILED;
-  } else if (data->memory == NULL) {
+  long connects = 0;
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+  if (http->debug)
+    printf("%s connection\n", connects > 0 ? "New" : "Reused");
+
+  *reused = connects == 0;
+
+  return res;
+}
+
+static int http_get(PHTTP_CLIENT http, char* url, PHTTP_DATA data, struct http_stream *stream) {
+  CURL *curl = http->curl;
+  curl_easy_setopt(curl, CURLOPT_URL, url);
+
+  char url_tiny[48] = {0};
+  strncpy(url_tiny, url, sizeof(url_tiny) - 1);
+  if (http->debug)
+    printf("GET %s\n", url_tiny);
+
+  char host[HOST_LENGTH];
+  url_host(url, host);
+  bool fresh = host_list_has(&http->fresh_hosts, host);
+  bool reused = false;
+
+  // hosts that don't accept reuse keep the old behaviour: a new connection
+  // and a full handshake for every request, closed afterwards
+  curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, fresh ? 1L : 0L);
+  CURLcode res = http_perform(http, data, fresh, !fresh, &reused);
+
+  if (reused && is_stale_connection_error(res) && (stream == NULL || stream->received == 0)) {
+    // the host closed the idle connection, reconnect once
+    res = http_perform(http, data, true, true, &reused);
+  }
+
+  if (!fresh && res == CURLE_SSL_CONNECT_ERROR && host_list_has(&http->session_hosts, host)) {
+    // the handshake failed with a session from an earlier request, the host
+    // may refuse to resume it. Hosts without a session (e.g. unpaired ones)
+    // are not tried again.
+    curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+    res = http_perform(http, data, true, false, &reused);
+    if (res == CURLE_OK && host_list_add(&http->fresh_hosts, host) && http->debug)
+      printf("%s does not accept reused connections\n", host);
+  }
+
+  if (res == CURLE_OK)
+    host_list_add(&http->session_hosts, host);
+
+  if (stream != NULL && stream->rejected) {
+    return GS_INVALID;
+  } else if (res == CURLE_OUT_OF_MEMORY) {
     return GS_OUT_OF_MEMORY;
+  } else if(res != CURLE_OK) {
+    *http->error = curl_easy_strerror(res);
+    return GS_FAILED;
   }
 
-  if (debug)
+  return GS_OK;
+}
+
+int http_request(PHTTP_CLIENT http, char* url, PHTTP_DATA data) {
+  curl_easy_setopt(http->curl, CURLOPT_WRITEFUNCTION, _write_curl);
+  curl_easy_setopt(http->curl, CURLOPT_WRITEDATA, data);
+
+  int ret = http_get(http, url, data, NULL);
+  if (ret != GS_OK)
+    return ret;
+  else if (data->memory == NULL)
+    return GS_OUT_OF_MEMORY;
+
+  if (http->debug)
     printf("Response:\n%s\n\n", data->memory);
 
   return GS_OK;
 }
 
-void http_cleanup() {
-  curl_easy_cleanup(curl);
+int http_request_stream(PHTTP_CLIENT http, char* url, HTTP_WRITE write, void *context) {
+  struct http_stream stream = { write, context, 0, false };
+  curl_easy_setopt(http->curl, CURLOPT_WRITEFUNCTION, _write_stream);
+  curl_easy_setopt(http->curl, CURLOPT_WRITEDATA, &stream);
+
+  int ret = http_get(http, url, NULL, &stream);
+  if (http->debug && ret == GS_OK)
+    printf("Response: %zu bytes streamed\n\n", stream.received);
+
+  return ret;
+}
+
+void http_destroy(PHTTP_CLIENT http) {
+  if (http == NULL)
+    return;
+
+  curl_easy_cleanup(http->curl);
+  free(http);
 }
 
 PHTTP_DATA http_create_data() {
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdbool.h>
 
 #define CERTIFICATE_FILE_NAME "client.pem"
 #define KEY_FILE_NAME "key.pem"
@@ -29,7 +30,20 @@ typedef struct _HTTP_DATA {
   size_t size;
 } HTTP_DATA, *PHTTP_DATA;
 
-int http_init(const char* keyDirectory, int logLevel);
+// A curl handle with its connections and TLS sessions. A client can only
+// be used by one thread at a time, separate clients are independent.
+typedef struct _HTTP_CLIENT HTTP_CLIENT, *PHTTP_CLIENT;
+
+// error is where failed requests leave their message
+PHTTP_CLIENT http_create(const char* keyDirectory, int logLevel, const char **error);
+void http_destroy(PHTTP_CLIENT http);
+
 PHTTP_DATA http_create_data();
-int http_request(char* url, PHTTP_DATA data);
+int http_request(PHTTP_CLIENT http, char* url, PHTTP_DATA data);
+
+// Receives the body as it arrives, returns false to abort the request
+typedef bool (*HTTP_WRITE)(const char *chunk, size_t size, void *context);
+
+// GS_INVALID when the writer aborted
+int http_request_stream(PHTTP_CLIENT http, char* url, HTTP_WRITE write, void *context);
 void http_free_data(PHTTP_DATA data);
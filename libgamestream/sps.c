@@ -21,13 +21,76 @@
 
 #include "h264_stream.h"
 
+#include <string.h>
+
+// The host sends the same SPS with almost every IDR frame, so remember the
+// rewritten NAL units instead of parsing and serializing them again.
+#define SPS_CACHE_SIZE 4
+#define SPS_MAX_LENGTH 128
+
+struct sps_cache_entry {
+  uint32_t hash;
+  int flags;
+  uint32_t in_length;
+  uint32_t out_length;
+  uint8_t in[SPS_MAX_LENGTH];
+  uint8_t out[4 + SPS_MAX_LENGTH];
+};
+
 static h264_stream_t* h264_stream = NULL;
 static int initial_width, initial_height;
 
+static struct sps_cache_entry sps_cache[SPS_CACHE_SIZE];
+static int sps_cache_count, sps_cache_next;
+
+// RBSP scratch space so parsing and rewriting don't touch the heap
+static uint8_t sps_rbsp[SPS_MAX_LENGTH];
+
+// FNV-1a over the SPS bytes and the fixup flags
+static uint32_t sps_hash(const uint8_t* data, uint32_t length, int flags) {
+  uint32_t hash = 2166136261u ^ (uint32_t) flags;
+  for (uint32_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static struct sps_cache_entry* sps_cache_find(uint32_t hash, PLENTRY sps, int flags) {
+  for (int i = 0; i < sps_cache_count; i++) {
+    struct sps_cache_entry* entry = &sps_cache[i];
+    if (entry->hash == hash && entry->flags == flags && entry->in_length == sps->length &&
+        memcmp(entry->in, sps->data, sps->length) == 0)
+      return entry;
+  }
+  return NULL;
+}
+
+static void sps_cache_add(uint32_t hash, PLENTRY sps, int flags, uint8_t* out, uint32_t out_length) {
+  if (sps->length > SPS_MAX_LENGTH || out_length > sizeof(sps_cache[0].out))
+    return;
+
+  struct sps_cache_entry* entry = &sps_cache[sps_cache_next];
+  entry->hash = hash;
+  entry->flags = flags;
+  entry->in_length = sps->length;
+  entry->out_length = out_length;
+  memcpy(entry->in, sps->data, sps->length);
+  memcpy(entry->out, out, out_length);
+
+  sps_cache_next = (sps_cache_next + 1) % SPS_CACHE_SIZE;
+  if (sps_cache_count < SPS_CACHE_SIZE)
+    sps_cache_count++;
+}
+
 void gs_sps_init(int width, int height) {
   h264_stream = h264_new();
   initial_width = width;
   initial_height = height;
+
+  // the rewrite depends on the stream resolution
+  sps_cache_count = 0;
+  sps_cache_next = 0;
 }
 
 void gs_sps_stop() {
@@ -40,7 +103,20 @@ void gs_sps_stop() {
 void gs_sps_fix(PLENTRY sps, int flags, uint8_t* out_buf, uint32_t* out_offset) {
   const char naluHeader[] = {0x00, 0x00, 0x00, 0x01};
 
-  read_nal_unit(h264_stream, sps->data+4, sps->length-4);
+  uint32_t hash = sps_hash((uint8_t*) sps->data, sps->length, flags);
+  struct sps_cache_entry* cached = sps_cache_find(hash, sps, flags);
+  if (cached != NULL) {
+    memcpy(out_buf+*out_offset, cached->out, cached->out_length);
+    *out_offset += cached->out_length;
+    return;
+  }
+
+  uint32_t start_offset = *out_offset;
+
+  if (sps->length-4 <= sizeof(sps_rbsp))
+    read_nal_unit_buf(h264_stream, (uint8_t*) sps->data+4, sps->length-4, sps_rbsp, sizeof(sps_rbsp));
+  else
+    read_nal_unit(h264_stream, (uint8_t*) sps->data+4, sps->length-4);
 
   // Some decoders rely on H264 level to decide how many buffers are needed
   // Since we only need one frame buffered, we'll set level as low as we can
@@ -85,5 +161,15 @@ void gs_sps_fix(PLENTRY sps, int flags, uint8_t* out_buf, uint32_t* out_offset)
   memcpy(out_buf+*out_offset, naluHeader, 4);
   *out_offset += 4;
 
-  *out_offset += write_nal_unit(h264_stream, out_buf+*out_offset, 128);
+  int written = write_nal_unit_buf(h264_stream, out_buf+*out_offset, SPS_MAX_LENGTH, sps_rbsp, sizeof(sps_rbsp));
+  if (written < 0) {
+    // the rewritten SPS doesn't fit, pass the original one on unchanged
+    *out_offset = start_offset;
+    memcpy(out_buf+*out_offset, sps->data, sps->length);
+    *out_offset += sps->length;
+    return;
+  }
+
+  *out_offset += written;
+  sps_cache_add(hash, sps, flags, out_buf + start_offset, *out_offset - start_offset);
 }
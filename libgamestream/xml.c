@@ -25,8 +25,6 @@
 
 #define STATUS_OK 200
 
-static XML_Parser parser;
-
 struct xml_query {
   char *memory;
   size_t size;
@@ -46,80 +44,23 @@ static void XMLCALL _xml_end_element(void *userData, const char *name) {
     search->start--;
 }
 
-static void XMLCALL _xml_start_applist_element(void *userData, const char *name, const char **atts) {
-  struct xml_query *search = (struct xml_query*) userData;
-  if (strcmp("App", name) == 0) {
-    PAPP_LIST app = malloc(sizeof(APP_LIST));
-    if (app == NULL)
-      return;
-
-    app->id = 0;
-    app->name = NULL;
-    app->next = (PAPP_LIST) search->data;
-    search->data = app;
-  } else if (strcmp("ID", name) == 0 || strcmp("AppTitle", name) == 0) {
-    search->memory = malloc(1);
-    search->size = 0;
-    search->start = 1;
-  }
-}
-
-static void XMLCALL _xml_end_applist_element(void *userData, const char *name) {
-  struct xml_query *search = (struct xml_query*) userData;
-  if (search->start) {
-    PAPP_LIST list = (PAPP_LIST) search->data;
-    if (list == NULL)
-      return;
-
-    if (strcmp("ID", name) == 0) {
-        list->id = atoi(search->memory);
-        free(search->memory);
-    } else if (strcmp("AppTitle", name) == 0) {
-        list->name = search->memory;
-    }
-    search->start = 0;
-  }
-}
-
-static void XMLCALL _xml_start_mode_element(void *userData, const char *name, const char **atts) {
-  struct xml_query *search = (struct xml_query*) userData;
-  if (strcmp("DisplayMode", name) == 0) {
-    PDISPLAY_MODE mode = calloc(1, sizeof(DISPLAY_MODE));
-    if (mode != NULL) {
-      mode->next = (PDISPLAY_MODE) search->data;
-      search->data = mode;
-    }
-  } else if (search->data != NULL && (strcmp("Height", name) == 0 || strcmp("Width", name) == 0 || strcmp("RefreshRate", name) == 0)) {
-    search->memory = malloc(1);
-    search->size = 0;
-    search->start = 1;
-  }
-}
-
-static void XMLCALL _xml_end_mode_element(void *userData, const char *name) {
-  struct xml_query *search = (struct xml_query*) userData;
-  if (search->data != NULL && search->start) {
-    PDISPLAY_MODE mode = (PDISPLAY_MODE) search->data;
-    if (strcmp("Width", name) == 0)
-      mode->width = atoi(search->memory);
-    else if (strcmp("Height", name) == 0)
-      mode->height = atoi(search->memory);
-    else if (strcmp("RefreshRate", name) == 0)
-      mode->refresh = atoi(search->memory);
-
-    free(search->memory);
-    search->start = 0;
-  }
-}
+struct status_query {
+  int status;
+  const char **error;
+  // XML_MESSAGE_LENGTH, holds the status message
+  char *message;
+};
 
 static void XMLCALL _xml_start_status_element(void *userData, const char *name, const char **atts) {
   if (strcmp("root", name) == 0) {
-    int* status = (int*) userData;
+    struct status_query *query = (struct status_query*) userData;
     for (int i = 0; atts[i]; i += 2) {
       if (strcmp("status_code", atts[i]) == 0)
-        *status = atoi(atts[i + 1]);
-      else if (*status != STATUS_OK && strcmp("status_message", atts[i]) == 0)
-        gs_error = strdup(atts[i + 1]);
+        query->status = atoi(atts[i + 1]);
+      else if (query->status != STATUS_OK && strcmp("status_message", atts[i]) == 0) {
+        snprintf(query->message, XML_MESSAGE_LENGTH, "%s", atts[i + 1]);
+        *query->error = query->message;
+      }
     }
   }
 }
@@ -139,7 +80,7 @@ static void XMLCALL _xml_write_data(void *userData, const XML_Char *s, int len)
   }
 }
 
-int xml_search(char* data, size_t len, char* node, char** result) {
+int xml_search(char* data, size_t len, char* node, char** result, const char **error) {
   struct xml_query search;
   search.data = node;
   search.start = 0;
@@ -151,7 +92,7 @@ int xml_search(char* data, size_t len, char* node, char** result) {
   XML_SetCharacterDataHandler(parser, _xml_write_data);
   if (! XML_Parse(parser, data, len, 1)) {
     int code = XML_GetErrorCode(parser);
-    gs_error = XML_ErrorString(code);
+    *error = XML_ErrorString(code);
     XML_ParserFree(parser);
     free(search.memory);
     return GS_INVALID;
@@ -166,62 +107,334 @@ int xml_search(char* data, size_t len, char* node, char** result) {
   return GS_OK;
 }
 
-int xml_applist(char* data, size_t len, PAPP_LIST *app_list) {
-  struct xml_query query;
-  query.memory = calloc(1, 1);
-  query.size = 0;
-  query.start = 0;
-  query.data = NULL;
+int xml_status(char* data, size_t len, const char **error, char *message) {
+  struct status_query query = { 0, error, message };
   XML_Parser parser = XML_ParserCreate("UTF-8");
   XML_SetUserData(parser, &query);
-  XML_SetElementHandler(parser, _xml_start_applist_element, _xml_end_applist_element);
-  XML_SetCharacterDataHandler(parser, _xml_write_data);
-  if (! XML_Parse(parser, data, len, 1)) {
+  XML_SetElementHandler(parser, _xml_start_status_element, _xml_end_status_element);
+  if (!XML_Parse(parser, data, len, 1)) {
     int code = XML_GetErrorCode(parser);
-    gs_error = XML_ErrorString(code);
+    *error = XML_ErrorString(code);
     XML_ParserFree(parser);
     return GS_INVALID;
   }
 
   XML_ParserFree(parser);
-  *app_list = (PAPP_LIST) query.data;
+  return query.status == STATUS_OK ? GS_OK : GS_ERROR;
+}
 
-  return GS_OK;
+// Streamed responses are parsed chunk by chunk as they arrive. The text
+// of the element being read goes into a fixed buffer.
+enum xml_field {
+  FIELD_NONE,
+  FIELD_CURRENT_GAME,
+  FIELD_PAIR_STATUS,
+  FIELD_APP_VERSION,
+  FIELD_STATE,
+  FIELD_CODEC_MODE_SUPPORT,
+  FIELD_GPU_TYPE,
+  FIELD_GS_VERSION,
+  FIELD_GFE_VERSION,
+  // only inside a DisplayMode
+  FIELD_WIDTH,
+  FIELD_HEIGHT,
+  FIELD_REFRESH_RATE,
+  // only inside an App
+  FIELD_APP_ID,
+  FIELD_APP_TITLE,
+  FIELD_COUNT
+};
+
+static const char *field_elements[FIELD_COUNT] = {
+  [FIELD_CURRENT_GAME] = "currentgame",
+  [FIELD_PAIR_STATUS] = "PairStatus",
+  [FIELD_APP_VERSION] = "appversion",
+  [FIELD_STATE] = "state",
+  [FIELD_CODEC_MODE_SUPPORT] = "ServerCodecModeSupport",
+  [FIELD_GPU_TYPE] = "gputype",
+  [FIELD_GS_VERSION] = "GsVersion",
+  [FIELD_GFE_VERSION] = "GfeVersion",
+  [FIELD_WIDTH] = "Width",
+  [FIELD_HEIGHT] = "Height",
+  [FIELD_REFRESH_RATE] = "RefreshRate",
+  [FIELD_APP_ID] = "ID",
+  [FIELD_APP_TITLE] = "AppTitle",
+};
+
+#define SERVERINFO_REQUIRED ((1 << FIELD_CURRENT_GAME) | (1 << FIELD_PAIR_STATUS) | \
+                             (1 << FIELD_APP_VERSION) | (1 << FIELD_STATE))
+
+#define APP_TITLE_LENGTH 256
+
+struct serverinfo_query {
+  PSERVERINFO info;
+  // fields with text, by bit
+  unsigned int found;
+  PDISPLAY_MODE mode;
+  int mode_count;
+};
+
+struct applist_query {
+  APP_CALLBACK callback;
+  void *context;
+  bool in_app;
+  int id;
+  char title[APP_TITLE_LENGTH];
+};
+
+struct _XML_STREAM {
+  XML_Parser parser;
+  // status code of the root element, errors go to its error
+  struct status_query status;
+  bool failed;
+  enum xml_field field;
+  char *text;
+  size_t text_size;
+  size_t text_length;
+  // numbers are collected here before conversion
+  char number[16];
+  // checks the query once the document is complete
+  int (*complete)(PXML_STREAM stream);
+  union {
+    struct serverinfo_query serverinfo;
+    struct applist_query applist;
+  } query;
+};
+
+static void xml_stream_collect(PXML_STREAM stream, enum xml_field field, char *text, size_t size) {
+  stream->field = field;
+  stream->text = text;
+  stream->text_size = size;
+  stream->text_length = 0;
+  text[0] = 0;
 }
 
-int xml_modelist(char* data, size_t len, PDISPLAY_MODE *mode_list) {
-  struct xml_query query = {0};
-  query.memory = calloc(1, 1);
-  XML_Parser parser = XML_ParserCreate("UTF-8");
-  XML_SetUserData(parser, &query);
-  XML_SetElementHandler(parser, _xml_start_mode_element, _xml_end_mode_element);
-  XML_SetCharacterDataHandler(parser, _xml_write_data);
-  if (! XML_Parse(parser, data, len, 1)) {
-    int code = XML_GetErrorCode(parser);
-    gs_error = XML_ErrorString(code);
-    XML_ParserFree(parser);
-    return GS_INVALID;
+// returns the field whose element just ended, FIELD_NONE for any other
+static enum xml_field xml_stream_collected(PXML_STREAM stream, const char *name) {
+  enum xml_field field = stream->field;
+  if (field == FIELD_NONE || strcmp(field_elements[field], name) != 0)
+    return FIELD_NONE;
+
+  stream->field = FIELD_NONE;
+  stream->text = NULL;
+  return field;
+}
+
+// text longer than its field is cut, the fields are sized for what GFE sends
+static void XMLCALL _xml_write_stream_data(void *userData, const XML_Char *s, int len) {
+  PXML_STREAM stream = (PXML_STREAM) userData;
+  if (stream->text == NULL)
+    return;
+
+  size_t space = stream->text_size - 1 - stream->text_length;
+  size_t length = (size_t) len < space ? (size_t) len : space;
+  memcpy(stream->text + stream->text_length, s, length);
+  stream->text_length += length;
+  stream->text[stream->text_length] = 0;
+}
+
+static void XMLCALL _xml_start_serverinfo_element(void *userData, const char *name, const char **atts) {
+  PXML_STREAM stream = (PXML_STREAM) userData;
+  struct serverinfo_query *query = &stream->query.serverinfo;
+  PSERVERINFO info = query->info;
+
+  if (strcmp("root", name) == 0) {
+    _xml_start_status_element(&stream->status, name, atts);
+    return;
+  } else if (strcmp("DisplayMode", name) == 0) {
+    if (query->mode_count < MAX_DISPLAY_MODES) {
+      query->mode = &info->mode_slots[query->mode_count++];
+      query->mode->next = info->modes;
+      info->modes = query->mode;
+    }
+    return;
   }
 
-  XML_ParserFree(parser);
-  *mode_list = (PDISPLAY_MODE) query.data;
+  int last = query->mode != NULL ? FIELD_REFRESH_RATE : FIELD_GFE_VERSION;
+  for (int i = FIELD_CURRENT_GAME; i <= last; i++) {
+    if (strcmp(field_elements[i], name) != 0)
+      continue;
 
-  return GS_OK;
+    switch (i) {
+    case FIELD_APP_VERSION:
+      xml_stream_collect(stream, i, info->appVersion, sizeof(info->appVersion));
+      break;
+    case FIELD_STATE:
+      xml_stream_collect(stream, i, info->state, sizeof(info->state));
+      break;
+    case FIELD_GPU_TYPE:
+      xml_stream_collect(stream, i, info->gpuType, sizeof(info->gpuType));
+      break;
+    case FIELD_GS_VERSION:
+      xml_stream_collect(stream, i, info->gsVersion, sizeof(info->gsVersion));
+      break;
+    case FIELD_GFE_VERSION:
+      xml_stream_collect(stream, i, info->gfeVersion, sizeof(info->gfeVersion));
+      break;
+    default:
+      xml_stream_collect(stream, i, stream->number, sizeof(stream->number));
+      break;
+    }
+    return;
+  }
+}
+
+static void XMLCALL _xml_end_serverinfo_element(void *userData, const char *name) {
+  PXML_STREAM stream = (PXML_STREAM) userData;
+  struct serverinfo_query *query = &stream->query.serverinfo;
+  PSERVERINFO info = query->info;
 
+  enum xml_field field = xml_stream_collected(stream, name);
+  if (field != FIELD_NONE && stream->text_length > 0)
+    query->found |= 1 << field;
+
+  switch (field) {
+  case FIELD_NONE:
+    if (strcmp("DisplayMode", name) == 0)
+      query->mode = NULL;
+    break;
+  case FIELD_CURRENT_GAME:
+    info->currentGame = atoi(stream->number);
+    break;
+  case FIELD_PAIR_STATUS:
+    info->paired = strcmp(stream->number, "1") == 0;
+    break;
+  case FIELD_CODEC_MODE_SUPPORT:
+    info->codecModeSupport = true;
+    break;
+  case FIELD_WIDTH:
+    query->mode->width = atoi(stream->number);
+    break;
+  case FIELD_HEIGHT:
+    query->mode->height = atoi(stream->number);
+    break;
+  case FIELD_REFRESH_RATE:
+    query->mode->refresh = atoi(stream->number);
+    break;
+  default:
+    break;
+  }
 }
 
-int xml_status(char* data, size_t len) {
-  int status = 0;
-  XML_Parser parser = XML_ParserCreate("UTF-8");
-  XML_SetUserData(parser, &status);
-  XML_SetElementHandler(parser, _xml_start_status_element, _xml_end_status_element);
-  if (!XML_Parse(parser, data, len, 1)) {
-    int code = XML_GetErrorCode(parser);
-    gs_error = XML_ErrorString(code);
-    XML_ParserFree(parser);
-    return GS_INVALID;
+static int xml_serverinfo_complete(PXML_STREAM stream) {
+  // These fields are present on all version of GFE that this client supports
+  unsigned int found = stream->query.serverinfo.found;
+  return (found & SERVERINFO_REQUIRED) == SERVERINFO_REQUIRED ? GS_OK : GS_INVALID;
+}
+
+static void XMLCALL _xml_start_applist_element(void *userData, const char *name, const char **atts) {
+  PXML_STREAM stream = (PXML_STREAM) userData;
+  struct applist_query *query = &stream->query.applist;
+
+  if (strcmp("root", name) == 0) {
+    _xml_start_status_element(&stream->status, name, atts);
+  } else if (strcmp("App", name) == 0) {
+    query->in_app = true;
+    query->id = 0;
+    query->title[0] = 0;
+  } else if (query->in_app && strcmp("ID", name) == 0) {
+    xml_stream_collect(stream, FIELD_APP_ID, stream->number, sizeof(stream->number));
+  } else if (query->in_app && strcmp("AppTitle", name) == 0) {
+    xml_stream_collect(stream, FIELD_APP_TITLE, query->title, sizeof(query->title));
   }
+}
 
-  XML_ParserFree(parser);
-  return status == STATUS_OK ? GS_OK : GS_ERROR;
+static void XMLCALL _xml_end_applist_element(void *userData, const char *name) {
+  PXML_STREAM stream = (PXML_STREAM) userData;
+  struct applist_query *query = &stream->query.applist;
+
+  switch (xml_stream_collected(stream, name)) {
+  case FIELD_APP_ID:
+    query->id = atoi(stream->number);
+    break;
+  case FIELD_NONE:
+    if (query->in_app && strcmp("App", name) == 0) {
+      query->in_app = false;
+      query->callback(query->id, query->title, query->context);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static PXML_STREAM xml_stream_create(XML_StartElementHandler start, XML_EndElementHandler end, const char **error, char *message) {
+  PXML_STREAM stream = calloc(1, sizeof(XML_STREAM));
+  if (stream == NULL)
+    return NULL;
+
+  stream->status.error = error;
+  stream->status.message = message;
+  stream->parser = XML_ParserCreate("UTF-8");
+  if (stream->parser == NULL) {
+    free(stream);
+    return NULL;
+  }
+
+  XML_SetUserData(stream->parser, stream);
+  XML_SetElementHandler(stream->parser, start, end);
+  XML_SetCharacterDataHandler(stream->parser, _xml_write_stream_data);
+  return stream;
+}
+
+PXML_STREAM xml_serverinfo_stream(PSERVERINFO info, const char **error, char *message) {
+  PXML_STREAM stream = xml_stream_create(_xml_start_serverinfo_element, _xml_end_serverinfo_element, error, message);
+  if (stream == NULL)
+    return NULL;
+
+  memset(info, 0, sizeof(SERVERINFO));
+  stream->query.serverinfo.info = info;
+  stream->complete = xml_serverinfo_complete;
+  return stream;
+}
+
+PXML_STREAM xml_applist_stream(APP_CALLBACK callback, void *context, const char **error, char *message) {
+  PXML_STREAM stream = xml_stream_create(_xml_start_applist_element, _xml_end_applist_element, error, message);
+  if (stream == NULL)
+    return NULL;
+
+  stream->query.applist.callback = callback;
+  stream->query.applist.context = context;
+  return stream;
+}
+
+bool xml_stream_write(const char *chunk, size_t size, void *context) {
+  PXML_STREAM stream = (PXML_STREAM) context;
+  if (stream->failed)
+    return false;
+
+  if (! XML_Parse(stream->parser, chunk, size, 0)) {
+    int code = XML_GetErrorCode(stream->parser);
+    *stream->status.error = XML_ErrorString(code);
+    stream->failed = true;
+    return false;
+  }
+
+  return true;
+}
+
+int xml_stream_end(PXML_STREAM stream) {
+  if (!stream->failed && ! XML_Parse(stream->parser, NULL, 0, 1)) {
+    int code = XML_GetErrorCode(stream->parser);
+    *stream->status.error = XML_ErrorString(code);
+    stream->failed = true;
+  }
+
+  int ret = GS_OK;
+  if (stream->failed)
+    ret = GS_INVALID;
+  else if (stream->status.status != STATUS_OK)
+    ret = GS_ERROR;
+  else if (stream->complete != NULL)
+    ret = stream->complete(stream);
+
+  return ret;
+}
+
+void xml_stream_free(PXML_STREAM stream) {
+  if (stream == NULL)
+    return;
+
+  XML_ParserFree(stream->parser);
+  free(stream);
 }
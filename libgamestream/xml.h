@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h>
 
 typedef struct _APP_LIST {
   char* name;
@@ -33,7 +34,42 @@ typedef struct _DISPLAY_MODE {
   struct _DISPLAY_MODE *next;
 } DISPLAY_MODE, *PDISPLAY_MODE;
 
-int xml_search(char* data, size_t len, char* node, char** result);
-int xml_applist(char* data, size_t len, PAPP_LIST *app_list);
-int xml_modelist(char* data, size_t len, PDISPLAY_MODE *mode_list);
-int xml_status(char* data, size_t len);
+#define MAX_DISPLAY_MODES 32
+
+// Everything used from a serverinfo response, filled in a single pass
+// without allocating. modes links the used entries of mode_slots.
+typedef struct _SERVERINFO {
+  int currentGame;
+  bool paired;
+  bool codecModeSupport;
+  char appVersion[32];
+  char state[64];
+  char gpuType[64];
+  char gsVersion[32];
+  char gfeVersion[32];
+  PDISPLAY_MODE modes;
+  DISPLAY_MODE mode_slots[MAX_DISPLAY_MODES];
+} SERVERINFO, *PSERVERINFO;
+
+#define XML_MESSAGE_LENGTH 256
+
+// Parse errors are left in error. The status message of the host is copied
+// into message, a buffer of XML_MESSAGE_LENGTH the caller owns, and error
+// pointed at it.
+int xml_search(char* data, size_t len, char* node, char** result, const char **error);
+int xml_status(char* data, size_t len, const char **error, char *message);
+
+// A response parsed while it is received, pass xml_stream_write as the
+// writer of http_request_stream. xml_stream_end finishes the document and
+// checks its status, call it only when the whole response arrived.
+// xml_stream_free frees the stream either way.
+typedef struct _XML_STREAM XML_STREAM, *PXML_STREAM;
+
+// called for every App of an applist, name is only valid during the call
+typedef void (*APP_CALLBACK)(int id, const char *name, void *context);
+
+PXML_STREAM xml_serverinfo_stream(PSERVERINFO info, const char **error, char *message);
+PXML_STREAM xml_applist_stream(APP_CALLBACK callback, void *context, const char **error, char *message);
+bool xml_stream_write(const char *chunk, size_t size, void *context);
+int xml_stream_end(PXML_STREAM stream);
+void xml_stream_free(PXML_STREAM stream);
@@ -0,0 +1,95 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "buffer.h"
+
+#include <string.h>
+
+void pcm_ring_init(pcm_ring *ring, short *data, uint32_t frames) {
+  ring->data = data;
+  ring->mask = frames - 1;
+  ring->write = 0;
+  ring->read = 0;
+}
+
+uint32_t pcm_ring_fill_producer(const pcm_ring *ring) {
+  return ring->write - __atomic_load_n(&ring->read, __ATOMIC_ACQUIRE);
+}
+
+uint32_t pcm_ring_fill_consumer(const pcm_ring *ring) {
+  return __atomic_load_n(&ring->write, __ATOMIC_ACQUIRE) - ring->read;
+}
+
+// False when the frames don't fit, nothing is written then
+bool pcm_ring_push(pcm_ring *ring, const short *pcm, uint32_t frames) {
+  uint32_t size = ring->mask + 1;
+  uint32_t write = ring->write;
+  if (pcm_ring_fill_producer(ring) + frames > size) {
+    return false;
+  }
+
+  uint32_t offset = write & ring->mask;
+  uint32_t first = frames < size - offset ? frames : size - offset;
+  memcpy(&ring->data[2 * offset], pcm, first * 2 * sizeof(short));
+  memcpy(ring->data, pcm + 2 * first, (frames - first) * 2 * sizeof(short));
+
+  __atomic_store_n(&ring->write, write + frames, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Takes at most the frames buffered, returns how many
+uint32_t pcm_ring_pop(pcm_ring *ring, short *pcm, uint32_t frames) {
+  uint32_t size = ring->mask + 1;
+  uint32_t read = ring->read;
+  uint32_t fill = pcm_ring_fill_consumer(ring);
+  if (frames > fill) {
+    frames = fill;
+  }
+
+  uint32_t offset = read & ring->mask;
+  uint32_t first = frames < size - offset ? frames : size - offset;
+  memcpy(pcm, &ring->data[2 * offset], first * 2 * sizeof(short));
+  memcpy(pcm + 2 * first, ring->data, (frames - first) * 2 * sizeof(short));
+
+  __atomic_store_n(&ring->read, read + frames, __ATOMIC_RELEASE);
+  return frames;
+}
+
+void pcm_ring_drop(pcm_ring *ring, uint32_t frames) {
+  __atomic_store_n(&ring->read, ring->read + frames, __ATOMIC_RELEASE);
+}
+
+void audio_jitter_update(audio_jitter *jitter, uint64_t now_us, uint32_t packet_us) {
+  if (jitter->last_packet_us != 0) {
+    int64_t deviation = (int64_t) (now_us - jitter->last_packet_us) - packet_us;
+    if (deviation < 0) {
+      deviation = -deviation;
+    }
+    jitter->jitter_us += (deviation - (int64_t) jitter->jitter_us) / 16;
+  }
+  jitter->last_packet_us = now_us;
+}
+
+uint32_t audio_target_frames(uint32_t latency_frames, uint32_t jitter_frames, uint32_t output_frames, uint32_t max) {
+  uint32_t target = latency_frames + 2 * jitter_frames;
+  if (target < output_frames) {
+    target = output_frames;
+  } else if (target > max) {
+    target = max;
+  }
+  return target;
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Decoded PCM goes through a single producer, single consumer ring. The
+// receive thread decodes into it and a dedicated output thread drains it,
+// so a late wake-up of one side doesn't stall the other. Sizes are in
+// stereo frames, the ring holds a power of two of them.
+typedef struct {
+  short *data;
+  uint32_t mask;
+  // only the producer writes write, only the consumer writes read
+  uint32_t write;
+  uint32_t read;
+} pcm_ring;
+
+void pcm_ring_init(pcm_ring *ring, short *data, uint32_t frames);
+// Frames buffered, as seen by the producer or the consumer
+uint32_t pcm_ring_fill_producer(const pcm_ring *ring);
+uint32_t pcm_ring_fill_consumer(const pcm_ring *ring);
+bool pcm_ring_push(pcm_ring *ring, const short *pcm, uint32_t frames);
+uint32_t pcm_ring_pop(pcm_ring *ring, short *pcm, uint32_t frames);
+void pcm_ring_drop(pcm_ring *ring, uint32_t frames);
+
+// Deviation of packet arrivals from the previous packet's duration,
+// smoothed like the RTP interarrival jitter
+typedef struct {
+  uint32_t jitter_us;
+  uint64_t last_packet_us;
+} audio_jitter;
+
+void audio_jitter_update(audio_jitter *jitter, uint64_t now_us, uint32_t packet_us);
+
+// Amount of audio to build up before playing: the configured latency plus
+// twice the measured jitter, at least one output block and at most max
+uint32_t audio_target_frames(uint32_t latency_frames, uint32_t jitter_frames, uint32_t output_frames, uint32_t max);
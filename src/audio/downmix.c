@@ -0,0 +1,102 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "downmix.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline short saturate_s16(int32_t value) {
+  if (value > 32767) {
+    return 32767;
+  } else if (value < -32768) {
+    return -32768;
+  }
+  return value;
+}
+
+// Frames from first on
+static void audio_downmix_from(short *pcm, uint32_t first, uint32_t frames) {
+  for (uint32_t i = first; i < frames; i++) {
+    const short *in = &pcm[6 * i];
+    int32_t center = in[2] * DOWNMIX_CENTER;
+    pcm[2 * i] = saturate_s16((in[0] * DOWNMIX_FRONT + center + in[4] * DOWNMIX_BACK + (1 << 13)) >> 14);
+    pcm[2 * i + 1] = saturate_s16((in[1] * DOWNMIX_FRONT + center + in[5] * DOWNMIX_BACK + (1 << 13)) >> 14);
+  }
+}
+
+void audio_downmix_scalar(short *pcm, uint32_t frames) {
+  audio_downmix_from(pcm, 0, frames);
+}
+
+// Four frames at a time: 32 bit lanes hold the FL/FR, C/LFE and BL/BR
+// pairs, so front and back already line up with the stereo output. The
+// output of a block ends before the input of the next one starts.
+void audio_downmix(short *pcm, uint32_t frames) {
+  uint32_t i = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 4 <= frames; i += 4) {
+    uint32x4x3_t in = vld3q_u32((const uint32_t *) &pcm[6 * i]);
+    int16x8_t front = vreinterpretq_s16_u32(in.val[0]);
+    int16x8_t center = vreinterpretq_s16_u32(vsliq_n_u32(in.val[1], in.val[1], 16));
+    int16x8_t back = vreinterpretq_s16_u32(in.val[2]);
+
+    int32x4_t low = vmull_n_s16(vget_low_s16(front), DOWNMIX_FRONT);
+    low = vmlal_n_s16(low, vget_low_s16(center), DOWNMIX_CENTER);
+    low = vmlal_n_s16(low, vget_low_s16(back), DOWNMIX_BACK);
+    int32x4_t high = vmull_n_s16(vget_high_s16(front), DOWNMIX_FRONT);
+    high = vmlal_n_s16(high, vget_high_s16(center), DOWNMIX_CENTER);
+    high = vmlal_n_s16(high, vget_high_s16(back), DOWNMIX_BACK);
+
+    vst1q_s16(&pcm[2 * i], vcombine_s16(vqrshrn_n_s32(low, 14), vqrshrn_n_s32(high, 14)));
+  }
+#elif defined(__SSE2__)
+  const __m128i front_center = _mm_set1_epi32(DOWNMIX_CENTER << 16 | DOWNMIX_FRONT);
+  // the back weight next to the rounding, paired with ones
+  const __m128i back_round = _mm_set1_epi32((1 << 13) << 16 | DOWNMIX_BACK);
+  const __m128i ones = _mm_set1_epi16(1);
+  for (; i + 4 <= frames; i += 4) {
+    __m128 v0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) &pcm[6 * i]));
+    __m128 v1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) &pcm[6 * i + 8]));
+    __m128 v2 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) &pcm[6 * i + 16]));
+
+    // take every third lane apart into front, centre and back
+    __m128 t = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128i front = _mm_castps_si128(_mm_shuffle_ps(v0, t, _MM_SHUFFLE(2, 0, 3, 0)));
+    __m128 u = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 1, 1));
+    t = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 2, 3, 3));
+    __m128i center = _mm_castps_si128(_mm_shuffle_ps(u, t, _MM_SHUFFLE(2, 0, 2, 0)));
+    u = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128i back = _mm_castps_si128(_mm_shuffle_ps(u, v2, _MM_SHUFFLE(3, 0, 2, 0)));
+
+    // C/LFE to C/C, for both outputs
+    center = _mm_shufflehi_epi16(_mm_shufflelo_epi16(center, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+
+    __m128i low = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(front, center), front_center),
+                                _mm_madd_epi16(_mm_unpacklo_epi16(back, ones), back_round));
+    __m128i high = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(front, center), front_center),
+                                 _mm_madd_epi16(_mm_unpackhi_epi16(back, ones), back_round));
+    _mm_storeu_si128((__m128i *) &pcm[2 * i], _mm_packs_epi32(_mm_srai_epi32(low, 14), _mm_srai_epi32(high, 14)));
+  }
+#endif
+
+  audio_downmix_from(pcm, i, frames);
+}
@@ -0,0 +1,31 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// ITU-R BS.775 downmix weights, scaled so a full scale front, centre and
+// back channel on one side do not clip. Q14, the LFE is left out.
+#define DOWNMIX_FRONT 6786
+#define DOWNMIX_CENTER 4799
+#define DOWNMIX_BACK 4799
+
+// Downmixes 5.1 frames in FL, FR, C, LFE, BL, BR order to stereo in place.
+// The vectorized version gives the same result as the scalar one.
+void audio_downmix(short *pcm, uint32_t frames);
+void audio_downmix_scalar(short *pcm, uint32_t frames);
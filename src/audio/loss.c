@@ -0,0 +1,70 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loss.h"
+
+#include <stddef.h>
+
+void audio_loss_init(audio_loss *loss, audio_decode_cb decode, void *context, uint32_t packet_frames, int max_frames) {
+  loss->decode = decode;
+  loss->context = context;
+  loss->max_frames = max_frames;
+  loss->packet_frames = packet_frames;
+  loss->pending = 0;
+  loss->received = 0;
+  loss->lost = 0;
+  loss->concealed = 0;
+  loss->recovered = 0;
+}
+
+// Let the decoder extrapolate audio for lost packets, as long as the
+// packets around them
+static void audio_loss_conceal(audio_loss *loss, int count) {
+  for (int i = 0; i < count; i++) {
+    if (loss->decode(loss->context, NULL, 0, loss->packet_frames, 0) > 0) {
+      loss->concealed++;
+    }
+  }
+}
+
+void audio_loss_packet_lost(audio_loss *loss) {
+  loss->lost++;
+  if (loss->pending == AUDIO_MAX_PENDING_LOSSES) {
+    audio_loss_conceal(loss, 1);
+  } else {
+    loss->pending++;
+  }
+}
+
+int audio_loss_packet(audio_loss *loss, const unsigned char *data, int length, int frames) {
+  loss->received++;
+  if (frames > 0 && frames <= loss->max_frames) {
+    loss->packet_frames = frames;
+  }
+
+  if (loss->pending > 0) {
+    audio_loss_conceal(loss, loss->pending - 1);
+    loss->pending = 0;
+
+    // without FEC data in the packet this falls back to concealment
+    if (loss->decode(loss->context, data, length, loss->packet_frames, 1) > 0) {
+      loss->recovered++;
+    }
+  }
+
+  return loss->decode(loss->context, data, length, loss->max_frames, 0);
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Decodes a packet, or conceals a lost one when data is NULL, into at most
+// frames stereo frames and plays the result. Returns the frames played or
+// a negative error, like opus_multistream_decode.
+typedef int (*audio_decode_cb)(void *context, const unsigned char *data, int length, int frames, int fec);
+
+// Lost packets are concealed once the next packet arrives, so the last one
+// can be rebuilt from the FEC data the following packet carries. Longer
+// losses are concealed right away.
+#define AUDIO_MAX_PENDING_LOSSES 4
+
+typedef struct {
+  audio_decode_cb decode;
+  void *context;
+  // largest packet the decoder accepts
+  int max_frames;
+  // length of the last packet, also used for concealment and FEC
+  uint32_t packet_frames;
+  int pending;
+  uint32_t received;
+  uint32_t lost;
+  uint32_t concealed;
+  uint32_t recovered;
+} audio_loss;
+
+void audio_loss_init(audio_loss *loss, audio_decode_cb decode, void *context, uint32_t packet_frames, int max_frames);
+void audio_loss_packet_lost(audio_loss *loss);
+// frames is the packet length from opus_packet_get_nb_samples. Returns the
+// result of decoding the packet itself.
+int audio_loss_packet(audio_loss *loss, const unsigned char *data, int length, int frames);
@@ -0,0 +1,157 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resample.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void audio_resampler_reset(audio_resampler *resampler) {
+  resampler->staged = 0;
+  resampler->pos = 0;
+  resampler->step = 1ULL << 32;
+  resampler->fill_average = 0;
+  resampler->drift_ppm = 0;
+  resampler->prebuffering = true;
+}
+
+// Number of ring frames the next block of output frames needs
+static uint32_t audio_resampler_input(const audio_resampler *resampler, uint32_t frames) {
+  uint32_t last = ((resampler->pos + (frames - 1) * resampler->step) >> 32) + 1;
+  uint32_t consumed = (resampler->pos + frames * resampler->step) >> 32;
+  uint32_t staged = (last > consumed ? last : consumed) + 1;
+  return staged > resampler->staged ? staged - resampler->staged : 0;
+}
+
+static void audio_resampler_update_drift(audio_resampler *resampler, uint32_t fill, uint32_t target) {
+  int32_t buffered = fill + resampler->staged;
+  resampler->fill_average += ((buffered << 8) - resampler->fill_average) / 32;
+
+  int32_t error = (resampler->fill_average >> 8) - (int32_t) target;
+  int64_t ppm = (int64_t) error * 2 * RESAMPLE_MAX_DRIFT_PPM / (int32_t) target;
+  if (ppm > RESAMPLE_MAX_DRIFT_PPM) {
+    ppm = RESAMPLE_MAX_DRIFT_PPM;
+  } else if (ppm < -RESAMPLE_MAX_DRIFT_PPM) {
+    ppm = -RESAMPLE_MAX_DRIFT_PPM;
+  }
+
+  resampler->drift_ppm = ppm;
+  resampler->step = (1LL << 32) + ppm * (1LL << 32) / 1000000;
+}
+
+uint64_t audio_resample_interpolate_scalar(short *pcm, const short *input, uint64_t pos, uint64_t step, uint32_t frames) {
+  for (uint32_t i = 0; i < frames; i++) {
+    const short *a = &input[2 * (pos >> 32)];
+    int32_t frac = (pos >> 17) & 0x7fff;
+    pcm[2 * i] = a[0] + (((a[2] - a[0]) * frac) >> 15);
+    pcm[2 * i + 1] = a[1] + (((a[3] - a[1]) * frac) >> 15);
+    pos += step;
+  }
+  return pos;
+}
+
+// The difference of two samples needs 17 bits, so it is never formed in
+// 16 bit lanes: (b - a) * frac is computed as b * frac + a * -frac in 32
+// bits, which is exact, and shifted like the scalar code.
+uint64_t audio_resample_interpolate(short *pcm, const short *input, uint64_t pos, uint64_t step, uint32_t frames) {
+  uint32_t i = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  // Two frames at a time, each load holds a frame and the next one
+  for (; i + 2 <= frames; i += 2) {
+    int16x4_t x0 = vld1_s16(&input[2 * (pos >> 32)]);
+    int32_t f0 = (pos >> 17) & 0x7fff;
+    pos += step;
+    int16x4_t x1 = vld1_s16(&input[2 * (pos >> 32)]);
+    int32_t f1 = (pos >> 17) & 0x7fff;
+    pos += step;
+
+    int32x2x2_t ab = vzip_s32(vreinterpret_s32_s16(x0), vreinterpret_s32_s16(x1));
+    int16x4_t a = vreinterpret_s16_s32(ab.val[0]);
+    int16x4_t b = vreinterpret_s16_s32(ab.val[1]);
+    int32x4_t frac = vcombine_s32(vdup_n_s32(f0), vdup_n_s32(f1));
+    int32x4_t delta = vshrq_n_s32(vmulq_s32(vsubl_s16(b, a), frac), 15);
+    vst1_s16(&pcm[2 * i], vmovn_s32(vaddw_s16(delta, a)));
+  }
+#elif defined(__SSE2__)
+  // Four frames at a time, each 64 bit load holds a frame and the next one.
+  // The fractions come from the low half of the positions, kept in lanes.
+  __m128i low = _mm_set_epi32(pos + 3 * step, pos + 2 * step, pos + step, pos);
+  __m128i low_step = _mm_set1_epi32(4 * step);
+  for (; i + 4 <= frames; i += 4) {
+    __m128i x0 = _mm_loadl_epi64((const __m128i *) &input[2 * (pos >> 32)]);
+    __m128i x1 = _mm_loadl_epi64((const __m128i *) &input[2 * ((pos + step) >> 32)]);
+    __m128i x2 = _mm_loadl_epi64((const __m128i *) &input[2 * ((pos + 2 * step) >> 32)]);
+    __m128i x3 = _mm_loadl_epi64((const __m128i *) &input[2 * ((pos + 3 * step) >> 32)]);
+    pos += 4 * step;
+
+    // b and a of each channel next to each other, a in the upper half
+    __m128i y0 = _mm_unpacklo_epi64(x0, x1);
+    __m128i y1 = _mm_unpacklo_epi64(x2, x3);
+    y0 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(y0, _MM_SHUFFLE(1, 3, 0, 2)), _MM_SHUFFLE(1, 3, 0, 2));
+    y1 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(y1, _MM_SHUFFLE(1, 3, 0, 2)), _MM_SHUFFLE(1, 3, 0, 2));
+
+    // frac in the lower and -frac in the upper half of each lane
+    __m128i frac = _mm_srli_epi32(low, 17);
+    frac = _mm_sub_epi32(frac, _mm_slli_epi32(frac, 16));
+    low = _mm_add_epi32(low, low_step);
+
+    __m128i out0 = _mm_madd_epi16(y0, _mm_unpacklo_epi32(frac, frac));
+    __m128i out1 = _mm_madd_epi16(y1, _mm_unpackhi_epi32(frac, frac));
+    out0 = _mm_add_epi32(_mm_srai_epi32(out0, 15), _mm_srai_epi32(y0, 16));
+    out1 = _mm_add_epi32(_mm_srai_epi32(out1, 15), _mm_srai_epi32(y1, 16));
+    _mm_storeu_si128((__m128i *) &pcm[2 * i], _mm_packs_epi32(out0, out1));
+  }
+#endif
+
+  return audio_resample_interpolate_scalar(&pcm[2 * i], input, pos, step, frames - i);
+}
+
+audio_block audio_resampler_block(audio_resampler *resampler, pcm_ring *ring, uint32_t target, short *pcm, uint32_t frames) {
+  uint32_t fill = pcm_ring_fill_consumer(ring);
+
+  if (resampler->prebuffering) {
+    if (fill < target) {
+      return AUDIO_BLOCK_PREBUFFERING;
+    }
+    resampler->fill_average = (fill + resampler->staged) << 8;
+    resampler->prebuffering = false;
+  }
+
+  // the step for this block decides how much input it needs
+  audio_resampler_update_drift(resampler, fill, target);
+  uint32_t input = audio_resampler_input(resampler, frames);
+  if (fill < input) {
+    resampler->prebuffering = true;
+    return AUDIO_BLOCK_UNDERRUN;
+  }
+
+  resampler->staged += pcm_ring_pop(ring, &resampler->buffer[2 * resampler->staged], input);
+  uint64_t pos = audio_resample_interpolate(pcm, resampler->buffer, resampler->pos, resampler->step, frames);
+
+  // keep the frames the next block starts with
+  uint32_t consumed = pos >> 32;
+  resampler->staged -= consumed;
+  memmove(resampler->buffer, &resampler->buffer[2 * consumed], resampler->staged * 2 * sizeof(short));
+  resampler->pos = pos & 0xffffffff;
+  return AUDIO_BLOCK_PLAYED;
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "buffer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host and Vita audio clocks drift apart by a few hundred ppm, which
+// slowly fills or drains the ring. The output side therefore plays the
+// ring back at a rate nudged by how far the buffered audio is off the
+// target. Half a target off means the full correction, which is small
+// enough not to be heard as a pitch change.
+#define RESAMPLE_MAX_DRIFT_PPM 1000
+// largest output block
+#define RESAMPLE_MAX_FRAMES 2048
+
+typedef struct {
+  // input frames for the next output block, the first one at position 0
+  short buffer[2 * (RESAMPLE_MAX_FRAMES + 16)];
+  uint32_t staged;
+  // position of the next output frame and input frames per output frame, Q32
+  uint64_t pos;
+  uint64_t step;
+  // buffered frames, Q8
+  int32_t fill_average;
+  int32_t drift_ppm;
+  // building up the target before playing
+  bool prebuffering;
+} audio_resampler;
+
+typedef enum {
+  AUDIO_BLOCK_PLAYED,
+  AUDIO_BLOCK_PREBUFFERING,
+  AUDIO_BLOCK_UNDERRUN,
+} audio_block;
+
+void audio_resampler_reset(audio_resampler *resampler);
+// Fills pcm with the next block of output frames from the ring, once
+// target frames are buffered. Only called by the consumer of the ring.
+audio_block audio_resampler_block(audio_resampler *resampler, pcm_ring *ring, uint32_t target, short *pcm, uint32_t frames);
+
+// Linear interpolation of stereo frames from input starting at pos, Q32,
+// in steps of step. Returns the position after the last output frame. The
+// vectorized version gives the same result as the scalar one.
+uint64_t audio_resample_interpolate(short *pcm, const short *input, uint64_t pos, uint64_t step, uint32_t frames);
+uint64_t audio_resample_interpolate_scalar(short *pcm, const short *input, uint64_t pos, uint64_t step, uint32_t frames);
@@ -18,30 +18,198 @@
  */
 
 #include "../audio.h"
+#include "../config.h"
 #include "../debug.h"
+#include "buffer.h"
+#include "downmix.h"
+#include "loss.h"
+#include "resample.h"
+#include "vita.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <opus/opus_multistream.h>
 #include <psp2/audioout.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
 
 enum {
   VITA_AUDIO_INIT_OK        = 0,
   VITA_AUDIO_ERROR_BAD_OPUS = 0x80020001,
   VITA_AUDIO_ERROR_PORT     = 0x80020002,
+  VITA_AUDIO_ERROR_THREAD   = 0x80020003,
 };
 
-#define FRAME_SIZE 240
-#define VITA_SAMPLES 960
-#define BUFFER_SIZE (2 * VITA_SAMPLES)
-static int decode_offset;
-static int port;
+#define SAMPLE_RATE 48000
+// Opus packets last anything from 2.5 ms up to 120 ms
+#define MAX_FRAME_SIZE 5760
+#define DEFAULT_FRAME_SIZE 240
+// sceAudioOutOutput takes blocks in multiples of 64 frames
+#define MIN_OUTPUT_FRAMES 256
+#define MAX_OUTPUT_FRAMES RESAMPLE_MAX_FRAMES
+
+// The decoder pushes into the ring, the output thread drains it into the
+// blocking sceAudioOutOutput
+#define RING_FRAMES 16384
+
+static short ring_data[2 * RING_FRAMES];
+static pcm_ring ring;
+
+// Amount of audio the output thread builds up before it starts playing.
+// Written by the decoder, read by the output thread.
+static volatile uint32_t target_frames;
+static audio_jitter packet_jitter;
+
+static uint32_t underruns;
+static uint32_t overruns;
+
+// Frames per block handed to the audio port, from the config
+static uint32_t output_frames;
+
+// Decode time per packet length, 2.5 ms to 60 ms and the rest
+#define PACKET_SIZES 7
+
+static const uint32_t packet_sizes[PACKET_SIZES - 1] = {120, 240, 480, 960, 1920, 2880};
+static uint64_t decode_time_us[PACKET_SIZES];
+static uint64_t decode_frames[PACKET_SIZES];
+
+// Concealment and FEC for lost packets, also tracks the packet length
+static audio_loss loss;
+
+static int port = -1;
+static SceUID output_thread = -1;
+static bool active_output_thread = false;
 
 static int active_audio_thread = true;
 static OpusMSDecoder* decoder = NULL;
 
-static short buffer[BUFFER_SIZE];
+// 5.1 streams are decoded to FL, FR, C, LFE, BL, BR and downmixed to
+// stereo in place
+#define MAX_CHANNELS 6
+
+static int channel_count;
+
+static short decode_buffer[MAX_CHANNELS * MAX_FRAME_SIZE];
+static short output_buffer[2 * MAX_OUTPUT_FRAMES];
+
+// Plays the ring back slightly faster or slower to follow the host clock.
+// Only used by the output thread.
+static audio_resampler resampler;
+
+static uint32_t ms_to_frames(uint32_t ms) {
+  return ms * (SAMPLE_RATE / 1000);
+}
+
+static void vita_audio_update_target() {
+  target_frames = audio_target_frames(ms_to_frames(config.audio_latency),
+                                      packet_jitter.jitter_us * (SAMPLE_RATE / 1000) / 1000,
+                                      output_frames, RING_FRAMES - MAX_FRAME_SIZE);
+}
+
+static void vita_audio_ring_push(const short *pcm, uint32_t frames) {
+  // drop the packet when the output thread fell far behind the target, or
+  // instead of overwriting audio that is about to play
+  if (pcm_ring_fill_producer(&ring) > 2 * target_frames + output_frames ||
+      !pcm_ring_push(&ring, pcm, frames)) {
+    overruns++;
+  }
+}
+
+static int vita_audio_packet_size_index(uint32_t frames) {
+  int i;
+  for (i = 0; i < PACKET_SIZES - 1; i++) {
+    if (packet_sizes[i] == frames) {
+      break;
+    }
+  }
+  return i;
+}
+
+static int vita_audio_decode(const unsigned char *data, int length, int frames, int fec) {
+  uint64_t start = sceKernelGetProcessTimeWide();
+  int decodeLen = opus_multistream_decode(decoder, data, length, decode_buffer, frames, fec);
+  if (decodeLen > 0) {
+    int i = vita_audio_packet_size_index(decodeLen);
+    decode_time_us[i] += sceKernelGetProcessTimeWide() - start;
+    decode_frames[i] += decodeLen;
+    if (channel_count == MAX_CHANNELS) {
+      audio_downmix(decode_buffer, decodeLen);
+    }
+  }
+  return decodeLen;
+}
+
+static int vita_audio_decode_and_push(void *context, const unsigned char *data, int length, int frames, int fec) {
+  int decodeLen = vita_audio_decode(data, length, frames, fec);
+  if (decodeLen > 0) {
+    vita_audio_ring_push(decode_buffer, decodeLen);
+  }
+  return decodeLen;
+}
+
+static int vita_audio_output_thread_main(SceSize args, void *argp) {
+  while (active_output_thread) {
+    if (!active_audio_thread) {
+      // throw away what arrives while the stream is paused
+      pcm_ring_drop(&ring, pcm_ring_fill_consumer(&ring));
+      audio_resampler_reset(&resampler);
+      sceKernelDelayThread(output_frames * 1000000 / SAMPLE_RATE);
+      continue;
+    }
+
+    switch (audio_resampler_block(&resampler, &ring, target_frames, output_buffer, output_frames)) {
+    case AUDIO_BLOCK_PREBUFFERING:
+      sceKernelDelayThread(1000);
+      break;
+    case AUDIO_BLOCK_UNDERRUN:
+      underruns++;
+      break;
+    case AUDIO_BLOCK_PLAYED:
+      sceAudioOutOutput(port, output_buffer);
+      break;
+    }
+  }
+  return 0;
+}
 
 static void vita_renderer_cleanup() {
+  if (output_thread >= 0) {
+    active_output_thread = false;
+    // wait 1sec
+    SceUInt timeout = 1000000;
+    int ret;
+    sceKernelWaitThreadEnd(output_thread, &ret, &timeout);
+    sceKernelDeleteThread(output_thread);
+    output_thread = -1;
+
+    vita_debug_log("audio: %u underruns, %u overruns, jitter %u us, target %u frames, drift %d ppm\n",
+                   underruns, overruns, packet_jitter.jitter_us, target_frames, resampler.drift_ppm);
+    uint32_t packets = loss.received + loss.lost;
+    vita_debug_log("audio: %u packets, %u lost (%u.%02u%%), %u concealed, %u recovered with fec\n",
+                   packets, loss.lost,
+                   packets ? loss.lost * 100 / packets : 0,
+                   packets ? loss.lost * 10000 / packets % 100 : 0,
+                   loss.concealed, loss.recovered);
+    for (int i = 0; i < PACKET_SIZES; i++) {
+      if (decode_frames[i] == 0) {
+        continue;
+      }
+      // decode cost per second of audio
+      uint32_t cost_us = decode_time_us[i] * SAMPLE_RATE / decode_frames[i];
+      if (i < PACKET_SIZES - 1) {
+        vita_debug_log("audio: %u frame packets, %u ms decoded, %u us decode time per second\n",
+                       packet_sizes[i], (uint32_t) (decode_frames[i] * 1000 / SAMPLE_RATE), cost_us);
+      } else {
+        vita_debug_log("audio: other packets, %u ms decoded, %u us decode time per second\n",
+                       (uint32_t) (decode_frames[i] * 1000 / SAMPLE_RATE), cost_us);
+      }
+    }
+  }
+  if (port >= 0) {
+    sceAudioOutReleasePort(port);
+    port = -1;
+  }
   if (decoder != NULL) {
     opus_multistream_decoder_destroy(decoder);
     decoder = NULL;
@@ -50,6 +218,11 @@ static void vita_renderer_cleanup() {
 
 static int vita_renderer_init(int audioConfiguration, POPUS_MULTISTREAM_CONFIGURATION opusConfig, void* audioContext, int arFlags) {
   int rc;
+  if (opusConfig->channelCount != 2 && opusConfig->channelCount != MAX_CHANNELS) {
+    return VITA_AUDIO_ERROR_BAD_OPUS;
+  }
+  channel_count = opusConfig->channelCount;
+
   decoder = opus_multistream_decoder_create(opusConfig->sampleRate,
                                             opusConfig->channelCount,
                                             opusConfig->streams,
@@ -61,34 +234,57 @@ static int vita_renderer_init(int audioConfiguration, POPUS_MULTISTREAM_CONFIGUR
       return VITA_AUDIO_ERROR_BAD_OPUS;
   }
 
-  port = sceAudioOutOpenPort(SCE_AUDIO_OUT_PORT_TYPE_MAIN, VITA_SAMPLES, 48000, SCE_AUDIO_OUT_PARAM_FORMAT_S16_STEREO);
+  output_frames = config.audio_frame_size & ~63;
+  if (output_frames < MIN_OUTPUT_FRAMES) {
+    output_frames = MIN_OUTPUT_FRAMES;
+  } else if (output_frames > MAX_OUTPUT_FRAMES) {
+    output_frames = MAX_OUTPUT_FRAMES;
+  }
+
+  port = sceAudioOutOpenPort(SCE_AUDIO_OUT_PORT_TYPE_MAIN, output_frames, SAMPLE_RATE, SCE_AUDIO_OUT_PARAM_FORMAT_S16_STEREO);
 
   if (port < 0) {
       vita_renderer_cleanup();
       return VITA_AUDIO_ERROR_PORT;
   }
 
-  vita_debug_log("open port 0x%x\n", port);
+  vita_debug_log("open port 0x%x, %u frames per block\n", port, output_frames);
+
+  pcm_ring_init(&ring, ring_data, RING_FRAMES);
+  memset(&packet_jitter, 0, sizeof(packet_jitter));
+  underruns = 0;
+  overruns = 0;
+  memset(decode_time_us, 0, sizeof(decode_time_us));
+  memset(decode_frames, 0, sizeof(decode_frames));
+  audio_resampler_reset(&resampler);
+  audio_loss_init(&loss, vita_audio_decode_and_push, NULL, DEFAULT_FRAME_SIZE, MAX_FRAME_SIZE);
+  vita_audio_update_target();
+
+  output_thread = sceKernelCreateThread("audio_output", vita_audio_output_thread_main, 0x40, 0x10000, 0, 0, NULL);
+  if (output_thread < 0) {
+      vita_debug_log("sceKernelCreateThread 0x%x\n", output_thread);
+      vita_renderer_cleanup();
+      return VITA_AUDIO_ERROR_THREAD;
+  }
+  active_output_thread = true;
+  sceKernelStartThread(output_thread, 0, NULL);
+
   return VITA_AUDIO_INIT_OK;
 }
 
 static void vita_renderer_decode_and_play_sample(char* data, int length) {
-  if (!data)
+  if (!data) {
+    audio_loss_packet_lost(&loss);
     return;
+  }
 
-  int decodeLen = opus_multistream_decode(decoder, data, length, buffer + 2 * decode_offset, FRAME_SIZE, 0);
-  if (decodeLen > 0) {
-    if (decodeLen != FRAME_SIZE)
-      return;
-    decode_offset += decodeLen;
-
-    if (decode_offset == VITA_SAMPLES) {
-      decode_offset = 0;
-      if (active_audio_thread) {
-        sceAudioOutOutput(port, buffer);
-      }
-    }
-  } else {
+  // arrival jitter against the length of the previous packet
+  audio_jitter_update(&packet_jitter, sceKernelGetProcessTimeWide(), loss.packet_frames * 1000000 / SAMPLE_RATE);
+
+  int frames = opus_packet_get_nb_samples((unsigned char *) data, length, SAMPLE_RATE);
+  int decodeLen = audio_loss_packet(&loss, (unsigned char *) data, length, frames);
+  vita_audio_update_target();
+  if (decodeLen <= 0) {
     vita_debug_log("Opus error from decode: %d\n", decodeLen);
   }
 }
@@ -108,3 +304,10 @@ void vitaaudio_start() {
 void vitaaudio_stop() {
   active_audio_thread = false;
 }
+
+void vitaaudio_get_stats(uint32_t *underrun_count, uint32_t *overrun_count, uint32_t *jitter, uint32_t *target) {
+  *underrun_count = underruns;
+  *overrun_count = overruns;
+  *jitter = packet_jitter.jitter_us;
+  *target = target_frames;
+}
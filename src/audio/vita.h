@@ -1,4 +1,5 @@
-
+#include <stdint.h>
 
 void vitaaudio_start();
 void vitaaudio_stop();
+void vitaaudio_get_stats(uint32_t *underrun_count, uint32_t *overrun_count, uint32_t *jitter, uint32_t *target);
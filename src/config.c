@@ -81,6 +81,28 @@ static int ini_handle(void *out, const char *section, const char *name,
     } else if (strcmp(name, "size") == 0) {
       config->special_keys.size = INT(value);
     }
+  } else if (strcmp(section, "gestures") == 0) {
+    if (strcmp(name, "tap") == 0) {
+      config->gestures.tap = HEX(value);
+    } else if (strcmp(name, "double_tap") == 0) {
+      config->gestures.double_tap = HEX(value);
+    } else if (strcmp(name, "two_finger_tap") == 0) {
+      config->gestures.two_finger_tap = HEX(value);
+    } else if (strcmp(name, "drag") == 0) {
+      config->gestures.drag = HEX(value);
+    } else if (strcmp(name, "pinch_in") == 0) {
+      config->gestures.pinch_in = HEX(value);
+    } else if (strcmp(name, "pinch_out") == 0) {
+      config->gestures.pinch_out = HEX(value);
+    } else if (strcmp(name, "edge_left") == 0) {
+      config->gestures.edge_left = HEX(value);
+    } else if (strcmp(name, "edge_right") == 0) {
+      config->gestures.edge_right = HEX(value);
+    } else if (strcmp(name, "edge_top") == 0) {
+      config->gestures.edge_top = HEX(value);
+    } else if (strcmp(name, "edge_bottom") == 0) {
+      config->gestures.edge_bottom = HEX(value);
+    }
   } else {
     if (strcmp(name, "address") == 0) {
       config->address = STR(value);
@@ -96,6 +118,8 @@ static int ini_handle(void *out, const char *section, const char *name,
       config->sops = BOOL(value);
     } else if (strcmp(name, "localaudio") == 0) {
       config->localaudio = BOOL(value);
+    } else if (strcmp(name, "surround") == 0) {
+      config->stream.audioConfiguration = BOOL(value) ? AUDIO_CONFIGURATION_51_SURROUND : AUDIO_CONFIGURATION_STEREO;
     } else if (strcmp(name, "enable_frame_pacer") == 0) {
       config->enable_frame_pacer = BOOL(value);
     } else if (strcmp(name, "center_region_only") == 0) {
@@ -106,18 +130,44 @@ static int ini_handle(void *out, const char *section, const char *name,
       config->jp_layout = BOOL(value);
     } else if (strcmp(name, "show_fps") == 0) {
       config->show_fps = BOOL(value);
+    } else if (strcmp(name, "show_latency") == 0) {
+      config->show_latency = BOOL(value);
     } else if (strcmp(name, "save_debug_log") == 0) {
       config->save_debug_log = BOOL(value);
     } else if (strcmp(name, "mapping") == 0) {
       config->mapping = STR(value);
     } else if (strcmp(name, "mouse_acceleration") == 0) {
       config->mouse_acceleration = INT(value);
+    } else if (strcmp(name, "mouse_curve") == 0) {
+      config->mouse_curve = INT(value);
+    } else if (strcmp(name, "left_deadzone") == 0) {
+      config->left_deadzone = INT(value);
+    } else if (strcmp(name, "right_deadzone") == 0) {
+      config->right_deadzone = INT(value);
+    } else if (strcmp(name, "anti_deadzone") == 0) {
+      config->anti_deadzone = INT(value);
+    } else if (strcmp(name, "stick_curve") == 0) {
+      config->stick_curve = INT(value);
+    } else if (strcmp(name, "input_rate") == 0) {
+      config->input_rate = INT(value);
+    } else if (strcmp(name, "input_align") == 0) {
+      config->input_align = BOOL(value);
+    } else if (strcmp(name, "record_input") == 0) {
+      config->record_input = BOOL(value);
+    } else if (strcmp(name, "input_replay") == 0) {
+      config->input_replay = STR(value);
     } else if (strcmp(name, "enable_ref_frame_invalidation") == 0) {
       config->enable_ref_frame_invalidation = BOOL(value);
     } else if (strcmp(name, "enable_remote_stream_optimization") == 0) {
       config->stream.streamingRemotely = INT(value);
     } else if (strcmp(name, "enable_vita_vblank_wait") == 0) {
       config->enable_vita_vblank_wait = BOOL(value);
+    } else if (strcmp(name, "low_latency_pacing") == 0) {
+      config->low_latency_pacing = BOOL(value);
+    } else if (strcmp(name, "audio_latency") == 0) {
+      config->audio_latency = INT(value);
+    } else if (strcmp(name, "audio_frame_size") == 0) {
+      config->audio_frame_size = INT(value);
     }
   }
 }
@@ -153,6 +203,8 @@ void config_save(const char* filename, PCONFIGURATION config) {
     write_config_bool(fd, "sops", config->sops);
   if (config->localaudio)
     write_config_bool(fd, "localaudio", config->localaudio);
+  if (config->stream.audioConfiguration == AUDIO_CONFIGURATION_51_SURROUND)
+    write_config_bool(fd, "surround", true);
 
   if (strcmp(config->app, "Steam") != 0)
     write_config_string(fd, "app", config->app);
@@ -162,12 +214,27 @@ void config_save(const char* filename, PCONFIGURATION config) {
   write_config_bool(fd, "disable_powersave", config->disable_powersave);
   write_config_bool(fd, "jp_layout", config->jp_layout);
   write_config_bool(fd, "show_fps", config->show_fps);
+  write_config_bool(fd, "show_latency", config->show_latency);
   write_config_bool(fd, "save_debug_log", config->save_debug_log);
 
   write_config_int(fd, "mouse_acceleration", config->mouse_acceleration);
+  write_config_int(fd, "mouse_curve", config->mouse_curve);
+  write_config_int(fd, "left_deadzone", config->left_deadzone);
+  write_config_int(fd, "right_deadzone", config->right_deadzone);
+  write_config_int(fd, "anti_deadzone", config->anti_deadzone);
+  write_config_int(fd, "stick_curve", config->stick_curve);
+  write_config_int(fd, "input_rate", config->input_rate);
+  write_config_bool(fd, "input_align", config->input_align);
+  if (config->record_input)
+    write_config_bool(fd, "record_input", config->record_input);
+  if (config->input_replay)
+    write_config_string(fd, "input_replay", config->input_replay);
   write_config_bool(fd, "enable_ref_frame_invalidation", config->enable_ref_frame_invalidation);
   write_config_int(fd, "enable_remote_stream_optimization", config->stream.streamingRemotely);
   write_config_bool(fd, "enable_vita_vblank_wait", config->enable_vita_vblank_wait);
+  write_config_bool(fd, "low_latency_pacing", config->low_latency_pacing);
+  write_config_int(fd, "audio_latency", config->audio_latency);
+  write_config_int(fd, "audio_frame_size", config->audio_frame_size);
 
   write_config_section(fd, "backtouchscreen_deadzone");
   write_config_int(fd, "top",     config->back_deadzone.top);
@@ -183,6 +250,18 @@ void config_save(const char* filename, PCONFIGURATION config) {
   write_config_int(fd, "offset",  config->special_keys.offset);
   write_config_int(fd, "size",    config->special_keys.size);
 
+  write_config_section(fd, "gestures");
+  write_config_hex(fd, "tap",             config->gestures.tap);
+  write_config_hex(fd, "double_tap",      config->gestures.double_tap);
+  write_config_hex(fd, "two_finger_tap",  config->gestures.two_finger_tap);
+  write_config_hex(fd, "drag",            config->gestures.drag);
+  write_config_hex(fd, "pinch_in",        config->gestures.pinch_in);
+  write_config_hex(fd, "pinch_out",       config->gestures.pinch_out);
+  write_config_hex(fd, "edge_left",       config->gestures.edge_left);
+  write_config_hex(fd, "edge_right",      config->gestures.edge_right);
+  write_config_hex(fd, "edge_top",        config->gestures.edge_top);
+  write_config_hex(fd, "edge_bottom",     config->gestures.edge_bottom);
+
   fclose(fd);
 }
 
@@ -223,6 +302,7 @@ void config_parse(int argc, char* argv[], PCONFIGURATION config) {
   config->disable_powersave = true;
   config->jp_layout = false;
   config->show_fps = false;
+  config->show_latency = false;
   config->enable_frame_pacer = true;
   config->center_region_only = false;
 
@@ -231,9 +311,26 @@ void config_parse(int argc, char* argv[], PCONFIGURATION config) {
   config->special_keys.offset = 0;
   config->special_keys.size = 150;
 
+  config->gestures.tap = BUTTON_LEFT | INPUT_TYPE_MOUSE;
+  config->gestures.double_tap = BUTTON_LEFT | INPUT_TYPE_MOUSE;
+  config->gestures.two_finger_tap = BUTTON_RIGHT | INPUT_TYPE_MOUSE;
+  config->gestures.drag = BUTTON_LEFT | INPUT_TYPE_MOUSE;
+
   config->mouse_acceleration = 150;
+  config->mouse_curve = 0;
+  config->left_deadzone = 5;
+  config->right_deadzone = 5;
+  config->anti_deadzone = 0;
+  config->stick_curve = 100;
+  config->input_rate = 200;
+  config->input_align = false;
+  config->record_input = false;
+  config->input_replay = NULL;
   config->enable_ref_frame_invalidation = false;
   config->enable_vita_vblank_wait = false;
+  config->low_latency_pacing = false;
+  config->audio_latency = 40;
+  config->audio_frame_size = 960;
 
   config->inputsCount = 0;
   config->mapping = NULL;
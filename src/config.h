@@ -41,6 +41,13 @@ struct special_keys {
   unsigned int nw, ne, sw, se;
 };
 
+// actions use the special key codes, 0 does nothing
+struct gestures {
+  unsigned int tap, double_tap, two_finger_tap, drag;
+  unsigned int pinch_in, pinch_out;
+  unsigned int edge_left, edge_right, edge_top, edge_bottom;
+};
+
 typedef struct _CONFIGURATION {
   // static configuration, value will be saved to config file
   STREAM_CONFIGURATION stream;
@@ -59,17 +66,31 @@ typedef struct _CONFIGURATION {
   bool unsupported_version;
   struct touchscreen_deadzone back_deadzone;
   struct special_keys special_keys;
+  struct gestures gestures;
   bool disable_powersave;
   bool jp_layout;
   bool show_fps;
+  bool show_latency;
   bool enable_frame_pacer;
   bool center_region_only;
   bool save_debug_log;
   struct input_config inputs[MAX_INPUTS];
   int inputsCount;
   int mouse_acceleration;
+  int mouse_curve;
+  int left_deadzone;
+  int right_deadzone;
+  int anti_deadzone;
+  int stick_curve;
+  int input_rate;
+  bool input_align;
+  bool record_input;
+  char* input_replay;
   bool enable_ref_frame_invalidation;
   bool enable_vita_vblank_wait;
+  bool low_latency_pacing;
+  int audio_latency;
+  int audio_frame_size;
   FILE *log_file;
   // runtime configuration, value will be recreated at launch
   SceCtrlButtons btn_confirm;
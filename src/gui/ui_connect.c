@@ -241,15 +241,15 @@ int ui_connect(char *name, char *address) {
       display_error("Not enough memory");
       return 0;
     } else if (ret == GS_INVALID) {
-      display_error("Invalid data received from server: %s\n", address, gs_error);
+      display_error("Invalid data received from server: %s\n", address, server.context->error);
       return 0;
     } else if (ret == GS_UNSUPPORTED_VERSION) {
       if (!config.unsupported_version) {
-        display_error("Unsupported version: %s\n", gs_error);
+        display_error("Unsupported version: %s\n", server.context->error);
         return 0;
       }
     } else if (ret == GS_ERROR) {
-      display_error("Gamestream error: %s\n", gs_error);
+      display_error("Gamestream error: %s\n", server.context->error);
       return 0;
     } else if (ret != GS_OK) {
       display_error("Can't connect to server\n%s", address);
@@ -267,7 +267,7 @@ int ui_connected_menu() {
   if (server.paired) {
     ret = gs_applist(&server, &server_applist);
     if (ret != GS_OK) {
-      display_error("Can't get applist!\n%d\n%s", ret, gs_error);
+      display_error("Can't get applist!\n%d\n%s", ret, server.context->error);
       return 0;
     }
 
@@ -378,15 +378,15 @@ device_info_t* ui_connect_and_pairing(device_info_t *info) {
     display_error("Not enough memory");
     return NULL;
   } else if (ret == GS_INVALID) {
-    display_error("Invalid data received from server: %s\n", info->internal, gs_error);
+    display_error("Invalid data received from server: %s\n", info->internal, server.context->error);
     return NULL;
   } else if (ret == GS_UNSUPPORTED_VERSION) {
     if (!config.unsupported_version) {
-      display_error("Unsupported version: %s\n", gs_error);
+      display_error("Unsupported version: %s\n", server.context->error);
       return NULL;
     }
   } else if (ret == GS_ERROR) {
-    display_error("Gamestream error: %s\n", gs_error);
+    display_error("Gamestream error: %s\n", server.context->error);
     return NULL;
   } else if (ret != GS_OK) {
     display_error("Can't connect to server\n%s", info->internal);
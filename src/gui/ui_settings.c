@@ -405,13 +405,20 @@ enum {
   SETTINGS_DISABLE_POWERSAVE,
   SETTINGS_JP_LAYOUT,
   SETTINGS_SHOW_FPS,
+  SETTINGS_SHOW_LATENCY,
   SETTINGS_LOCAL_AUDIO,
+  SETTINGS_SURROUND,
+  SETTINGS_AUDIO_LATENCY,
   SETTINGS_ENABLE_FRAME_PACER,
+  SETTINGS_LOW_LATENCY_PACING,
   SETTINGS_CENTER_REGION_ONLY,
   SETTINGS_ENABLE_MAPPING,
   SETTINGS_BACK_DEADZONE,
   SETTINGS_SPECIAL_KEYS,
   SETTINGS_MOUSE_ACCEL,
+  SETTINGS_MOUSE_CURVE,
+  SETTINGS_INPUT_RATE,
+  SETTINGS_INPUT_ALIGN,
 };
 
 enum {
@@ -426,13 +433,20 @@ enum {
   SETTINGS_VIEW_DISABLE_POWERSAVE,
   SETTINGS_VIEW_JP_LAYOUT,
   SETTINGS_VIEW_SHOW_FPS,
+  SETTINGS_VIEW_SHOW_LATENCY,
   SETTINGS_VIEW_LOCAL_AUDIO,
+  SETTINGS_VIEW_SURROUND,
+  SETTINGS_VIEW_AUDIO_LATENCY,
   SETTINGS_VIEW_ENABLE_FRAME_PACER,
+  SETTINGS_VIEW_LOW_LATENCY_PACING,
   SETTINGS_VIEW_CENTER_REGION_ONLY,
   SETTINGS_VIEW_ENABLE_MAPPING,
   SETTINGS_VIEW_BACK_DEADZONE,
   SETTINGS_VIEW_SPECIAL_KEYS,
   SETTINGS_VIEW_MOUSE_ACCEL,
+  SETTINGS_VIEW_MOUSE_CURVE,
+  SETTINGS_VIEW_INPUT_RATE,
+  SETTINGS_VIEW_INPUT_ALIGN,
 
   SETTINGS_VIEW_MAX_COUNT,
 };
@@ -595,6 +609,13 @@ static int settings_loop(int id, void *context, const input_data *input) {
       did_change = 1;
       config.show_fps = !config.show_fps;
       break;
+    case SETTINGS_SHOW_LATENCY:
+      if ((input->buttons & config.btn_confirm) == 0 || input->buttons & SCE_CTRL_HOLD) {
+        break;
+      }
+      did_change = 1;
+      config.show_latency = !config.show_latency;
+      break;
     case SETTINGS_LOCAL_AUDIO:
       if ((input->buttons & config.btn_confirm) == 0 || input->buttons & SCE_CTRL_HOLD) {
         break;
@@ -602,6 +623,32 @@ static int settings_loop(int id, void *context, const input_data *input) {
       did_change = 1;
       config.localaudio = !config.localaudio;
       break;
+    case SETTINGS_SURROUND:
+      if ((input->buttons & config.btn_confirm) == 0 || input->buttons & SCE_CTRL_HOLD) {
+        break;
+      }
+      did_change = 1;
+      config.stream.audioConfiguration = config.stream.audioConfiguration == AUDIO_CONFIGURATION_STEREO ?
+                                         AUDIO_CONFIGURATION_51_SURROUND : AUDIO_CONFIGURATION_STEREO;
+      break;
+    case SETTINGS_AUDIO_LATENCY:
+      if (!left && !right) {
+        break;
+      }
+      if (left) {
+        config.audio_latency -= 10;
+        if (config.audio_latency < 20) {
+          config.audio_latency = 20;
+        }
+      } else {
+        config.audio_latency += 10;
+        if (config.audio_latency > 150) {
+          config.audio_latency = 150;
+        }
+      }
+
+      did_change = 1;
+      break;
     case SETTINGS_ENABLE_FRAME_PACER:
       if ((input->buttons & config.btn_confirm) == 0 || input->buttons & SCE_CTRL_HOLD) {
         break;
@@ -609,6 +656,13 @@ static int settings_loop(int id, void *context, const input_data *input) {
       did_change = 1;
       config.enable_frame_pacer = !config.enable_frame_pacer;
       break;
+    case SETTINGS_LOW_LATENCY_PACING:
+      if ((input->buttons & config.btn_confirm) == 0 || input->buttons & SCE_CTRL_HOLD) {
+        break;
+      }
+      did_change = 1;
+      config.low_latency_pacing = !config.low_latency_pacing;
+      break;
     case SETTINGS_CENTER_REGION_ONLY:
       if ((input->buttons & config.btn_confirm) == 0 || input->buttons & SCE_CTRL_HOLD) {
         break;
@@ -661,6 +715,49 @@ static int settings_loop(int id, void *context, const input_data *input) {
 
       did_change = 1;
       break;
+    case SETTINGS_MOUSE_CURVE:
+      if (!left && !right) {
+        break;
+      }
+      if (left) {
+        config.mouse_curve -= 10;
+        if (config.mouse_curve < 0) {
+          config.mouse_curve = 0;
+        }
+      } else {
+        config.mouse_curve += 10;
+        if (config.mouse_curve > 100) {
+          config.mouse_curve = 100;
+        }
+      }
+
+      did_change = 1;
+      break;
+    case SETTINGS_INPUT_RATE:
+      if (!left && !right) {
+        break;
+      }
+      if (left) {
+        config.input_rate -= 10;
+        if (config.input_rate < 60) {
+          config.input_rate = 60;
+        }
+      } else {
+        config.input_rate += 10;
+        if (config.input_rate > 250) {
+          config.input_rate = 250;
+        }
+      }
+
+      did_change = 1;
+      break;
+    case SETTINGS_INPUT_ALIGN:
+      if ((input->buttons & config.btn_confirm) == 0 || input->buttons & SCE_CTRL_HOLD) {
+        break;
+      }
+      did_change = 1;
+      config.input_align = !config.input_align;
+      break;
 
   }
 
@@ -702,12 +799,24 @@ static int settings_loop(int id, void *context, const input_data *input) {
   sprintf(current, "%s", config.show_fps ? "yes" : "no");
   MENU_REPLACE(SETTINGS_VIEW_SHOW_FPS, current);
 
+  sprintf(current, "%s", config.show_latency ? "yes" : "no");
+  MENU_REPLACE(SETTINGS_VIEW_SHOW_LATENCY, current);
+
   sprintf(current, "%s", config.localaudio ? "yes" : "no");
   MENU_REPLACE(SETTINGS_VIEW_LOCAL_AUDIO, current);
 
+  sprintf(current, "%s", config.stream.audioConfiguration == AUDIO_CONFIGURATION_51_SURROUND ? "yes" : "no");
+  MENU_REPLACE(SETTINGS_VIEW_SURROUND, current);
+
+  sprintf(current, "%d ms", config.audio_latency);
+  MENU_REPLACE(SETTINGS_VIEW_AUDIO_LATENCY, current);
+
   sprintf(current, "%s", config.enable_frame_pacer ? "yes" : "no");
   MENU_REPLACE(SETTINGS_VIEW_ENABLE_FRAME_PACER, current);
 
+  sprintf(current, "%s", config.low_latency_pacing ? "yes" : "no");
+  MENU_REPLACE(SETTINGS_VIEW_LOW_LATENCY_PACING, current);
+
   sprintf(current, "%s", config.center_region_only ? "yes" : "no");
   MENU_REPLACE(SETTINGS_VIEW_CENTER_REGION_ONLY, current);
 
@@ -726,6 +835,15 @@ static int settings_loop(int id, void *context, const input_data *input) {
 
   sprintf(current, "%d", config.mouse_acceleration);
   MENU_REPLACE(SETTINGS_VIEW_MOUSE_ACCEL, current);
+
+  sprintf(current, "%d", config.mouse_curve);
+  MENU_REPLACE(SETTINGS_VIEW_MOUSE_CURVE, current);
+
+  sprintf(current, "%d Hz", config.input_rate);
+  MENU_REPLACE(SETTINGS_VIEW_INPUT_RATE, current);
+
+  sprintf(current, "%s", config.input_align ? "yes" : "no");
+  MENU_REPLACE(SETTINGS_VIEW_INPUT_ALIGN, current);
   return 0;
 }
 
@@ -764,16 +882,23 @@ int ui_settings_menu() {
   MENU_ENTRY(SETTINGS_ENABLE_STREAM_OPTIMIZE, SETTINGS_VIEW_ENABLE_STREAM_OPTIMIZE, "Enable stream optimization", "");
   MENU_ENTRY(SETTINGS_ENABLE_VITA_VBLANK_WAIT, SETTINGS_VIEW_ENABLE_VITA_VBLANK_WAIT, "Enable VITA vblank", "");
   MENU_ENTRY(SETTINGS_ENABLE_FRAME_PACER, SETTINGS_VIEW_ENABLE_FRAME_PACER, "Enable frame pacer", "");
+  MENU_ENTRY(SETTINGS_LOW_LATENCY_PACING, SETTINGS_VIEW_LOW_LATENCY_PACING, "Show late frames immediately", "");
   MENU_ENTRY(SETTINGS_LOCAL_AUDIO, SETTINGS_VIEW_LOCAL_AUDIO, "Enable local audio", "");
+  MENU_ENTRY(SETTINGS_SURROUND, SETTINGS_VIEW_SURROUND, "Stream surround sound", "");
+  MENU_ENTRY(SETTINGS_AUDIO_LATENCY, SETTINGS_VIEW_AUDIO_LATENCY, "Audio latency target", ICON_LEFT_RIGHT_ARROWS);
 
   MENU_CATEGORY("System");
   MENU_ENTRY(SETTINGS_SAVE_DEBUG_LOG, SETTINGS_VIEW_SAVE_DEBUG_LOG, "Enable debug log", "");
   MENU_ENTRY(SETTINGS_DISABLE_POWERSAVE, SETTINGS_VIEW_DISABLE_POWERSAVE, "Disable power save", "");
   MENU_ENTRY(SETTINGS_JP_LAYOUT, SETTINGS_VIEW_JP_LAYOUT, "Swap X & O for Moonlight", "");
   MENU_ENTRY(SETTINGS_SHOW_FPS, SETTINGS_VIEW_SHOW_FPS, "Display streaming FPS", "");
+  MENU_ENTRY(SETTINGS_SHOW_LATENCY, SETTINGS_VIEW_SHOW_LATENCY, "Display frame latency breakdown", "");
 
   MENU_CATEGORY("Input");
   MENU_ENTRY(SETTINGS_MOUSE_ACCEL, SETTINGS_VIEW_MOUSE_ACCEL, "Mouse acceleration", ICON_LEFT_RIGHT_ARROWS);
+  MENU_ENTRY(SETTINGS_MOUSE_CURVE, SETTINGS_VIEW_MOUSE_CURVE, "Mouse acceleration curve", ICON_LEFT_RIGHT_ARROWS);
+  MENU_ENTRY(SETTINGS_INPUT_RATE, SETTINGS_VIEW_INPUT_RATE, "Input sampling rate", ICON_LEFT_RIGHT_ARROWS);
+  MENU_ENTRY(SETTINGS_INPUT_ALIGN, SETTINGS_VIEW_INPUT_ALIGN, "Sample input before each frame", "");
   MENU_ENTRY(SETTINGS_ENABLE_MAPPING, SETTINGS_VIEW_ENABLE_MAPPING, "Enable mapping file", "");
   MENU_MESSAGE("Located at ux0:data/moonlight/mappings/vita.conf");
   MENU_MESSAGE("Example in github repo.");
@@ -0,0 +1,88 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "histogram.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void histogram_init(histogram *h, const char *name, uint32_t bucket_us) {
+  memset(h, 0, sizeof(histogram));
+  h->name = name;
+  h->bucket_us = bucket_us;
+}
+
+void histogram_add(histogram *h, uint32_t value_us) {
+  uint32_t bucket = value_us / h->bucket_us;
+  if (bucket >= HISTOGRAM_BUCKETS) {
+    bucket = HISTOGRAM_BUCKETS - 1;
+  }
+
+  h->buckets[bucket]++;
+  h->sum_us += value_us;
+  if (value_us > h->max_us) {
+    h->max_us = value_us;
+  }
+  h->count++;
+}
+
+// Upper bound of the bucket holding the given percentile, the overflow
+// bucket reports the largest value seen instead.
+uint32_t histogram_percentile(const histogram *h, uint32_t percent) {
+  uint32_t count = h->count;
+  if (count == 0) {
+    return 0;
+  }
+
+  uint32_t target = (uint32_t) (((uint64_t) count * percent + 99) / 100);
+  uint32_t seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS - 1; i++) {
+    seen += h->buckets[i];
+    if (seen >= target) {
+      return (i + 1) * h->bucket_us;
+    }
+  }
+  return h->max_us;
+}
+
+void histogram_log(const histogram *h) {
+  if (h->count == 0) {
+    return;
+  }
+
+  vita_debug_log("%s: %u samples, avg %llu us, p50 %u us, p95 %u us, p99 %u us, max %u us\n",
+                 h->name, h->count, h->sum_us / h->count,
+                 histogram_percentile(h, 50), histogram_percentile(h, 95),
+                 histogram_percentile(h, 99), h->max_us);
+
+  char line[512];
+  size_t len = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    if (h->buckets[i] == 0) {
+      continue;
+    }
+    len += snprintf(line + len, sizeof(line) - len, " %u:%u", i * h->bucket_us, h->buckets[i]);
+    if (len >= sizeof(line) - 24) {
+      vita_debug_log("%s buckets:%s\n", h->name, line);
+      len = 0;
+    }
+  }
+  if (len > 0) {
+    vita_debug_log("%s buckets:%s\n", h->name, line);
+  }
+}
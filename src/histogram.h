@@ -0,0 +1,42 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Fixed bucket histogram for timings in microseconds.
+//
+// Every histogram has exactly one writer thread, so adding a sample is a
+// couple of plain stores. Readers on other threads (the overlay) may see a
+// sample half counted, which only skews the numbers of that one frame.
+#define HISTOGRAM_BUCKETS 64
+
+typedef struct {
+  const char *name;
+  uint32_t bucket_us;
+  uint32_t count;
+  uint32_t max_us;
+  uint64_t sum_us;
+  // the last bucket also collects everything above the range
+  uint32_t buckets[HISTOGRAM_BUCKETS];
+} histogram;
+
+void histogram_init(histogram *h, const char *name, uint32_t bucket_us);
+void histogram_add(histogram *h, uint32_t value_us);
+uint32_t histogram_percentile(const histogram *h, uint32_t percent);
+void histogram_log(const histogram *h);
@@ -0,0 +1,289 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gesture.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  STATE_IDLE,
+  // fingers are down, but did not move or stay long enough for anything
+  STATE_PRESSED,
+  STATE_MOVING,
+  STATE_DRAGGING,
+  STATE_SCROLLING,
+  STATE_PINCHING,
+  // the gesture is over, wait for all fingers to lift
+  STATE_DONE,
+};
+
+void gesture_init(gesture_recognizer *g, const gesture_config *config) {
+  memset(g, 0, sizeof(gesture_recognizer));
+  g->config = *config;
+}
+
+// Forgets the touch in progress, the dropped count is kept
+void gesture_reset(gesture_recognizer *g) {
+  gesture_config config = g->config;
+  uint32_t dropped = g->dropped;
+  gesture_init(g, &config);
+  g->dropped = dropped;
+}
+
+// Adds an event, or counts it as dropped when the update has no room
+// left, only pinch steps can get there
+static gesture_event *gesture_emit(gesture_recognizer *g, gesture_event *events, int *n, gesture_type type) {
+  if (*n == GESTURE_MAX_EVENTS) {
+    g->dropped++;
+    return NULL;
+  }
+  gesture_event *event = &events[(*n)++];
+  memset(event, 0, sizeof(gesture_event));
+  event->type = type;
+  return event;
+}
+
+static const gesture_finger *find_finger(const gesture_finger *fingers, int count, uint8_t id) {
+  for (int i = 0; i < count; i++) {
+    if (fingers[i].id == id) {
+      return &fingers[i];
+    }
+  }
+  return NULL;
+}
+
+static int moved(const gesture_finger *f) {
+  int dx = abs(f->x - f->start_x);
+  int dy = abs(f->y - f->start_y);
+  return dx > dy ? dx : dy;
+}
+
+static int distance(int x0, int y0, int x1, int y1) {
+  return lround(sqrt((double) (x1 - x0) * (x1 - x0) + (double) (y1 - y0) * (y1 - y0)));
+}
+
+static bool edge_bound(const gesture_config *config, gesture_edge edge) {
+  return config->edges & (1 << edge);
+}
+
+static gesture_edge edge_of(const gesture_config *config, const gesture_finger *f) {
+  if (f->x < config->edge_size && edge_bound(config, GESTURE_EDGE_LEFT)) {
+    return GESTURE_EDGE_LEFT;
+  } else if (f->x >= config->width - config->edge_size && edge_bound(config, GESTURE_EDGE_RIGHT)) {
+    return GESTURE_EDGE_RIGHT;
+  } else if (f->y < config->edge_size && edge_bound(config, GESTURE_EDGE_TOP)) {
+    return GESTURE_EDGE_TOP;
+  } else if (f->y >= config->height - config->edge_size && edge_bound(config, GESTURE_EDGE_BOTTOM)) {
+    return GESTURE_EDGE_BOTTOM;
+  }
+  return GESTURE_EDGE_NONE;
+}
+
+// distance a finger moved away from the edge it started on
+static int edge_travel(gesture_edge edge, const gesture_finger *f) {
+  switch (edge) {
+    case GESTURE_EDGE_LEFT:
+      return f->x - f->start_x;
+    case GESTURE_EDGE_RIGHT:
+      return f->start_x - f->x;
+    case GESTURE_EDGE_TOP:
+      return f->y - f->start_y;
+    case GESTURE_EDGE_BOTTOM:
+      return f->start_y - f->y;
+    default:
+      return 0;
+  }
+}
+
+static void gesture_pressed(gesture_recognizer *g, gesture_event *events, int *n) {
+  const gesture_config *config = &g->config;
+  const gesture_finger *f = g->fingers;
+
+  if (g->max_count >= 2) {
+    if (g->count < 2 || (moved(&f[0]) <= config->slop && moved(&f[1]) <= config->slop)) {
+      return;
+    }
+
+    // fingers moving apart or together pinch, moving alongside they scroll
+    int start_distance = distance(f[0].start_x, f[0].start_y, f[1].start_x, f[1].start_y);
+    int spread = abs(distance(f[0].x, f[0].y, f[1].x, f[1].y) - start_distance);
+    int centre_x = abs(f[0].x + f[1].x - f[0].start_x - f[1].start_x) / 2;
+    int centre_y = abs(f[0].y + f[1].y - f[0].start_y - f[1].start_y) / 2;
+    if (spread > centre_x && spread > centre_y) {
+      g->state = STATE_PINCHING;
+      g->pinch_distance = start_distance;
+    } else {
+      g->state = STATE_SCROLLING;
+      // the scroll starts with the motion that got it past the slop
+      int dy = (f[0].y + f[1].y - f[0].start_y - f[1].start_y) / 2;
+      gesture_event *event = dy != 0 ? gesture_emit(g, events, n, GESTURE_SCROLL) : NULL;
+      if (event) {
+        event->dy = dy;
+      }
+    }
+    return;
+  }
+
+  if (moved(&f[0]) <= config->slop) {
+    return;
+  }
+
+  if (g->edge != GESTURE_EDGE_NONE) {
+    int travel = edge_travel(g->edge, &f[0]);
+    if (travel >= config->edge_travel) {
+      gesture_event *event = gesture_emit(g, events, n, GESTURE_EDGE_SWIPE);
+      if (event) {
+        event->edge = g->edge;
+      }
+      g->state = STATE_DONE;
+      return;
+    }
+    // keep waiting while the finger heads away from the edge, moving
+    // along or out of it is ordinary motion
+    if (travel * 2 > moved(&f[0])) {
+      return;
+    }
+  }
+
+  if (g->after_tap) {
+    gesture_emit(g, events, n, GESTURE_DRAG_BEGIN);
+    g->state = STATE_DRAGGING;
+  } else {
+    g->state = STATE_MOVING;
+  }
+
+  // the motion within the slop is part of the move, so strokes keep
+  // their full length
+  gesture_event *event = gesture_emit(g, events, n, GESTURE_MOVE);
+  if (event) {
+    event->dx = f[0].x - f[0].start_x;
+    event->dy = f[0].y - f[0].start_y;
+  }
+}
+
+int gesture_update(gesture_recognizer *g, uint64_t now_us, const gesture_touch *touches, int count,
+                   gesture_event *events) {
+  const gesture_config *config = &g->config;
+  gesture_finger previous[GESTURE_MAX_FINGERS];
+  int previous_count = g->count;
+  int n = 0;
+
+  // fingers keep their start position and time for as long as they touch
+  memcpy(previous, g->fingers, sizeof(previous));
+  if (count > GESTURE_MAX_FINGERS) {
+    count = GESTURE_MAX_FINGERS;
+  }
+  for (int i = 0; i < count; i++) {
+    gesture_finger *f = &g->fingers[i];
+    const gesture_finger *old = find_finger(previous, previous_count, touches[i].id);
+    if (old) {
+      *f = *old;
+    } else {
+      f->id = touches[i].id;
+      f->start_x = touches[i].x;
+      f->start_y = touches[i].y;
+      f->down_us = now_us;
+      g->last_down_us = now_us;
+    }
+    f->x = touches[i].x;
+    f->y = touches[i].y;
+  }
+  g->count = count;
+  if (count > g->max_count) {
+    g->max_count = count;
+  }
+
+  if (count == 0) {
+    // a tap with more fingers is timed from the last one that touched,
+    // they rarely land together
+    if (g->state == STATE_PRESSED && now_us - g->last_down_us <= config->tap_us) {
+      if (g->max_count == 1 && g->after_tap) {
+        gesture_emit(g, events, &n, GESTURE_DOUBLE_TAP);
+        g->tap_pending = false;
+      } else {
+        gesture_event *event = gesture_emit(g, events, &n, GESTURE_TAP);
+        if (event) {
+          event->fingers = g->max_count;
+        }
+        g->tap_pending = g->max_count == 1;
+        g->tap_us = now_us;
+      }
+    } else if (g->state == STATE_DRAGGING) {
+      gesture_emit(g, events, &n, GESTURE_DRAG_END);
+    }
+    g->state = STATE_IDLE;
+    g->max_count = 0;
+    return n;
+  }
+
+  const gesture_finger *f = g->fingers;
+  const gesture_finger *old0 = find_finger(previous, previous_count, f[0].id);
+  const gesture_finger *old1 = count >= 2 ? find_finger(previous, previous_count, f[1].id) : NULL;
+
+  switch (g->state) {
+    case STATE_IDLE:
+      g->state = STATE_PRESSED;
+      g->edge = count == 1 ? edge_of(config, &f[0]) : GESTURE_EDGE_NONE;
+      g->after_tap = g->tap_pending && now_us - g->tap_us <= config->double_tap_us;
+      g->tap_pending = false;
+      break;
+    case STATE_PRESSED:
+      gesture_pressed(g, events, &n);
+      break;
+    case STATE_MOVING:
+    case STATE_DRAGGING:
+      if (count >= 2 && g->state == STATE_MOVING) {
+        g->state = STATE_SCROLLING;
+      } else if (old0 && (f[0].x != old0->x || f[0].y != old0->y)) {
+        gesture_event *event = gesture_emit(g, events, &n, GESTURE_MOVE);
+        if (event) {
+          event->dx = f[0].x - old0->x;
+          event->dy = f[0].y - old0->y;
+        }
+      }
+      break;
+    case STATE_SCROLLING:
+      if (count < 2) {
+        g->state = STATE_DONE;
+      } else if (old0 && old1) {
+        int dy = (f[0].y + f[1].y - old0->y - old1->y) / 2;
+        gesture_event *event = dy != 0 ? gesture_emit(g, events, &n, GESTURE_SCROLL) : NULL;
+        if (event) {
+          event->dy = dy;
+        }
+      }
+      break;
+    case STATE_PINCHING:
+      if (count < 2) {
+        g->state = STATE_DONE;
+      } else {
+        int d = distance(f[0].x, f[0].y, f[1].x, f[1].y);
+        while (d - g->pinch_distance >= config->pinch_step) {
+          gesture_emit(g, events, &n, GESTURE_PINCH_OUT);
+          g->pinch_distance += config->pinch_step;
+        }
+        while (g->pinch_distance - d >= config->pinch_step) {
+          gesture_emit(g, events, &n, GESTURE_PINCH_IN);
+          g->pinch_distance -= config->pinch_step;
+        }
+      }
+      break;
+  }
+  return n;
+}
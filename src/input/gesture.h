@@ -0,0 +1,120 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Touch gesture recognition. It only sees finger positions and sample
+// times, so it has no dependency on the Vita touch API.
+//
+// Each update returns the gestures that happened since the last one:
+// taps when fingers lift, motion while fingers move, and one event for
+// each pinch step or edge swipe. Holding still emits nothing. Events
+// past GESTURE_MAX_EVENTS are counted as dropped.
+#define GESTURE_MAX_FINGERS 4
+#define GESTURE_MAX_EVENTS 4
+
+typedef enum {
+  GESTURE_TAP,
+  GESTURE_DOUBLE_TAP,
+  GESTURE_DRAG_BEGIN,
+  GESTURE_DRAG_END,
+  GESTURE_MOVE,
+  GESTURE_SCROLL,
+  GESTURE_PINCH_IN,
+  GESTURE_PINCH_OUT,
+  GESTURE_EDGE_SWIPE,
+} gesture_type;
+
+typedef enum {
+  GESTURE_EDGE_NONE,
+  GESTURE_EDGE_LEFT,
+  GESTURE_EDGE_RIGHT,
+  GESTURE_EDGE_TOP,
+  GESTURE_EDGE_BOTTOM,
+} gesture_edge;
+
+typedef struct {
+  uint8_t id;
+  short x;
+  short y;
+} gesture_touch;
+
+typedef struct {
+  gesture_type type;
+  // fingers of a tap
+  int fingers;
+  // motion of a move or scroll
+  int dx;
+  int dy;
+  // edge an edge swipe started from
+  gesture_edge edge;
+} gesture_event;
+
+typedef struct {
+  int width;
+  int height;
+  // longest touch that still counts as a tap
+  uint32_t tap_us;
+  // longest gap from a tap to the touch of a double tap or drag
+  uint32_t double_tap_us;
+  // motion that still counts as holding still
+  int slop;
+  // edge zone size and the distance an edge swipe has to cover
+  int edge_size;
+  int edge_travel;
+  // edges with an action, by 1 << gesture_edge, touches near the others
+  // are ordinary motion
+  unsigned int edges;
+  // change of the finger distance per pinch event
+  int pinch_step;
+} gesture_config;
+
+typedef struct {
+  uint8_t id;
+  short x;
+  short y;
+  short start_x;
+  short start_y;
+  uint64_t down_us;
+} gesture_finger;
+
+typedef struct {
+  gesture_config config;
+  int state;
+  gesture_finger fingers[GESTURE_MAX_FINGERS];
+  int count;
+  // most fingers down at once since the first one touched
+  int max_count;
+  // when the last finger touched, taps with more fingers are timed from it
+  uint64_t last_down_us;
+  gesture_edge edge;
+  // the touch started right after a tap
+  bool after_tap;
+  bool tap_pending;
+  uint64_t tap_us;
+  int pinch_distance;
+  // events that didn't fit into an update
+  uint32_t dropped;
+} gesture_recognizer;
+
+void gesture_init(gesture_recognizer *g, const gesture_config *config);
+void gesture_reset(gesture_recognizer *g);
+int gesture_update(gesture_recognizer *g, uint64_t now_us, const gesture_touch *touches, int count,
+                   gesture_event *events);
@@ -0,0 +1,753 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline.h"
+
+#include <Limelight.h>
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH INPUT_WIDTH
+#define HEIGHT INPUT_HEIGHT
+
+typedef struct Point {
+  short x;
+  short y;
+} Point;
+
+typedef struct Section {
+  Point left;
+  Point right;
+} Section;
+
+#define lerp(value, from_max, to_max) ((((value*10) * (to_max*10))/(from_max*10))/10)
+
+// Touch motion becomes mouse motion in 1/256 pixel steps. The gain for
+// each swipe speed comes from a table built from the acceleration and
+// curve settings, the fraction a move leaves over is carried into the
+// next one, and moves are summed up to one packet per send window.
+#define MOUSE_SEND_WINDOW_US 8000
+
+// Front panel gestures, timed by the sample clock. A tap is as short as
+// the old 100 ms click delay.
+#define GESTURE_TAP_US 100000
+#define GESTURE_DOUBLE_TAP_US 300000
+
+// Gesture bindings use the special key codes. An action is held for as
+// long as a mouse click used to be, some games ignore shorter ones.
+#define GESTURE_HOLD_US 100000
+
+// Stick response: nothing inside the deadzone, then the anti-deadzone
+// jump and the curve up to full scale. Axes are scaled by gain[radius] /
+// 16, so both move together and the deadzone is round.
+#define STICK_CENTER 128
+#define STICK_RADIUS 127
+
+// indices into the axes of a sample
+enum {
+  AXIS_LX,
+  AXIS_LY,
+  AXIS_RX,
+  AXIS_RY,
+  AXIS_LT,
+  AXIS_RT,
+};
+
+void input_default_mapping(struct mapping *map, bool vitatv) {
+  map->abs_x           = LEFTX                 | INPUT_TYPE_ANALOG;
+  map->abs_y           = LEFTY                 | INPUT_TYPE_ANALOG;
+  map->abs_rx          = RIGHTX                | INPUT_TYPE_ANALOG;
+  map->abs_ry          = RIGHTY                | INPUT_TYPE_ANALOG;
+
+  map->btn_dpad_up     = INPUT_PAD_UP          | INPUT_TYPE_GAMEPAD;
+  map->btn_dpad_down   = INPUT_PAD_DOWN        | INPUT_TYPE_GAMEPAD;
+  map->btn_dpad_left   = INPUT_PAD_LEFT        | INPUT_TYPE_GAMEPAD;
+  map->btn_dpad_right  = INPUT_PAD_RIGHT       | INPUT_TYPE_GAMEPAD;
+  map->btn_south       = INPUT_PAD_CROSS       | INPUT_TYPE_GAMEPAD;
+  map->btn_east        = INPUT_PAD_CIRCLE      | INPUT_TYPE_GAMEPAD;
+  map->btn_north       = INPUT_PAD_TRIANGLE    | INPUT_TYPE_GAMEPAD;
+  map->btn_west        = INPUT_PAD_SQUARE      | INPUT_TYPE_GAMEPAD;
+
+  map->btn_select      = INPUT_PAD_SELECT      | INPUT_TYPE_GAMEPAD;
+  map->btn_start       = INPUT_PAD_START       | INPUT_TYPE_GAMEPAD;
+
+  map->btn_thumbl      = INPUT_PAD_L1          | INPUT_TYPE_GAMEPAD;
+  map->btn_thumbr      = INPUT_PAD_R1          | INPUT_TYPE_GAMEPAD;
+
+  if (vitatv) {
+    map->btn_tl        = LEFT_TRIGGER          | INPUT_TYPE_ANALOG;
+    map->btn_tr        = RIGHT_TRIGGER         | INPUT_TYPE_ANALOG;
+    map->btn_tl2       = INPUT_PAD_L3          | INPUT_TYPE_GAMEPAD;
+    map->btn_tr2       = INPUT_PAD_R3          | INPUT_TYPE_GAMEPAD;
+  } else {
+    map->btn_tl        = TOUCHSEC_NORTHWEST    | INPUT_TYPE_TOUCHSCREEN;
+    map->btn_tr        = TOUCHSEC_NORTHEAST    | INPUT_TYPE_TOUCHSCREEN;
+    map->btn_tl2       = TOUCHSEC_SOUTHWEST    | INPUT_TYPE_TOUCHSCREEN;
+    map->btn_tr2       = TOUCHSEC_SOUTHEAST    | INPUT_TYPE_TOUCHSCREEN;
+  }
+}
+
+static void build_mouse_gain(input_pipeline *p, int acceleration, int curve) {
+  double multiplier = 1 + 0.01 * acceleration;
+  for (int i = 0; i < INPUT_MOUSE_GAIN_STEPS; i++) {
+    // touch pixels are half a screen pixel, a curve of 0 is a flat gain
+    double gain = multiplier * pow(1 + i / 8., curve / 100.) / 2;
+    long q8 = lround(gain * 256);
+    p->mouse_gain[i] = q8 > UINT16_MAX ? UINT16_MAX : q8;
+  }
+}
+
+static inline void move_mouse(input_pipeline *p, int delta_x, int delta_y) {
+  int speed = abs(delta_x) > abs(delta_y) ? abs(delta_x) : abs(delta_y);
+  speed = speed * (int) p->settings.rate / 200;
+  if (speed >= INPUT_MOUSE_GAIN_STEPS) {
+    speed = INPUT_MOUSE_GAIN_STEPS - 1;
+  }
+
+  int32_t x = delta_x * p->mouse_gain[speed] + p->mouse_remainder_x;
+  int32_t y = delta_y * p->mouse_gain[speed] + p->mouse_remainder_y;
+  p->mouse_pending_x += x >> 8;
+  p->mouse_pending_y += y >> 8;
+  p->mouse_remainder_x = x & 0xff;
+  p->mouse_remainder_y = y & 0xff;
+}
+
+static inline short clamp_short(int32_t value) {
+  if (value > SHRT_MAX) {
+    return SHRT_MAX;
+  } else if (value < SHRT_MIN) {
+    return SHRT_MIN;
+  }
+  return value;
+}
+
+static void flush_mouse(input_pipeline *p, bool force) {
+  if (p->mouse_pending_x == 0 && p->mouse_pending_y == 0) {
+    return;
+  }
+  if (!force && p->sample_us - p->mouse_sent_us < MOUSE_SEND_WINDOW_US) {
+    return;
+  }
+
+  short x = clamp_short(p->mouse_pending_x);
+  short y = clamp_short(p->mouse_pending_y);
+  p->sink->mouse_move(x, y);
+  p->mouse_pending_x -= x;
+  p->mouse_pending_y -= y;
+  p->mouse_sent_us = p->sample_us;
+}
+
+// scroll by half the finger motion, the odd pixel is carried over
+static void scroll_wheel(input_pipeline *p, int delta_y) {
+  p->scroll_rest += delta_y;
+  int amount = p->scroll_rest / 2;
+  if (amount == 0) {
+    return;
+  }
+  p->sink->scroll(amount);
+  p->scroll_rest -= amount * 2;
+}
+
+static void compile_sections(const Section *sections, uint8_t first_section,
+                             uint8_t *columns, uint8_t *rows) {
+  memset(columns, 0, WIDTH + 1);
+  memset(rows, 0, HEIGHT + 1);
+  for (int i = 0; i < 4; i++) {
+    uint8_t section = first_section << i;
+    for (int x = sections[i].left.x < 0 ? 0 : sections[i].left.x; x <= sections[i].right.x && x <= WIDTH; x++) {
+      columns[x] |= section;
+    }
+    for (int y = sections[i].left.y < 0 ? 0 : sections[i].left.y; y <= sections[i].right.y && y <= HEIGHT; y++) {
+      rows[y] |= section;
+    }
+  }
+}
+
+// Claims the first section under the point that no other finger holds yet,
+// in the order north west, north east, south west, south east
+static inline bool claim_section(input_touch *touch, const uint8_t *columns, const uint8_t *rows, int x, int y) {
+  uint8_t free = columns[x] & rows[y] & ~touch->button;
+  if (free == 0) {
+    return false;
+  }
+  touch->button |= free & -free;
+  return true;
+}
+
+static inline int touch_x(int x) {
+  x = lerp(x, 1919, WIDTH);
+  return x > WIDTH ? WIDTH : x;
+}
+
+static inline int touch_y(int y) {
+  y = lerp(y, 1087, HEIGHT);
+  return y > HEIGHT ? HEIGHT : y;
+}
+
+static inline void read_backscreen(input_pipeline *p, const input_record_sample *sample) {
+  for (int i = 0; i < sample->back_count; i++) {
+    claim_section(&p->touch, p->back_columns, p->back_rows,
+                  touch_x(sample->back[i].x), touch_y(sample->back[i].y));
+  }
+}
+
+static inline void read_frontscreen(input_pipeline *p, const input_record_sample *sample) {
+  input_touch *touch = &p->touch;
+  for (int i = 0; i < sample->front_count; i++) {
+    int x = touch_x(sample->front[i].x);
+    int y = touch_y(sample->front[i].y);
+
+    if (claim_section(touch, p->front_columns, p->front_rows, x, y)) {
+      continue;
+    }
+
+    if (touch->finger == GESTURE_MAX_FINGERS) {
+      continue;
+    }
+
+    // FIXME if touch same section using multiple finger, they can count finger
+    touch->x[touch->finger] = x;
+    touch->y[touch->finger] = y;
+    touch->ids[touch->finger] = sample->front[i].id;
+    touch->finger += 1;
+  }
+}
+
+static void compile_masks(uint32_t defined, uint32_t *pad_mask, uint32_t *touch_mask) {
+  uint32_t dev_type = defined & INPUT_TYPE_MASK;
+  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+
+  *pad_mask = dev_type == INPUT_TYPE_GAMEPAD ? dev_val : 0;
+  *touch_mask = dev_type == INPUT_TYPE_TOUCHSCREEN ? dev_val : 0;
+}
+
+static void compile_button(input_pipeline *p, int idx, uint32_t defined, short flag) {
+  p->buttons[idx].flag = flag;
+  compile_masks(defined, &p->buttons[idx].pad_mask, &p->buttons[idx].touch_mask);
+}
+
+static void compile_analog(input_pipeline *p, int idx, uint32_t defined, bool reverse) {
+  input_analog_entry *entry = &p->analogs[idx];
+  memset(entry, 0, sizeof(input_analog_entry));
+  entry->axis = -1;
+  entry->reverse = reverse;
+
+  if ((defined & INPUT_TYPE_MASK) != INPUT_TYPE_ANALOG) {
+    compile_masks(defined, &entry->pad_mask, &entry->touch_mask);
+    return;
+  }
+
+  // an unknown axis stays at 0
+  switch (defined & INPUT_VALUE_MASK) {
+    case LEFTX:
+      entry->axis = AXIS_LX;
+      entry->stick = true;
+      break;
+    case LEFTY:
+      entry->axis = AXIS_LY;
+      entry->stick = true;
+      break;
+    case RIGHTX:
+      entry->axis = AXIS_RX;
+      entry->stick = true;
+      break;
+    case RIGHTY:
+      entry->axis = AXIS_RY;
+      entry->stick = true;
+      break;
+    case LEFT_TRIGGER:
+      entry->axis = AXIS_LT;
+      break;
+    case RIGHT_TRIGGER:
+      entry->axis = AXIS_RT;
+      break;
+  }
+}
+
+static inline short read_analog(const input_pipeline *p, const input_analog_entry *entry) {
+  if (entry->axis >= 0) {
+    uint8_t value = p->axes[entry->axis];
+    return entry->stick ? value * 256 - (1 << 15) + 128 : value;
+  }
+  return (p->pad_buttons & entry->pad_mask) || (p->touch.button & entry->touch_mask) ? 0xff : 0;
+}
+
+static void build_stick_response(input_stick_response *response, int deadzone, int anti_deadzone, int curve) {
+  if (deadzone >= STICK_RADIUS) {
+    deadzone = STICK_RADIUS - 1;
+  }
+
+  response->gain[0] = 0;
+  for (int r = 1; r < 256; r++) {
+    double t = (double) (r - deadzone) / (STICK_RADIUS - deadzone);
+    if (t <= 0) {
+      response->gain[r] = 0;
+      continue;
+    }
+    if (t > 1) {
+      t = 1;
+    }
+
+    double out = anti_deadzone / 100. + (1 - anti_deadzone / 100.) * pow(t, curve / 100.);
+    response->gain[r] = lround(out * SHRT_MAX * 16 / r);
+  }
+}
+
+// exact for the radii of a stick, single precision rounds sqrt correctly
+// and no r2 lies within its error below a square
+static inline int stick_radius(int r2) {
+  return (int) sqrtf((float) r2);
+}
+
+static inline short stick_axis(int centered, uint32_t gain, bool reverse) {
+  int32_t value = centered * (int32_t) gain / 16;
+  return clamp_short(reverse ? -value : value);
+}
+
+static inline void read_stick(const input_pipeline *p, const input_analog_entry *x_entry,
+                              const input_analog_entry *y_entry, const input_stick_response *response,
+                              short *x, short *y) {
+  if (!x_entry->stick || !y_entry->stick) {
+    *x = read_analog(p, x_entry);
+    *y = read_analog(p, y_entry);
+    return;
+  }
+
+  int cx = p->axes[x_entry->axis] - STICK_CENTER;
+  int cy = p->axes[y_entry->axis] - STICK_CENTER;
+  uint32_t gain = response->gain[stick_radius(cx * cx + cy * cy)];
+  *x = stick_axis(cx, gain, x_entry->reverse);
+  *y = stick_axis(cy, gain, y_entry->reverse);
+}
+
+static inline uint32_t is_pressed(const input_pipeline *p, uint32_t defined) {
+  uint32_t dev_type = defined & INPUT_TYPE_MASK;
+  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+
+  switch(dev_type) {
+    case INPUT_TYPE_GAMEPAD:
+      return p->pad_buttons & dev_val;
+    case INPUT_TYPE_TOUCHSCREEN:
+      return p->touch.button & dev_val;
+  }
+  return 0;
+}
+
+static inline uint32_t is_old_pressed(const input_pipeline *p, uint32_t defined) {
+  uint32_t dev_type = defined & INPUT_TYPE_MASK;
+  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+
+  switch(dev_type) {
+    case INPUT_TYPE_GAMEPAD:
+      return p->pad_old_buttons & dev_val;
+    case INPUT_TYPE_TOUCHSCREEN:
+      return p->touch_old.button & dev_val;
+  }
+  return 0;
+}
+
+static inline void special(input_pipeline *p, uint32_t defined, uint32_t pressed, uint32_t old_pressed) {
+  uint32_t dev_type = defined & INPUT_TYPE_MASK;
+  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+
+  if (pressed) {
+    switch(dev_type) {
+      case INPUT_TYPE_SPECIAL:
+        if (dev_val == INPUT_SPECIAL_KEY_PAUSE) {
+          p->sink->pause();
+          return;
+        }
+      case INPUT_TYPE_GAMEPAD:
+        p->curr.button |= dev_val;
+        return;
+      case INPUT_TYPE_ANALOG:
+        switch(dev_val) {
+          case LEFT_TRIGGER:
+            p->curr.lt = 0xff;
+            return;
+          case RIGHT_TRIGGER:
+            p->curr.rt = 0xff;
+            return;
+        }
+        return;
+      case INPUT_TYPE_MOUSE:
+        if (!old_pressed) {
+          p->sink->mouse_button(BUTTON_ACTION_PRESS, dev_val);
+        }
+        return;
+      case INPUT_TYPE_KEYBOARD:
+       if (!old_pressed) {
+          p->sink->keyboard(dev_val, KEY_ACTION_DOWN, 0);
+       }
+       return;
+    }
+  } else {
+    // released
+    switch(dev_type) {
+      case INPUT_TYPE_MOUSE:
+        if (old_pressed) {
+          p->sink->mouse_button(BUTTON_ACTION_RELEASE, dev_val);
+        }
+        return;
+      case INPUT_TYPE_KEYBOARD:
+        if (old_pressed) {
+          p->sink->keyboard(dev_val, KEY_ACTION_UP, 0);
+        }
+        return;
+    }
+  }
+
+}
+
+static void release_gesture_action(input_pipeline *p) {
+  if (p->gesture_held) {
+    special(p, p->gesture_held, false, true);
+    p->gesture_held = 0;
+  }
+}
+
+static void gesture_action(input_pipeline *p, uint32_t defined) {
+  if (defined == 0) {
+    return;
+  }
+  release_gesture_action(p);
+  special(p, defined, true, false);
+  p->gesture_held = defined;
+  p->gesture_release_us = p->sample_us + GESTURE_HOLD_US;
+}
+
+static void handle_gesture(input_pipeline *p, const gesture_event *event) {
+  const input_settings *s = &p->settings;
+
+  switch (event->type) {
+    case GESTURE_TAP:
+      if (event->fingers == 1) {
+        gesture_action(p, s->tap);
+      } else if (event->fingers == 2) {
+        gesture_action(p, s->two_finger_tap);
+      }
+      break;
+    case GESTURE_DOUBLE_TAP:
+      gesture_action(p, s->double_tap);
+      break;
+    case GESTURE_DRAG_BEGIN:
+      release_gesture_action(p);
+      if (s->drag) {
+        special(p, s->drag, true, false);
+        p->drag_active = true;
+      }
+      break;
+    case GESTURE_DRAG_END:
+      flush_mouse(p, true);
+      if (p->drag_active) {
+        special(p, s->drag, false, true);
+        p->drag_active = false;
+      }
+      break;
+    case GESTURE_MOVE:
+      move_mouse(p, event->dx, event->dy);
+      break;
+    case GESTURE_SCROLL:
+      scroll_wheel(p, event->dy);
+      break;
+    case GESTURE_PINCH_IN:
+      gesture_action(p, s->pinch_in);
+      break;
+    case GESTURE_PINCH_OUT:
+      gesture_action(p, s->pinch_out);
+      break;
+    case GESTURE_EDGE_SWIPE:
+      switch (event->edge) {
+        case GESTURE_EDGE_LEFT:
+          gesture_action(p, s->edge_left);
+          break;
+        case GESTURE_EDGE_RIGHT:
+          gesture_action(p, s->edge_right);
+          break;
+        case GESTURE_EDGE_TOP:
+          gesture_action(p, s->edge_top);
+          break;
+        case GESTURE_EDGE_BOTTOM:
+          gesture_action(p, s->edge_bottom);
+          break;
+        default:
+          break;
+      }
+      break;
+  }
+}
+
+void input_pipeline_map(input_pipeline *p, const input_record_sample *sample) {
+  p->sample_us = sample->time_us;
+  p->pad_buttons = sample->buttons;
+  p->axes[AXIS_LX] = sample->lx;
+  p->axes[AXIS_LY] = sample->ly;
+  p->axes[AXIS_RX] = sample->rx;
+  p->axes[AXIS_RY] = sample->ry;
+  p->axes[AXIS_LT] = sample->lt;
+  p->axes[AXIS_RT] = sample->rt;
+
+  input_touch *touch = &p->touch;
+  input_controller *curr = &p->curr;
+  memset(touch, 0, sizeof(input_touch));
+  memset(curr, 0, sizeof(input_controller));
+
+  read_frontscreen(p, sample);
+  read_backscreen(p, sample);
+
+  // buttons, without a branch per button, pad bits change too often to
+  // predict
+  for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+    const input_button_entry *entry = &p->buttons[i];
+    bool held = (p->pad_buttons & entry->pad_mask) | (touch->button & entry->touch_mask);
+    curr->button |= entry->flag & -(short) held;
+  }
+
+  // analogs
+  curr->lt = read_analog(p, &p->analogs[INPUT_ANALOG_LT]); // l2
+  curr->rt = read_analog(p, &p->analogs[INPUT_ANALOG_RT]); // r2
+  read_stick(p, &p->analogs[INPUT_ANALOG_LX], &p->analogs[INPUT_ANALOG_LY], &p->left_stick, &curr->lx, &curr->ly);
+  read_stick(p, &p->analogs[INPUT_ANALOG_RX], &p->analogs[INPUT_ANALOG_RY], &p->right_stick, &curr->rx, &curr->ry);
+
+  // special touchscreen buttons
+  const input_settings *s = &p->settings;
+  special(p, s->special_nw,
+          is_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NW),
+          is_old_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NW));
+  special(p, s->special_ne,
+          is_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NE),
+          is_old_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NE));
+  special(p, s->special_sw,
+          is_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SW),
+          is_old_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SW));
+  special(p, s->special_se,
+          is_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SE),
+          is_old_pressed(p, INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SE));
+}
+
+bool input_pipeline_process(input_pipeline *p, const input_record_sample *sample) {
+  input_pipeline_map(p, sample);
+
+  input_touch *touch = &p->touch;
+  input_controller *curr = &p->curr;
+  const input_settings *s = &p->settings;
+
+  // mouse and gestures
+  gesture_touch touches[GESTURE_MAX_FINGERS];
+  for (int i = 0; i < touch->finger; i++) {
+    touches[i].id = touch->ids[i];
+    touches[i].x = touch->x[i];
+    touches[i].y = touch->y[i];
+  }
+
+  gesture_event events[GESTURE_MAX_EVENTS];
+  int event_count = gesture_update(&p->gestures, p->sample_us, touches, touch->finger, events);
+  for (int i = 0; i < event_count; i++) {
+    handle_gesture(p, &events[i]);
+  }
+  if (p->gesture_held) {
+    if (p->sample_us >= p->gesture_release_us) {
+      release_gesture_action(p);
+    } else {
+      // keeps a gamepad button held
+      special(p, p->gesture_held, true, true);
+    }
+  }
+  if (p->drag_active) {
+    // keeps a gamepad button held, mouse and keys are not sent again
+    special(p, s->drag, true, true);
+  }
+  if (touch->finger == 0 && p->touch_old.finger > 0) {
+    // hand over what is left of the motion, drop the sub-pixel rest
+    flush_mouse(p, true);
+    p->mouse_remainder_x = 0;
+    p->mouse_remainder_y = 0;
+    p->scroll_rest = 0;
+  }
+  flush_mouse(p, false);
+
+  unsigned char axes[4] = { sample->lx, sample->ly, sample->rx, sample->ry };
+  bool sticks_moved = memcmp(axes, p->last_axes, sizeof(axes)) != 0;
+  memcpy(p->last_axes, axes, sizeof(axes));
+
+  bool sent = false;
+  if (memcmp(curr, &p->old, sizeof(input_controller)) != 0) {
+    p->sink->controller(curr->button, curr->lt, curr->rt,
+                        curr->lx, -1 * curr->ly, curr->rx, -1 * curr->ry);
+    p->controller_events++;
+    sent = true;
+    memcpy(&p->old, curr, sizeof(input_controller));
+    p->pad_old_buttons = p->pad_buttons;
+  } else if (sticks_moved) {
+    p->stick_suppressed++;
+  }
+  if (memcmp(touch, &p->touch_old, sizeof(input_touch)) != 0) {
+    memcpy(&p->touch_old, touch, sizeof(input_touch));
+  }
+  return sent;
+}
+
+void input_pipeline_reset(input_pipeline *p) {
+  release_gesture_action(p);
+  gesture_reset(&p->gestures);
+  p->drag_active = false;
+  memset(&p->touch_old, 0, sizeof(input_touch));
+  p->mouse_pending_x = 0;
+  p->mouse_pending_y = 0;
+  p->mouse_remainder_x = 0;
+  p->mouse_remainder_y = 0;
+  p->scroll_rest = 0;
+}
+
+void input_pipeline_config(input_pipeline *p, const input_settings *settings, const input_sink *sink) {
+  memset(p, 0, sizeof(input_pipeline));
+  p->settings = *settings;
+  p->sink = sink;
+  const struct mapping *map = &settings->map;
+
+  compile_button(p, 0, map->btn_dpad_up, UP_FLAG);
+  compile_button(p, 1, map->btn_dpad_left, LEFT_FLAG);
+  compile_button(p, 2, map->btn_dpad_down, DOWN_FLAG);
+  compile_button(p, 3, map->btn_dpad_right, RIGHT_FLAG);
+  compile_button(p, 4, map->btn_start, PLAY_FLAG);
+  compile_button(p, 5, map->btn_select, BACK_FLAG);
+  compile_button(p, 6, map->btn_north, Y_FLAG);
+  compile_button(p, 7, map->btn_east, B_FLAG);
+  compile_button(p, 8, map->btn_south, A_FLAG);
+  compile_button(p, 9, map->btn_west, X_FLAG);
+  compile_button(p, 10, map->btn_thumbl, LB_FLAG); // l1
+  compile_button(p, 11, map->btn_thumbr, RB_FLAG); // r1
+  compile_button(p, 12, map->btn_tl2, LS_CLK_FLAG); // l3
+  compile_button(p, 13, map->btn_tr2, RS_CLK_FLAG); // r3
+
+  compile_analog(p, INPUT_ANALOG_LT, map->btn_tl, false); // l2
+  compile_analog(p, INPUT_ANALOG_RT, map->btn_tr, false); // r2
+  compile_analog(p, INPUT_ANALOG_LX, map->abs_x, map->reverse_x);
+  compile_analog(p, INPUT_ANALOG_LY, map->abs_y, map->reverse_y);
+  compile_analog(p, INPUT_ANALOG_RX, map->abs_rx, map->reverse_rx);
+  compile_analog(p, INPUT_ANALOG_RY, map->abs_ry, map->reverse_ry);
+
+  // the mapping's abs_deadzone is in pad units and applies to both sticks
+  int left_deadzone = settings->left_deadzone * STICK_RADIUS / 100;
+  int right_deadzone = settings->right_deadzone * STICK_RADIUS / 100;
+  build_stick_response(&p->left_stick, left_deadzone > map->abs_deadzone ? left_deadzone : map->abs_deadzone,
+                       settings->anti_deadzone, settings->stick_curve);
+  build_stick_response(&p->right_stick, right_deadzone > map->abs_deadzone ? right_deadzone : map->abs_deadzone,
+                       settings->anti_deadzone, settings->stick_curve);
+
+  // the back panel only matters when something is mapped to its quarters
+  uint32_t back_mask = TOUCHSEC_NORTHWEST | TOUCHSEC_NORTHEAST | TOUCHSEC_SOUTHWEST | TOUCHSEC_SOUTHEAST;
+  uint32_t touch_mask = 0;
+  for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+    touch_mask |= p->buttons[i].touch_mask;
+  }
+  for (int i = 0; i < INPUT_ANALOG_COUNT; i++) {
+    touch_mask |= p->analogs[i].touch_mask;
+  }
+  p->back_touch = settings->touch && (touch_mask & back_mask);
+
+  int vertical   = (WIDTH - settings->back_left - settings->back_right) / 2 + settings->back_left;
+  int horizontal = (HEIGHT - settings->back_top - settings->back_bottom) / 2 + settings->back_top;
+
+  Section back_sections[4];
+  back_sections[0].left.x  = settings->back_left;
+  back_sections[0].left.y  = settings->back_top;
+  back_sections[0].right.x = vertical;
+  back_sections[0].right.y = horizontal;
+
+  back_sections[1].left.x  = vertical;
+  back_sections[1].left.y  = settings->back_top;
+  back_sections[1].right.x = WIDTH - settings->back_right;
+  back_sections[1].right.y = horizontal;
+
+  back_sections[2].left.x  = settings->back_left;
+  back_sections[2].left.y  = horizontal;
+  back_sections[2].right.x = vertical;
+  back_sections[2].right.y = HEIGHT - settings->back_bottom;
+
+  back_sections[3].left.x  = vertical;
+  back_sections[3].left.y  = horizontal;
+  back_sections[3].right.x = WIDTH - settings->back_right;
+  back_sections[3].right.y = HEIGHT - settings->back_bottom;
+
+  int offset = settings->special_offset;
+  int size = settings->special_size;
+  Section front_sections[4];
+  front_sections[0].left.x  = offset;
+  front_sections[0].left.y  = offset;
+  front_sections[0].right.x = offset + size;
+  front_sections[0].right.y = offset + size;
+
+  front_sections[1].left.x  = WIDTH - offset - size;
+  front_sections[1].left.y  = offset;
+  front_sections[1].right.x = WIDTH - offset;
+  front_sections[1].right.y = offset + size;
+
+  front_sections[2].left.x  = offset;
+  front_sections[2].left.y  = HEIGHT - offset - size;
+  front_sections[2].right.x = offset + size;
+  front_sections[2].right.y = HEIGHT - offset;
+
+  front_sections[3].left.x  = WIDTH - offset - size;
+  front_sections[3].left.y  = HEIGHT - offset - size;
+  front_sections[3].right.x = WIDTH - offset;
+  front_sections[3].right.y = HEIGHT - offset;
+
+  compile_sections(back_sections, TOUCHSEC_NORTHWEST, p->back_columns, p->back_rows);
+  compile_sections(front_sections, TOUCHSEC_SPECIAL_NW, p->front_columns, p->front_rows);
+
+  build_mouse_gain(p, settings->mouse_acceleration, settings->mouse_curve);
+
+  gesture_config gesture = {
+    .width = WIDTH,
+    .height = HEIGHT,
+    .tap_us = GESTURE_TAP_US,
+    .double_tap_us = GESTURE_DOUBLE_TAP_US,
+    .slop = 8,
+    .edge_size = 24,
+    .edge_travel = 120,
+    .edges = (settings->edge_left ? 1 << GESTURE_EDGE_LEFT : 0) |
+             (settings->edge_right ? 1 << GESTURE_EDGE_RIGHT : 0) |
+             (settings->edge_top ? 1 << GESTURE_EDGE_TOP : 0) |
+             (settings->edge_bottom ? 1 << GESTURE_EDGE_BOTTOM : 0),
+    .pinch_step = 40,
+  };
+  gesture_init(&p->gestures, &gesture);
+}
+
+uint32_t input_pipeline_replay(input_pipeline *p, FILE *recording, histogram *cost, uint64_t (*clock_us)(void)) {
+  input_pipeline_reset(p);
+
+  input_record_sample sample;
+  uint32_t samples = 0;
+  while (input_replay_read(recording, &sample)) {
+    input_capture_time(sample.time_us);
+
+    uint64_t start = clock_us();
+    input_pipeline_process(p, &sample);
+    uint64_t end = clock_us();
+    histogram_add(cost, end > start ? end - start : 0);
+    samples++;
+  }
+
+  // actions still held at the end are released into the capture
+  input_pipeline_reset(p);
+  return samples;
+}
@@ -0,0 +1,230 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../histogram.h"
+#include "gesture.h"
+#include "mapping.h"
+#include "record.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The input mapping from raw pad and touch samples to events, without any
+// dependency on the Vita APIs. The input thread runs one pipeline on live
+// samples with the events going to the host, a replay runs another one on
+// recorded samples with the events going to the capture sink, so neither
+// disturbs the other.
+
+typedef enum {
+  TOUCHSEC_NORTHWEST  = 0x1,
+  TOUCHSEC_NORTHEAST  = 0x2,
+  TOUCHSEC_SOUTHWEST  = 0x4,
+  TOUCHSEC_SOUTHEAST  = 0x8,
+  TOUCHSEC_SPECIAL_NW = 0x10,
+  TOUCHSEC_SPECIAL_NE = 0x20,
+  TOUCHSEC_SPECIAL_SW = 0x40,
+  TOUCHSEC_SPECIAL_SE = 0x80,
+} TouchScreenSection;
+
+typedef enum {
+  LEFTX,
+  LEFTY,
+  RIGHTX,
+  RIGHTY,
+  LEFT_TRIGGER,
+  RIGHT_TRIGGER
+} PadSection;
+
+#define INPUT_TYPE_MASK         0xfff00000
+#define INPUT_VALUE_MASK        0x000fffff
+
+#define INPUT_TYPE_KEYBOARD     0x00000000
+#define INPUT_TYPE_SPECIAL      0x00100000
+#define INPUT_TYPE_MOUSE        0x00200000
+#define INPUT_TYPE_GAMEPAD      0x00300000
+#define INPUT_TYPE_ANALOG       0x00400000
+#define INPUT_TYPE_TOUCHSCREEN  0x00500000
+#define INPUT_TYPE_DEF_NAME     0xf0000000
+
+enum {
+  INPUT_SPECIAL_KEY_PAUSE
+};
+
+// Pad buttons, the same bits as SceCtrlButtons
+#define INPUT_PAD_SELECT    0x00000001
+#define INPUT_PAD_L3        0x00000002
+#define INPUT_PAD_R3        0x00000004
+#define INPUT_PAD_START     0x00000008
+#define INPUT_PAD_UP        0x00000010
+#define INPUT_PAD_RIGHT     0x00000020
+#define INPUT_PAD_DOWN      0x00000040
+#define INPUT_PAD_LEFT      0x00000080
+#define INPUT_PAD_L1        0x00000400
+#define INPUT_PAD_R1        0x00000800
+#define INPUT_PAD_TRIANGLE  0x00001000
+#define INPUT_PAD_CIRCLE    0x00002000
+#define INPUT_PAD_CROSS     0x00004000
+#define INPUT_PAD_SQUARE    0x00008000
+
+// Both touch panels are mapped to the screen
+#define INPUT_WIDTH 960
+#define INPUT_HEIGHT 544
+
+#define INPUT_BUTTON_COUNT 14
+#define INPUT_MOUSE_GAIN_STEPS 64
+
+enum {
+  INPUT_ANALOG_LT,
+  INPUT_ANALOG_RT,
+  INPUT_ANALOG_LX,
+  INPUT_ANALOG_LY,
+  INPUT_ANALOG_RX,
+  INPUT_ANALOG_RY,
+  INPUT_ANALOG_COUNT
+};
+
+// What the pipeline takes from the configuration. Actions are special key
+// codes, 0 does nothing.
+typedef struct {
+  struct mapping map;
+  // samples per second
+  uint32_t rate;
+  // the PS TV has no touch panels
+  bool touch;
+  // border of the back panel that doesn't count, in screen pixels
+  int back_top, back_bottom, back_left, back_right;
+  // the front panel corner buttons
+  int special_size, special_offset;
+  uint32_t special_nw, special_ne, special_sw, special_se;
+  // front panel gestures
+  uint32_t tap, double_tap, two_finger_tap, drag;
+  uint32_t pinch_in, pinch_out;
+  uint32_t edge_left, edge_right, edge_top, edge_bottom;
+  int mouse_acceleration, mouse_curve;
+  // in percent of the stick travel
+  int left_deadzone, right_deadzone, anti_deadzone, stick_curve;
+} input_settings;
+
+// The controller state sent to the host
+typedef struct {
+  short button;
+  short lx;
+  short ly;
+  short rx;
+  short ry;
+  char  lt;
+  char  rt;
+} input_controller;
+
+typedef struct {
+  short button;
+  short finger;
+  short x[GESTURE_MAX_FINGERS];
+  short y[GESTURE_MAX_FINGERS];
+  uint8_t ids[GESTURE_MAX_FINGERS];
+} input_touch;
+
+// Every output is a pair of masks on the pad and touch buttons, analog
+// outputs may read a pad axis instead
+typedef struct {
+  short flag;
+  uint32_t pad_mask;
+  uint32_t touch_mask;
+} input_button_entry;
+
+typedef struct {
+  // index into the axes of a sample, -1 for buttons on an analog output
+  int axis;
+  bool stick;
+  bool reverse;
+  uint32_t pad_mask;
+  uint32_t touch_mask;
+} input_analog_entry;
+
+// Stick response by distance from the centre in pad units, as the gain
+// both axes are scaled by, Q4
+typedef struct {
+  uint32_t gain[256];
+} input_stick_response;
+
+typedef struct {
+  input_settings settings;
+  const input_sink *sink;
+
+  // the mapping compiled by config
+  input_button_entry buttons[INPUT_BUTTON_COUNT];
+  input_analog_entry analogs[INPUT_ANALOG_COUNT];
+  input_stick_response left_stick;
+  input_stick_response right_stick;
+  // the sections of each panel by column and row, a point lies in the
+  // sections set for both
+  uint8_t back_columns[INPUT_WIDTH + 1];
+  uint8_t back_rows[INPUT_HEIGHT + 1];
+  uint8_t front_columns[INPUT_WIDTH + 1];
+  uint8_t front_rows[INPUT_HEIGHT + 1];
+  // something is mapped to the back panel
+  bool back_touch;
+  // Q8 mouse gain per touch pixel, by touch pixels per 5 ms
+  uint16_t mouse_gain[INPUT_MOUSE_GAIN_STEPS];
+
+  // the sample being processed, lx, ly, rx, ry, lt, rt
+  uint64_t sample_us;
+  uint32_t pad_buttons;
+  uint8_t axes[6];
+
+  uint32_t pad_old_buttons;
+  input_touch touch;
+  input_touch touch_old;
+  input_controller curr;
+  input_controller old;
+  unsigned char last_axes[4];
+
+  // sub-pixel rest of the last move and the motion not sent yet, Q8
+  int32_t mouse_remainder_x;
+  int32_t mouse_remainder_y;
+  int32_t mouse_pending_x;
+  int32_t mouse_pending_y;
+  uint64_t mouse_sent_us;
+  int scroll_rest;
+
+  gesture_recognizer gestures;
+  bool drag_active;
+  uint32_t gesture_held;
+  uint64_t gesture_release_us;
+
+  uint32_t controller_events;
+  // samples a stick moved without anything to send
+  uint32_t stick_suppressed;
+} input_pipeline;
+
+// The default mapping of the Vita, or of a PS TV controller
+void input_default_mapping(struct mapping *map, bool vitatv);
+
+void input_pipeline_config(input_pipeline *p, const input_settings *settings, const input_sink *sink);
+// Forgets touches and pending motion, releasing held gesture actions
+void input_pipeline_reset(input_pipeline *p);
+// The mapping alone: the touched sections, curr and the corner buttons
+void input_pipeline_map(input_pipeline *p, const input_record_sample *sample);
+// Turns a sample into events, true when a controller event was sent
+bool input_pipeline_process(input_pipeline *p, const input_record_sample *sample);
+// Feeds a recording through the pipeline, which should send to the
+// capture sink, timing each sample with clock_us into cost. Returns the
+// number of samples.
+uint32_t input_pipeline_replay(input_pipeline *p, FILE *recording, histogram *cost, uint64_t (*clock_us)(void));
@@ -0,0 +1,191 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "record.h"
+
+#include <string.h>
+
+#define SAMPLE_HEADER_SIZE 20
+#define TOUCH_SIZE 5
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, v);
+  put_u16(p + 2, v >> 16);
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+  return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return get_u16(p) | (uint32_t) get_u16(p + 2) << 16;
+}
+
+FILE *input_record_open(const char *path, uint32_t rate) {
+  FILE *fd = fopen(path, "wb");
+  if (fd == NULL) {
+    return NULL;
+  }
+
+  uint8_t header[12];
+  put_u32(header, INPUT_RECORD_MAGIC);
+  put_u32(header + 4, INPUT_RECORD_VERSION);
+  put_u32(header + 8, rate);
+  if (fwrite(header, sizeof(header), 1, fd) != 1) {
+    fclose(fd);
+    return NULL;
+  }
+  return fd;
+}
+
+static uint8_t *write_touches(uint8_t *p, const input_record_touch *touches, int count) {
+  for (int i = 0; i < count; i++) {
+    p[0] = touches[i].id;
+    put_u16(p + 1, touches[i].x);
+    put_u16(p + 3, touches[i].y);
+    p += TOUCH_SIZE;
+  }
+  return p;
+}
+
+bool input_record_write(FILE *fd, const input_record_sample *sample) {
+  uint8_t buffer[SAMPLE_HEADER_SIZE + 2 * INPUT_RECORD_MAX_TOUCH * TOUCH_SIZE];
+  int front_count = sample->front_count < INPUT_RECORD_MAX_TOUCH ? sample->front_count : INPUT_RECORD_MAX_TOUCH;
+  int back_count = sample->back_count < INPUT_RECORD_MAX_TOUCH ? sample->back_count : INPUT_RECORD_MAX_TOUCH;
+
+  put_u32(buffer, sample->time_us);
+  put_u32(buffer + 4, sample->time_us >> 32);
+  put_u32(buffer + 8, sample->buttons);
+  buffer[12] = sample->lx;
+  buffer[13] = sample->ly;
+  buffer[14] = sample->rx;
+  buffer[15] = sample->ry;
+  buffer[16] = sample->lt;
+  buffer[17] = sample->rt;
+  buffer[18] = front_count;
+  buffer[19] = back_count;
+
+  uint8_t *end = write_touches(buffer + SAMPLE_HEADER_SIZE, sample->front, front_count);
+  end = write_touches(end, sample->back, back_count);
+  return fwrite(buffer, end - buffer, 1, fd) == 1;
+}
+
+FILE *input_replay_open(const char *path, uint32_t *rate) {
+  FILE *fd = fopen(path, "rb");
+  if (fd == NULL) {
+    return NULL;
+  }
+
+  uint8_t header[12];
+  if (fread(header, sizeof(header), 1, fd) != 1 ||
+      get_u32(header) != INPUT_RECORD_MAGIC || get_u32(header + 4) != INPUT_RECORD_VERSION ||
+      get_u32(header + 8) == 0) {
+    fclose(fd);
+    return NULL;
+  }
+  *rate = get_u32(header + 8);
+  return fd;
+}
+
+static bool read_touches(FILE *fd, input_record_touch *touches, int count) {
+  uint8_t buffer[INPUT_RECORD_MAX_TOUCH * TOUCH_SIZE];
+  if (count > INPUT_RECORD_MAX_TOUCH || (count > 0 && fread(buffer, TOUCH_SIZE * count, 1, fd) != 1)) {
+    return false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    const uint8_t *p = &buffer[i * TOUCH_SIZE];
+    touches[i].id = p[0];
+    touches[i].x = get_u16(p + 1);
+    touches[i].y = get_u16(p + 3);
+  }
+  return true;
+}
+
+bool input_replay_read(FILE *fd, input_record_sample *sample) {
+  uint8_t buffer[SAMPLE_HEADER_SIZE];
+  if (fread(buffer, sizeof(buffer), 1, fd) != 1) {
+    return false;
+  }
+
+  memset(sample, 0, sizeof(input_record_sample));
+  sample->time_us = get_u32(buffer) | (uint64_t) get_u32(buffer + 4) << 32;
+  sample->buttons = get_u32(buffer + 8);
+  sample->lx = buffer[12];
+  sample->ly = buffer[13];
+  sample->rx = buffer[14];
+  sample->ry = buffer[15];
+  sample->lt = buffer[16];
+  sample->rt = buffer[17];
+  sample->front_count = buffer[18];
+  sample->back_count = buffer[19];
+
+  return read_touches(fd, sample->front, sample->front_count) &&
+         read_touches(fd, sample->back, sample->back_count);
+}
+
+static FILE *capture_fd;
+static uint64_t capture_us;
+
+void input_capture_start(FILE *fd) {
+  capture_fd = fd;
+  capture_us = 0;
+}
+
+void input_capture_time(uint64_t time_us) {
+  capture_us = time_us;
+}
+
+static void capture_controller(short buttons, unsigned char lt, unsigned char rt,
+                               short lx, short ly, short rx, short ry) {
+  fprintf(capture_fd, "%llu controller %04x %u %u %d %d %d %d\n", (unsigned long long) capture_us,
+          (unsigned short) buttons, lt, rt, lx, ly, rx, ry);
+}
+
+static void capture_mouse_move(short dx, short dy) {
+  fprintf(capture_fd, "%llu mouse_move %d %d\n", (unsigned long long) capture_us, dx, dy);
+}
+
+static void capture_mouse_button(char action, int button) {
+  fprintf(capture_fd, "%llu mouse_button %d %d\n", (unsigned long long) capture_us, action, button);
+}
+
+static void capture_keyboard(short key, char action, char modifiers) {
+  fprintf(capture_fd, "%llu keyboard %d %d %d\n", (unsigned long long) capture_us, key, action, modifiers);
+}
+
+static void capture_scroll(signed char amount) {
+  fprintf(capture_fd, "%llu scroll %d\n", (unsigned long long) capture_us, amount);
+}
+
+static void capture_pause(void) {
+  fprintf(capture_fd, "%llu pause\n", (unsigned long long) capture_us);
+}
+
+const input_sink input_capture_sink = {
+  .controller = capture_controller,
+  .mouse_move = capture_mouse_move,
+  .mouse_button = capture_mouse_button,
+  .keyboard = capture_keyboard,
+  .scroll = capture_scroll,
+  .pause = capture_pause,
+};
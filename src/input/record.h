@@ -0,0 +1,70 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Raw input recording and the event capture used to replay it.
+//
+// A recording is a header with the sampling rate followed by one record
+// per input sample: the sample time, the pad buttons and axes, and the touch reports of both
+// panels. All values are little endian. Replaying feeds the samples back
+// through the input mapping with the events going to an input_sink, the
+// capture sink writes them as one line of text each, so two builds can be
+// compared with diff.
+#define INPUT_RECORD_MAGIC 0x52494c4d
+#define INPUT_RECORD_VERSION 2
+#define INPUT_RECORD_MAX_TOUCH 8
+
+typedef struct {
+  uint8_t id;
+  int16_t x;
+  int16_t y;
+} input_record_touch;
+
+typedef struct {
+  uint64_t time_us;
+  uint32_t buttons;
+  uint8_t lx, ly, rx, ry, lt, rt;
+  uint8_t front_count;
+  uint8_t back_count;
+  input_record_touch front[INPUT_RECORD_MAX_TOUCH];
+  input_record_touch back[INPUT_RECORD_MAX_TOUCH];
+} input_record_sample;
+
+typedef struct {
+  void (*controller)(short buttons, unsigned char lt, unsigned char rt,
+                     short lx, short ly, short rx, short ry);
+  void (*mouse_move)(short dx, short dy);
+  void (*mouse_button)(char action, int button);
+  void (*keyboard)(short key, char action, char modifiers);
+  void (*scroll)(signed char amount);
+  void (*pause)(void);
+} input_sink;
+
+FILE *input_record_open(const char *path, uint32_t rate);
+bool input_record_write(FILE *fd, const input_record_sample *sample);
+
+FILE *input_replay_open(const char *path, uint32_t *rate);
+bool input_replay_read(FILE *fd, input_record_sample *sample);
+
+extern const input_sink input_capture_sink;
+void input_capture_start(FILE *fd);
+void input_capture_time(uint64_t time_us);
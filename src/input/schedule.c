@@ -0,0 +1,31 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "schedule.h"
+
+uint64_t input_next_sample(uint64_t now_us, uint64_t scheduled_us, uint64_t frame_us,
+                           uint32_t interval_us, uint32_t lead_us) {
+  if (frame_us == 0 || interval_us <= lead_us) {
+    return scheduled_us;
+  }
+
+  uint64_t aligned_us = frame_us + interval_us - lead_us;
+  if (aligned_us <= now_us) {
+    aligned_us += ((now_us - aligned_us) / interval_us + 1) * interval_us;
+  }
+  return aligned_us < scheduled_us ? aligned_us : scheduled_us;
+}
@@ -0,0 +1,30 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Input sample scheduling. Samples follow a fixed period, optionally
+// pulled in to land lead_us ahead of the next expected video frame. It
+// only sees the clock values it is given, so it can be simulated.
+
+// Next sample time: the one scheduled, or the one just ahead of the next
+// frame after frame_us when that comes first. A frame_us of 0 means no
+// frame clock.
+uint64_t input_next_sample(uint64_t now_us, uint64_t scheduled_us, uint64_t frame_us,
+                           uint32_t interval_us, uint32_t lead_us);
@@ -22,7 +22,6 @@
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
-#include <math.h>
 #include <sys/types.h>
 #include <openssl/rand.h>
 #include <openssl/evp.h>
@@ -31,8 +30,14 @@
 #include "../graphics.h"
 #include "../config.h"
 #include "../connection.h"
+#include "../debug.h"
+#include "../histogram.h"
+#include "../video/vita.h"
 #include "vita.h"
 #include "mapping.h"
+#include "pipeline.h"
+#include "record.h"
+#include "schedule.h"
 
 #include <Limelight.h>
 
@@ -40,436 +45,211 @@
 #include <psp2/sysmodule.h>
 #include <psp2/kernel/sysmem.h>
 #include <psp2/kernel/threadmgr.h>
+#include <psp2/kernel/processmgr.h>
 
 #include <psp2/ctrl.h>
 #include <psp2/touch.h>
-#include <psp2/rtc.h>
 
-#define WIDTH 960
-#define HEIGHT 544
+_Static_assert(INPUT_PAD_SELECT == SCE_CTRL_SELECT && INPUT_PAD_L3 == SCE_CTRL_L3 &&
+               INPUT_PAD_R3 == SCE_CTRL_R3 && INPUT_PAD_START == SCE_CTRL_START &&
+               INPUT_PAD_UP == SCE_CTRL_UP && INPUT_PAD_RIGHT == SCE_CTRL_RIGHT &&
+               INPUT_PAD_DOWN == SCE_CTRL_DOWN && INPUT_PAD_LEFT == SCE_CTRL_LEFT &&
+               INPUT_PAD_L1 == SCE_CTRL_L1 && INPUT_PAD_R1 == SCE_CTRL_R1 &&
+               INPUT_PAD_TRIANGLE == SCE_CTRL_TRIANGLE && INPUT_PAD_CIRCLE == SCE_CTRL_CIRCLE &&
+               INPUT_PAD_CROSS == SCE_CTRL_CROSS && INPUT_PAD_SQUARE == SCE_CTRL_SQUARE,
+               "the pipeline takes SceCtrlData buttons as they are");
 
 struct mapping map = {0};
 
-typedef struct input_data {
-    short button;
-    short lx;
-    short ly;
-    short rx;
-    short ry;
-    char  lt;
-    char  rt;
-} input_data;
-
-typedef struct Point {
-  short x;
-  short y;
-} Point;
-
-typedef struct Section {
-  Point left;
-  Point right;
-} Section;
-
-typedef struct TouchData {
-  short button;
-  short finger;
-  Point points[4];
-} TouchData;
-
-#define lerp(value, from_max, to_max) ((((value*10) * (to_max*10))/(from_max*10))/10)
-
-double mouse_multiplier;
-
-#define MOUSE_ACTION_DELAY 100000 // 100ms
-
-inline bool mouse_click(short finger_count, bool press) {
-  int mode;
-
-  if (press) {
-    mode = BUTTON_ACTION_PRESS;
-  } else {
-    mode = BUTTON_ACTION_RELEASE;
-  }
+// Input is sampled on a fixed schedule of input_rate samples per second.
+// With input_align the schedule is shifted so a sample lands just before
+// the next frame is expected, which keeps input at a steady point of the
+// host's capture interval instead of drifting through it.
+#define INPUT_MIN_RATE 60
+#define INPUT_MAX_RATE 250
+#define INPUT_ALIGN_LEAD_US 2000
+
+static uint32_t input_rate = 200;
+static bool read_front_touch = true;
+static bool read_back_touch = true;
+
+// sample->sent covers processing up to LiSendControllerEvent returning,
+// wake shows how late the thread woke up for a sample
+static histogram input_send;
+static histogram input_wake;
+
+static uint32_t elapsed_us(uint64_t from_us, uint64_t to_us) {
+  return to_us > from_us ? to_us - from_us : 0;
+}
 
-  switch (finger_count) {
-    case 1:
-      LiSendMouseButtonEvent(mode, BUTTON_LEFT);
-      return true;
-    case 2:
-      LiSendMouseButtonEvent(mode, BUTTON_RIGHT);
-      return true;
-  }
-  return false;
+static void limelight_controller(short buttons, unsigned char lt, unsigned char rt,
+                                 short lx, short ly, short rx, short ry) {
+  LiSendControllerEvent(buttons, lt, rt, lx, ly, rx, ry);
 }
 
-inline void move_mouse(TouchData old, TouchData cur) {
-  double delta_x = (cur.points[0].x - old.points[0].x) / 2.;
-  double delta_y = (cur.points[0].y - old.points[0].y) / 2.;
+static void limelight_mouse_move(short dx, short dy) {
+  LiSendMouseMoveEvent(dx, dy);
+}
 
-  if (delta_x == 0 && delta_y == 0) {
-    return;
-  }
+static void limelight_mouse_button(char action, int button) {
+  LiSendMouseButtonEvent(action, button);
+}
 
-  int x = lround(delta_x * mouse_multiplier);
-  int y = lround(delta_y * mouse_multiplier);
+static void limelight_keyboard(short key, char action, char modifiers) {
+  LiSendKeyboardEvent(key, action, modifiers);
+}
 
-  LiSendMouseMoveEvent(x, y);
+static void limelight_scroll(signed char amount) {
+  LiSendScrollEvent(amount);
 }
 
-inline void move_wheel(TouchData old, TouchData cur) {
-  int old_y = (old.points[0].y + old.points[1].y) / 2;
-  int cur_y = (cur.points[0].y + cur.points[1].y) / 2;
-  int delta_y = (cur_y - old_y) / 2;
-  if (!delta_y) {
-    return;
-  }
-  LiSendScrollEvent(delta_y);
+static void limelight_pause(void) {
+  connection_minimize();
 }
 
-SceCtrlData pad, pad_old;
-TouchData touch;
-TouchData touch_old, swipe;
+static const input_sink limelight_sink = {
+  .controller = limelight_controller,
+  .mouse_move = limelight_mouse_move,
+  .mouse_button = limelight_mouse_button,
+  .keyboard = limelight_keyboard,
+  .scroll = limelight_scroll,
+  .pause = limelight_pause,
+};
+
+// The mapping settings from the config, the live pipeline sends what the
+// input thread samples to the host
+static input_settings settings;
+static input_pipeline live;
+
+SceCtrlData pad;
 SceTouchData front, back;
 
-int front_state = NO_TOUCH_ACTION;
-short finger_count = 0;
-SceRtcTick current, until;
-
+#define INPUT_RECORD_PATH "ux0:data/moonlight/input.rec"
 
-static int special_status;
-
-input_data curr, old;
 int controller_port;
 
-// TODO config
-static int VERTICAL;
-static int HORIZONTAL;
-
-#define IN_SECTION(SECTION, X, Y) \
-    ((SECTION).left.x <= (X) && (X) <= (SECTION).right.x && \
-     (SECTION).left.y <= (Y) && (Y) <= (SECTION).right.y)
-
-// TODO sections
-Section BACK_SECTIONS[4];
-Section FRONT_SECTIONS[4];
-
-inline uint8_t read_backscreen() {
-  for (int i = 0; i < back.reportNum; i++) {
-    int x = lerp(back.report[i].x, 1919, WIDTH);
-    int y = lerp(back.report[i].y, 1087, HEIGHT);
-
-    if ((touch.button & TOUCHSEC_NORTHWEST) == 0) {
-      if (IN_SECTION(BACK_SECTIONS[0], x, y)) {
-        touch.button |= TOUCHSEC_NORTHWEST;
-        continue;
-      }
-    }
-
-    if ((touch.button & TOUCHSEC_NORTHEAST) == 0) {
-      if (IN_SECTION(BACK_SECTIONS[1], x, y)) {
-        touch.button |= TOUCHSEC_NORTHEAST;
-        continue;
-      }
-    }
-
-    if ((touch.button & TOUCHSEC_SOUTHWEST) == 0) {
-      if (IN_SECTION(BACK_SECTIONS[2], x, y)) {
-        touch.button |= TOUCHSEC_SOUTHWEST;
-        continue;
-      }
-    }
-
-    if ((touch.button & TOUCHSEC_SOUTHEAST) == 0) {
-      if (IN_SECTION(BACK_SECTIONS[3], x, y)) {
-        touch.button |= TOUCHSEC_SOUTHEAST;
-        continue;
-      }
-    }
+// Raw samples are written here while recording, only by the input
+// thread. The config asks for a recording at a rate, or for none with 0,
+// and the thread opens or closes the file when the request changes.
+static volatile uint32_t record_request;
+static FILE *record_fd;
+static uint32_t record_rate;
+
+static void record_touches(input_record_touch *touches, uint8_t *count, const SceTouchData *data) {
+  *count = data->reportNum < INPUT_RECORD_MAX_TOUCH ? data->reportNum : INPUT_RECORD_MAX_TOUCH;
+  for (int i = 0; i < *count; i++) {
+    touches[i].id = data->report[i].id;
+    touches[i].x = data->report[i].x;
+    touches[i].y = data->report[i].y;
   }
-  return 0;
 }
 
+static void vitainput_update_recording(void) {
+  uint32_t request = record_request;
+  if (request == record_rate) {
+    return;
+  }
 
-inline uint8_t read_frontscreen() {
-  for (int i = 0; i < front.reportNum; i++) {
-    int x = lerp(front.report[i].x, 1919, WIDTH);
-    int y = lerp(front.report[i].y, 1087, HEIGHT);
-
-    if ((touch.button & TOUCHSEC_SPECIAL_NW) == 0) {
-      if (IN_SECTION(FRONT_SECTIONS[0], x, y)) {
-        touch.button |= TOUCHSEC_SPECIAL_NW;
-        continue;
-      }
-    }
-
-    if ((touch.button & TOUCHSEC_SPECIAL_NE) == 0) {
-      if (IN_SECTION(FRONT_SECTIONS[1], x, y)) {
-        touch.button |= TOUCHSEC_SPECIAL_NE;
-        continue;
-      }
-    }
-
-    if ((touch.button & TOUCHSEC_SPECIAL_SW) == 0) {
-      if (IN_SECTION(FRONT_SECTIONS[2], x, y)) {
-        touch.button |= TOUCHSEC_SPECIAL_SW;
-        continue;
-      }
-    }
-
-    if ((touch.button & TOUCHSEC_SPECIAL_SE) == 0) {
-      if (IN_SECTION(FRONT_SECTIONS[3], x, y)) {
-        touch.button |= TOUCHSEC_SPECIAL_SE;
-        continue;
-      }
+  // a recording has a single sampling rate, start a new one on a change
+  if (record_fd) {
+    fclose(record_fd);
+    record_fd = NULL;
+  }
+  record_rate = request;
+  if (request) {
+    record_fd = input_record_open(INPUT_RECORD_PATH, request);
+    if (!record_fd) {
+      vita_debug_log("input: can't record to %s\n", INPUT_RECORD_PATH);
     }
-
-    // FIXME if touch same section using multiple finger, they can count finger
-    touch.points[touch.finger].x = x;
-    touch.points[touch.finger].y = y;
-    touch.finger += 1;
   }
-  return 0;
 }
 
-inline uint32_t is_pressed(uint32_t defined) {
-  uint32_t dev_type = defined & INPUT_TYPE_MASK;
-  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+// Reads the pad and the touch panels in use into a sample, recording it
+// if enabled
+static void vitainput_sample(input_record_sample *sample) {
+  memset(&pad, 0, sizeof(pad));
+  sceCtrlPeekBufferPositiveExt2(controller_port, &pad, 1);
+  sample->time_us = sceKernelGetProcessTimeWide();
 
-  switch(dev_type) {
-    case INPUT_TYPE_GAMEPAD:
-      return pad.buttons & dev_val;
-    case INPUT_TYPE_TOUCHSCREEN:
-      return touch.button & dev_val;
+  front.reportNum = 0;
+  back.reportNum = 0;
+  if (read_front_touch) {
+    sceTouchPeek(SCE_TOUCH_PORT_FRONT, &front, 1);
   }
-  return 0;
-}
-
-inline uint32_t is_old_pressed(uint32_t defined) {
-  uint32_t dev_type = defined & INPUT_TYPE_MASK;
-  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
-
-  switch(dev_type) {
-    case INPUT_TYPE_GAMEPAD:
-      return pad_old.buttons & dev_val;
-    case INPUT_TYPE_TOUCHSCREEN:
-      return touch_old.button & dev_val;
+  if (read_back_touch) {
+    sceTouchPeek(SCE_TOUCH_PORT_BACK, &back, 1);
   }
-  return 0;
-}
 
-inline short read_analog(uint32_t defined) {
-  uint32_t dev_type = defined & INPUT_TYPE_MASK;
-  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
-
-  if (dev_type == INPUT_TYPE_ANALOG) {
-    int v;
-    switch(dev_val) {
-      case LEFTX:
-        v = pad.lx;
-        break;
-      case LEFTY:
-        v = pad.ly;
-        break;
-      case RIGHTX:
-        v = pad.rx;
-        break;
-      case RIGHTY:
-        v = pad.ry;
-        break;
-      case LEFT_TRIGGER:
-        return pad.lt;
-      case RIGHT_TRIGGER:
-        return pad.rt;
-      default:
-        return 0;
-    }
-    v = v * 256 - (1 << 15) + 128;
-    return (short)(v);
+  sample->buttons = pad.buttons;
+  sample->lx = pad.lx;
+  sample->ly = pad.ly;
+  sample->rx = pad.rx;
+  sample->ry = pad.ry;
+  sample->lt = pad.lt;
+  sample->rt = pad.rt;
+  record_touches(sample->front, &sample->front_count, &front);
+  record_touches(sample->back, &sample->back_count, &back);
+
+  if (record_fd && !input_record_write(record_fd, sample)) {
+    vita_debug_log("input: recording failed\n");
+    fclose(record_fd);
+    record_fd = NULL;
   }
-  return is_pressed(defined) ? 0xff : 0;
 }
 
-inline void special(uint32_t defined, uint32_t pressed, uint32_t old_pressed) {
-  uint32_t dev_type = defined & INPUT_TYPE_MASK;
-  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
-
-  if (pressed) {
-    switch(dev_type) {
-      case INPUT_TYPE_SPECIAL:
-        if (dev_val == INPUT_SPECIAL_KEY_PAUSE) {
-          connection_minimize();
-          return;
-        }
-      case INPUT_TYPE_GAMEPAD:
-        curr.button |= dev_val;
-        return;
-      case INPUT_TYPE_ANALOG:
-        switch(dev_val) {
-          case LEFT_TRIGGER:
-            curr.lt = 0xff;
-            return;
-          case RIGHT_TRIGGER:
-            curr.rt = 0xff;
-            return;
-        }
-        return;
-      case INPUT_TYPE_MOUSE:
-        if (!old_pressed) {
-          LiSendMouseButtonEvent(BUTTON_ACTION_PRESS, dev_val);
-        }
-        return;
-      case INPUT_TYPE_KEYBOARD:
-       if (!old_pressed) {
-          LiSendKeyboardEvent(dev_val, KEY_ACTION_DOWN, 0);
-       }
-       return;
-    }
-  } else {
-    // released
-    switch(dev_type) {
-      case INPUT_TYPE_MOUSE:
-        if (old_pressed) {
-          LiSendMouseButtonEvent(BUTTON_ACTION_RELEASE, dev_val);
-        }
-        return;
-      case INPUT_TYPE_KEYBOARD:
-        if (old_pressed) {
-          LiSendKeyboardEvent(dev_val, KEY_ACTION_UP, 0);
-        }
-        return;
-    }
+static uint8_t active_input_thread = 0;
+
+// Next sample time, the regular one or the one just ahead of the next
+// expected frame, whichever comes first
+static uint64_t vitainput_next_sample(uint64_t now, uint64_t scheduled_us) {
+  if (!config.input_align) {
+    return scheduled_us;
   }
 
+  uint64_t frame_us;
+  uint32_t interval_us;
+  vitavideo_get_frame_clock(&frame_us, &interval_us);
+  return input_next_sample(now, scheduled_us, frame_us, interval_us, INPUT_ALIGN_LEAD_US);
 }
 
-static inline void vitainput_process(void) {
-  memset(&pad, 0, sizeof(pad));
-  memset(&touch, 0, sizeof(TouchData));
-  memset(&curr, 0, sizeof(input_data));
-
-  sceCtrlSetSamplingModeExt(SCE_CTRL_MODE_ANALOG_WIDE);
-  sceCtrlPeekBufferPositiveExt2(controller_port, &pad, 1);
+int vitainput_thread(SceSize args, void *argp) {
+  uint64_t scheduled_us = 0;
+  bool sampled = false;
+  input_record_sample sample;
 
-  sceTouchPeek(SCE_TOUCH_PORT_FRONT, &front, 1);
-  sceTouchPeek(SCE_TOUCH_PORT_BACK, &back, 1);
-  read_frontscreen();
-  read_backscreen();
-
-  sceRtcGetCurrentTick(&current);
-
-  // buttons
-  curr.button |= is_pressed(map.btn_dpad_up)    ? UP_FLAG     : 0;
-  curr.button |= is_pressed(map.btn_dpad_left)  ? LEFT_FLAG   : 0;
-  curr.button |= is_pressed(map.btn_dpad_down)  ? DOWN_FLAG   : 0;
-  curr.button |= is_pressed(map.btn_dpad_right) ? RIGHT_FLAG  : 0;
-  curr.button |= is_pressed(map.btn_start)      ? PLAY_FLAG   : 0;
-  curr.button |= is_pressed(map.btn_select)     ? BACK_FLAG   : 0;
-  curr.button |= is_pressed(map.btn_north)      ? Y_FLAG      : 0;
-  curr.button |= is_pressed(map.btn_east)       ? B_FLAG      : 0;
-  curr.button |= is_pressed(map.btn_south)      ? A_FLAG      : 0;
-  curr.button |= is_pressed(map.btn_west)       ? X_FLAG      : 0;
-  curr.button |= is_pressed(map.btn_thumbl)     ? LB_FLAG     : 0; // l1
-  curr.button |= is_pressed(map.btn_thumbr)     ? RB_FLAG     : 0; // r1
-  curr.button |= is_pressed(map.btn_tl2)        ? LS_CLK_FLAG : 0; // l3
-  curr.button |= is_pressed(map.btn_tr2)        ? RS_CLK_FLAG : 0; // r3
-
-  // analogs
-  curr.lt = read_analog(map.btn_tl); // l2
-  curr.rt = read_analog(map.btn_tr); // r2
-  curr.lx = read_analog(map.abs_x);
-  curr.ly = read_analog(map.abs_y);
-  curr.rx = read_analog(map.abs_rx);
-  curr.ry = read_analog(map.abs_ry);
-
-  // special touchscreen buttons
-  special(config.special_keys.nw,
-          is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NW),
-          is_old_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NW));
-  special(config.special_keys.ne,
-          is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NE),
-          is_old_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NE));
-  special(config.special_keys.sw,
-          is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SW),
-          is_old_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SW));
-  special(config.special_keys.se,
-          is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SE),
-          is_old_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SE));
-
-  // mouse
-  switch (front_state) {
-    case NO_TOUCH_ACTION:
-      if (touch.finger > 0) {
-        front_state = ON_SCREEN_TOUCH;
-        finger_count = touch.finger;
-        sceRtcTickAddMicroseconds(&until, &current, MOUSE_ACTION_DELAY);
-      }
-      break;
-    case ON_SCREEN_TOUCH:
-      if (sceRtcCompareTick(&current, &until) < 0) {
-        if (touch.finger < finger_count) {
-          // TAP
-          if (mouse_click(finger_count, true)) {
-            front_state = SCREEN_TAP;
-            sceRtcTickAddMicroseconds(&until, &current, MOUSE_ACTION_DELAY);
-          } else {
-            front_state = NO_TOUCH_ACTION;
-          }
-        } else if (touch.finger > finger_count) {
-          // finger count changed
-          finger_count = touch.finger;
-        }
-      } else {
-        front_state = SWIPE_START;
-      }
-      break;
-    case SCREEN_TAP:
-      if (sceRtcCompareTick(&current, &until) >= 0) {
-        mouse_click(finger_count, false);
+  while (1) {
+    vitainput_update_recording();
 
-        front_state = NO_TOUCH_ACTION;
+    uint32_t period_us = 1000000 / input_rate;
+    if (!active_input_thread) {
+      if (sampled && record_fd) {
+        // keep what the stream recorded should the app be closed
+        fflush(record_fd);
       }
-      break;
-    case SWIPE_START:
-      memcpy(&swipe, &touch, sizeof(swipe));
-      front_state = ON_SCREEN_SWIPE;
-      break;
-    case ON_SCREEN_SWIPE:
-      if (touch.finger > 0) {
-        switch (touch.finger) {
-          case 1:
-            move_mouse(swipe, touch);
-            break;
-          case 2:
-            move_wheel(swipe, touch);
-            break;
-        }
-        memcpy(&swipe, &touch, sizeof(swipe));
-      } else {
-        front_state = NO_TOUCH_ACTION;
-      }
-      break;
-  }
-
-  if (memcmp(&curr, &old, sizeof(input_data)) != 0) {
-    LiSendControllerEvent(curr.button, curr.lt, curr.rt,
-                          curr.lx, -1 * curr.ly, curr.rx, -1 * curr.ry);
-    memcpy(&old, &curr, sizeof(input_data));
-    memcpy(&pad_old, &pad, sizeof(SceCtrlData));
-  }
-  if (memcmp(&touch, &touch_old, sizeof(TouchData)) != 0) {
-    memcpy(&touch_old, &touch, sizeof(TouchData));
-  }
-}
+      sampled = false;
+      scheduled_us = 0;
+      sceKernelDelayThread(period_us);
+      continue;
+    }
 
-static uint8_t active_input_thread = 0;
+    uint64_t now = sceKernelGetProcessTimeWide();
+    if (scheduled_us == 0 || now > scheduled_us + period_us) {
+      // just started, or a stall put the schedule more than a sample behind
+      scheduled_us = now;
+    }
 
-int vitainput_thread(SceSize args, void *argp) {
-  while (1) {
-    if (active_input_thread) {
-      vitainput_process();
+    uint64_t deadline_us = vitainput_next_sample(now, scheduled_us);
+    if (deadline_us > now) {
+      sceKernelDelayThread(deadline_us - now);
     }
+    histogram_add(&input_wake, elapsed_us(deadline_us, sceKernelGetProcessTimeWide()));
 
-    sceKernelDelayThread(5000); // 5 ms
+    vitainput_sample(&sample);
+    if (input_pipeline_process(&live, &sample)) {
+      histogram_add(&input_send, elapsed_us(sample.time_us, sceKernelGetProcessTimeWide()));
+    }
+    sampled = true;
+    scheduled_us = deadline_us + period_us;
   }
 
   return 0;
@@ -490,37 +270,7 @@ bool vitainput_init() {
 }
 
 void vitainput_config(CONFIGURATION config) {
-  map.abs_x           = LEFTX               | INPUT_TYPE_ANALOG;
-  map.abs_y           = LEFTY               | INPUT_TYPE_ANALOG;
-  map.abs_rx          = RIGHTX              | INPUT_TYPE_ANALOG;
-  map.abs_ry          = RIGHTY              | INPUT_TYPE_ANALOG;
-
-  map.btn_dpad_up     = SCE_CTRL_UP         | INPUT_TYPE_GAMEPAD;
-  map.btn_dpad_down   = SCE_CTRL_DOWN       | INPUT_TYPE_GAMEPAD;
-  map.btn_dpad_left   = SCE_CTRL_LEFT       | INPUT_TYPE_GAMEPAD;
-  map.btn_dpad_right  = SCE_CTRL_RIGHT      | INPUT_TYPE_GAMEPAD;
-  map.btn_south       = SCE_CTRL_CROSS      | INPUT_TYPE_GAMEPAD;
-  map.btn_east        = SCE_CTRL_CIRCLE     | INPUT_TYPE_GAMEPAD;
-  map.btn_north       = SCE_CTRL_TRIANGLE   | INPUT_TYPE_GAMEPAD;
-  map.btn_west        = SCE_CTRL_SQUARE     | INPUT_TYPE_GAMEPAD;
-
-  map.btn_select      = SCE_CTRL_SELECT     | INPUT_TYPE_GAMEPAD;
-  map.btn_start       = SCE_CTRL_START      | INPUT_TYPE_GAMEPAD;
-
-  map.btn_thumbl      = SCE_CTRL_L1         | INPUT_TYPE_GAMEPAD;
-  map.btn_thumbr      = SCE_CTRL_R1         | INPUT_TYPE_GAMEPAD;
-
-  if (config.model == SCE_KERNEL_MODEL_VITATV) {
-    map.btn_tl        = LEFT_TRIGGER        | INPUT_TYPE_ANALOG;
-    map.btn_tr        = RIGHT_TRIGGER       | INPUT_TYPE_ANALOG;
-    map.btn_tl2       = SCE_CTRL_L3         | INPUT_TYPE_GAMEPAD;
-    map.btn_tr2       = SCE_CTRL_R3         | INPUT_TYPE_GAMEPAD;
-  } else {
-    map.btn_tl        = TOUCHSEC_NORTHWEST  | INPUT_TYPE_TOUCHSCREEN;
-    map.btn_tr        = TOUCHSEC_NORTHEAST  | INPUT_TYPE_TOUCHSCREEN;
-    map.btn_tl2       = TOUCHSEC_SOUTHWEST  | INPUT_TYPE_TOUCHSCREEN;
-    map.btn_tr2       = TOUCHSEC_SOUTHEAST  | INPUT_TYPE_TOUCHSCREEN;
-  }
+  input_default_mapping(&map, config.model == SCE_KERNEL_MODEL_VITATV);
 
   if (config.mapping) {
     char mapping_file_path[256];
@@ -531,58 +281,115 @@ void vitainput_config(CONFIGURATION config) {
 
   controller_port = config.model == SCE_KERNEL_MODEL_VITATV ? 1 : 0;
 
-  VERTICAL   = (WIDTH - config.back_deadzone.left - config.back_deadzone.right) / 2
-             + config.back_deadzone.left;
-  HORIZONTAL = (HEIGHT - config.back_deadzone.top - config.back_deadzone.bottom) / 2
-             + config.back_deadzone.top;
-
-  BACK_SECTIONS[0].left.x  = config.back_deadzone.left;
-  BACK_SECTIONS[0].left.y  = config.back_deadzone.top;
-  BACK_SECTIONS[0].right.x = VERTICAL;
-  BACK_SECTIONS[0].right.y = HORIZONTAL;
-
-  BACK_SECTIONS[1].left.x  = VERTICAL;
-  BACK_SECTIONS[1].left.y  = config.back_deadzone.top;
-  BACK_SECTIONS[1].right.x = WIDTH - config.back_deadzone.right;
-  BACK_SECTIONS[1].right.y = HORIZONTAL;
-
-  BACK_SECTIONS[2].left.x  = config.back_deadzone.left;
-  BACK_SECTIONS[2].left.y  = HORIZONTAL;
-  BACK_SECTIONS[2].right.x = VERTICAL;
-  BACK_SECTIONS[2].right.y = HEIGHT - config.back_deadzone.bottom;
-
-  BACK_SECTIONS[3].left.x  = VERTICAL;
-  BACK_SECTIONS[3].left.y  = HORIZONTAL;
-  BACK_SECTIONS[3].right.x = WIDTH - config.back_deadzone.right;
-  BACK_SECTIONS[3].right.y = HEIGHT - config.back_deadzone.bottom;
-
-  FRONT_SECTIONS[0].left.x  = config.special_keys.offset;
-  FRONT_SECTIONS[0].left.y  = config.special_keys.offset;
-  FRONT_SECTIONS[0].right.x = config.special_keys.offset + config.special_keys.size;
-  FRONT_SECTIONS[0].right.y = config.special_keys.offset + config.special_keys.size;
-
-  FRONT_SECTIONS[1].left.x  = WIDTH - config.special_keys.offset - config.special_keys.size;
-  FRONT_SECTIONS[1].left.y  = config.special_keys.offset;
-  FRONT_SECTIONS[1].right.x = WIDTH - config.special_keys.offset;
-  FRONT_SECTIONS[1].right.y = config.special_keys.offset + config.special_keys.size;
-
-  FRONT_SECTIONS[2].left.x  = config.special_keys.offset;
-  FRONT_SECTIONS[2].left.y  = HEIGHT - config.special_keys.offset - config.special_keys.size;
-  FRONT_SECTIONS[2].right.x = config.special_keys.offset + config.special_keys.size;
-  FRONT_SECTIONS[2].right.y = HEIGHT - config.special_keys.offset;
-
-  FRONT_SECTIONS[3].left.x  = WIDTH - config.special_keys.offset - config.special_keys.size;
-  FRONT_SECTIONS[3].left.y  = HEIGHT - config.special_keys.offset - config.special_keys.size;
-  FRONT_SECTIONS[3].right.x = WIDTH - config.special_keys.offset;
-  FRONT_SECTIONS[3].right.y = HEIGHT - config.special_keys.offset;
-
-  mouse_multiplier = 1 + (0.01 * config.mouse_acceleration);
+  input_rate = config.input_rate;
+  if (input_rate < INPUT_MIN_RATE) {
+    input_rate = INPUT_MIN_RATE;
+  } else if (input_rate > INPUT_MAX_RATE) {
+    input_rate = INPUT_MAX_RATE;
+  }
+
+  settings.map = map;
+  settings.rate = input_rate;
+  // the PS TV has no touch panels
+  settings.touch = config.model != SCE_KERNEL_MODEL_VITATV;
+  settings.back_top = config.back_deadzone.top;
+  settings.back_bottom = config.back_deadzone.bottom;
+  settings.back_left = config.back_deadzone.left;
+  settings.back_right = config.back_deadzone.right;
+  settings.special_size = config.special_keys.size;
+  settings.special_offset = config.special_keys.offset;
+  settings.special_nw = config.special_keys.nw;
+  settings.special_ne = config.special_keys.ne;
+  settings.special_sw = config.special_keys.sw;
+  settings.special_se = config.special_keys.se;
+  settings.tap = config.gestures.tap;
+  settings.double_tap = config.gestures.double_tap;
+  settings.two_finger_tap = config.gestures.two_finger_tap;
+  settings.drag = config.gestures.drag;
+  settings.pinch_in = config.gestures.pinch_in;
+  settings.pinch_out = config.gestures.pinch_out;
+  settings.edge_left = config.gestures.edge_left;
+  settings.edge_right = config.gestures.edge_right;
+  settings.edge_top = config.gestures.edge_top;
+  settings.edge_bottom = config.gestures.edge_bottom;
+  settings.mouse_acceleration = config.mouse_acceleration;
+  settings.mouse_curve = config.mouse_curve;
+  settings.left_deadzone = config.left_deadzone;
+  settings.right_deadzone = config.right_deadzone;
+  settings.anti_deadzone = config.anti_deadzone;
+  settings.stick_curve = config.stick_curve;
+
+  input_pipeline_config(&live, &settings, &limelight_sink);
+
+  // the back panel is only read when something is mapped to its quarters
+  read_front_touch = settings.touch;
+  read_back_touch = live.back_touch;
+
+  // handed to the input thread, which owns the file
+  record_request = config.record_input ? input_rate : 0;
 }
 
 void vitainput_start(void) {
+  // the menus switch the pad to the plain sampling mode
+  sceCtrlSetSamplingModeExt(SCE_CTRL_MODE_ANALOG_WIDE);
+  // fingers may have lifted while the stream was paused
+  input_pipeline_reset(&live);
+  // the histograms cover one stretch of streaming, logged on stop
+  histogram_init(&input_send, "input sample->sent", 100);
+  histogram_init(&input_wake, "input schedule->wake", 100);
   active_input_thread = true;
 }
 
 void vitainput_stop(void) {
   active_input_thread = false;
+  vita_debug_log("input: %u samples per second%s\n", input_rate,
+                 config.input_align ? ", aligned to frames" : "");
+  vita_debug_log("input: %u controller events, %u stick jitter events suppressed, %u gestures dropped\n",
+                 live.controller_events, live.stick_suppressed, live.gestures.dropped);
+  histogram_log(&input_send);
+  histogram_log(&input_wake);
+}
+
+static uint64_t vitainput_clock_us(void) {
+  return sceKernelGetProcessTimeWide();
+}
+
+bool vitainput_replay(const char *path) {
+  uint32_t rate;
+  FILE *fd = input_replay_open(path, &rate);
+  if (!fd) {
+    vita_debug_log("input replay: can't read %s\n", path);
+    return false;
+  }
+
+  char events_path[256];
+  snprintf(events_path, sizeof(events_path), "%s.events", path);
+  FILE *events = fopen(events_path, "w");
+  if (!events) {
+    vita_debug_log("input replay: can't write %s\n", events_path);
+    fclose(fd);
+    return false;
+  }
+
+  histogram cost;
+  histogram_init(&cost, "input replay sample", 10);
+
+  // a pipeline of its own, timed at the rate the samples were taken at,
+  // so the live one keeps its state and counters
+  static input_pipeline replay;
+  input_settings replay_settings = settings;
+  replay_settings.rate = rate;
+  input_pipeline_config(&replay, &replay_settings, &input_capture_sink);
+
+  input_capture_start(events);
+  uint32_t samples = input_pipeline_replay(&replay, fd, &cost, vitainput_clock_us);
+  fclose(events);
+  fclose(fd);
+
+  vita_debug_log("input replay: %u samples at %u per second from %s, events in %s\n",
+                 samples, rate, path, events_path);
+  vita_debug_log("input replay: %u controller events, %u stick jitter events suppressed, %u gestures dropped\n",
+                 replay.controller_events, replay.stick_suppressed, replay.gestures.dropped);
+  histogram_log(&cost);
+  return true;
 }
@@ -17,51 +17,12 @@
  * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
  */
 
-typedef enum {
-  NO_TOUCH_ACTION = 0,
-  ON_SCREEN_TOUCH,
-  SCREEN_TAP,
-  SWIPE_START,
-  ON_SCREEN_SWIPE
-} TouchScreenState;
-
-typedef enum {
-  TOUCHSEC_NORTHWEST  = 0x1,
-  TOUCHSEC_NORTHEAST  = 0x2,
-  TOUCHSEC_SOUTHWEST  = 0x4,
-  TOUCHSEC_SOUTHEAST  = 0x8,
-  TOUCHSEC_SPECIAL_NW = 0x10,
-  TOUCHSEC_SPECIAL_NE = 0x20,
-  TOUCHSEC_SPECIAL_SW = 0x40,
-  TOUCHSEC_SPECIAL_SE = 0x80,
-} TouchScreenSection;
-
-typedef enum {
-  LEFTX,
-  LEFTY,
-  RIGHTX,
-  RIGHTY,
-  LEFT_TRIGGER,
-  RIGHT_TRIGGER
-} PadSection;
-
-#define INPUT_TYPE_MASK         0xfff00000
-#define INPUT_VALUE_MASK        0x000fffff
-
-#define INPUT_TYPE_KEYBOARD     0x00000000
-#define INPUT_TYPE_SPECIAL      0x00100000
-#define INPUT_TYPE_MOUSE        0x00200000
-#define INPUT_TYPE_GAMEPAD      0x00300000
-#define INPUT_TYPE_ANALOG       0x00400000
-#define INPUT_TYPE_TOUCHSCREEN  0x00500000
-#define INPUT_TYPE_DEF_NAME     0xf0000000
-
-enum {
-  INPUT_SPECIAL_KEY_PAUSE
-};
+#include "pipeline.h"
 
 bool vitainput_init();
 void vitainput_config(CONFIGURATION config);
 
 void vitainput_start(void);
 void vitainput_stop(void);
+
+bool vitainput_replay(const char *path);
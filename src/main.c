@@ -40,6 +40,7 @@
 #include <openssl/rand.h>
 #include <openssl/evp.h>
 #include <ctype.h>
+#include <curl/curl.h>
 
 #include <psp2/kernel/rng.h>
 #include <psp2/kernel/threadmgr.h>
@@ -82,6 +83,8 @@ static void vita_init() {
   ret = sceNetInit(&net_param);
 
   ret = sceNetCtlInit();
+  // once before any thread creates a GameStream context
+  curl_global_init(CURL_GLOBAL_ALL);
   // TODO(xyz): cURL breaks when socket FD is too big, very hacky workaround below!
   int s = sceNetSocket("", SCE_NET_AF_INET, SCE_NET_SOCK_STREAM, 0);
   sceNetSocketClose(s);
@@ -125,6 +128,10 @@ int main(int argc, char* argv[]) {
 
   config.log_file = fopen("ux0:data/moonlight/moonlight.log", "w");
 
+  if (config.input_replay) {
+    vitainput_replay(config.input_replay);
+  }
+
   load_all_known_devices();
 
   gui_loop();
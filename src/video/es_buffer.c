@@ -0,0 +1,107 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "es_buffer.h"
+#include "../debug.h"
+#include "sps.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// gs_sps_fix may write up to a start code and 128 bytes of SPS
+#define SPS_REWRITE_SLACK (4 + 128)
+
+bool es_buffer_init(es_buffer *buffer) {
+  memset(buffer, 0, sizeof(es_buffer));
+  buffer->data = malloc(ES_BUFFER_MIN_SIZE);
+  if (buffer->data == NULL) {
+    return false;
+  }
+  buffer->size = ES_BUFFER_MIN_SIZE;
+  return true;
+}
+
+void es_buffer_free(es_buffer *buffer) {
+  free(buffer->data);
+  buffer->data = NULL;
+  buffer->size = 0;
+}
+
+// Make sure the buffer can hold length bytes, moving up to the next size
+// class when needed. The old content is not preserved.
+bool es_buffer_reserve(es_buffer *buffer, uint32_t length) {
+  if (length <= buffer->size) {
+    return true;
+  }
+
+  uint32_t size = buffer->size ? buffer->size : ES_BUFFER_MIN_SIZE;
+  while (size < length && size < ES_BUFFER_MAX_SIZE) {
+    size <<= 1;
+  }
+  if (size < length) {
+    return false;
+  }
+
+  char *data = malloc(size);
+  if (data == NULL) {
+    return false;
+  }
+
+  free(buffer->data);
+  buffer->data = data;
+  buffer->size = size;
+  buffer->reallocations++;
+  vita_debug_log("video es buffer grown to %u bytes\n", size);
+  return true;
+}
+
+// The length of the elementary stream left in es, 0 if it doesn't fit
+uint32_t es_buffer_assemble(es_buffer *buffer, PDECODE_UNIT decodeUnit, char **es) {
+  PLENTRY entry = decodeUnit->bufferList;
+  uint32_t length = 0;
+
+  buffer->units++;
+  if (decodeUnit->fullLength > buffer->high_water_mark) {
+    buffer->high_water_mark = decodeUnit->fullLength;
+  }
+
+  if (entry != NULL && entry->next == NULL && entry->bufferType != BUFFER_TYPE_SPS) {
+    buffer->units_passthrough++;
+    *es = entry->data;
+    return entry->length;
+  }
+
+  if (!es_buffer_reserve(buffer, decodeUnit->fullLength + SPS_REWRITE_SLACK)) {
+    return 0;
+  }
+
+  while (entry != NULL) {
+    if (entry->bufferType == BUFFER_TYPE_SPS) {
+      uint32_t start = length;
+      gs_sps_fix(entry, GS_SPS_BITSTREAM_FIXUP, (uint8_t*) buffer->data, &length);
+      buffer->bytes_copied += length - start;
+    } else {
+      memcpy(buffer->data+length, entry->data, entry->length);
+      length += entry->length;
+      buffer->bytes_copied += entry->length;
+    }
+    entry = entry->next;
+  }
+
+  *es = buffer->data;
+  return length;
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Limelight.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The elementary stream handed to the decoder. A decode unit that arrives
+// as one buffer is passed on as is, otherwise every entry is copied once
+// and the SPS is rewritten straight into its final position.
+//
+// The buffer grows in power of two size classes up to the largest unit
+// seen so far. Units that don't fit even the largest class are refused,
+// the caller asks for an IDR frame instead.
+#define ES_BUFFER_MIN_SIZE (128 * 1024)
+#define ES_BUFFER_MAX_SIZE (4 * 1024 * 1024)
+
+typedef struct {
+  char *data;
+  uint32_t size;
+  uint32_t high_water_mark;
+  uint32_t reallocations;
+  // statistics for the debug log
+  uint32_t units;
+  uint32_t units_passthrough;
+  uint64_t bytes_copied;
+} es_buffer;
+
+bool es_buffer_init(es_buffer *buffer);
+void es_buffer_free(es_buffer *buffer);
+bool es_buffer_reserve(es_buffer *buffer, uint32_t length);
+uint32_t es_buffer_assemble(es_buffer *buffer, PDECODE_UNIT decodeUnit, char **es);
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_drop.h"
+
+#include "bs.h"
+
+#include <string.h>
+
+#define NAL_UNIT_TYPE_SLICE 1
+#define NAL_UNIT_TYPE_SLICE_IDR 5
+
+// first_mb_in_slice and slice_type fit in a few bytes
+#define SLICE_HEADER_PEEK 8
+
+static bool parse_slice(uint8_t *nal, int length, frame_slice_info *info) {
+  int type = nal[0] & 0x1f;
+  if (type != NAL_UNIT_TYPE_SLICE && type != NAL_UNIT_TYPE_SLICE_IDR) {
+    return false;
+  }
+
+  bs_t b;
+  bs_init(&b, nal + 1, length - 1 < SLICE_HEADER_PEEK ? length - 1 : SLICE_HEADER_PEEK);
+  /* first_mb_in_slice */ bs_read_ue(&b);
+
+  info->parsed = true;
+  info->idr = type == NAL_UNIT_TYPE_SLICE_IDR;
+  info->reference = (nal[0] >> 5) & 0x3;
+  info->slice_type = bs_read_ue(&b) % 5;
+  return true;
+}
+
+void frame_drop_parse(PDECODE_UNIT decodeUnit, frame_slice_info *info) {
+  memset(info, 0, sizeof(*info));
+  info->slice_type = -1;
+
+  for (PLENTRY entry = decodeUnit->bufferList; entry != NULL; entry = entry->next) {
+    if (entry->bufferType != BUFFER_TYPE_PICDATA) {
+      continue;
+    }
+
+    // skip access unit delimiters and SEI up to the first slice
+    uint8_t *data = (uint8_t*) entry->data;
+    for (int i = 0; i + 3 < entry->length; i++) {
+      if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1 &&
+          parse_slice(data + i + 3, entry->length - i - 3, info)) {
+        return;
+      }
+    }
+  }
+}
+
+bool frame_drop_skip_decode(const frame_slice_info *info, uint32_t lag_us, uint32_t interval_us) {
+  if (!info->parsed || info->idr || info->reference || interval_us == 0) {
+    return false;
+  }
+  return lag_us > interval_us;
+}
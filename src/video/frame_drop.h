@@ -0,0 +1,43 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Limelight.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// What the first slice header of a decode unit says about the picture.
+// Read straight from the Annex B data without unescaping, the fields used
+// here sit right behind the NAL header where no escape can occur yet.
+typedef struct {
+  // a slice was found, otherwise the unit is always decoded
+  bool parsed;
+  bool idr;
+  // nal_ref_idc != 0, later pictures may predict from this one
+  bool reference;
+  int slice_type;
+} frame_slice_info;
+
+void frame_drop_parse(PDECODE_UNIT decodeUnit, frame_slice_info *info);
+
+// When the decoder has fallen more than a frame interval behind, pictures
+// that nothing else predicts from are not decoded at all. They would most
+// likely be superseded before the next vblank anyway, and skipping them is
+// the only drop that doesn't corrupt the following pictures.
+bool frame_drop_skip_decode(const frame_slice_info *info, uint32_t lag_us, uint32_t interval_us);
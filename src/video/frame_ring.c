@@ -0,0 +1,55 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_ring.h"
+
+void frame_ring_init(frame_ring *ring) {
+  ring->ready = -1;
+  ring->presented = -1;
+  ring->superseded = 0;
+}
+
+// Pick a texture that is neither on screen nor waiting to be shown
+int frame_ring_acquire(const frame_ring *ring) {
+  int frame = 0;
+  while (frame == ring->ready || frame == ring->presented) {
+    frame++;
+  }
+  return frame;
+}
+
+// Hand a decoded texture to the presenter. An older frame that has not been
+// shown yet is replaced, the presenter always gets the newest one.
+void frame_ring_publish(frame_ring *ring, int frame) {
+  if (ring->ready >= 0) {
+    ring->superseded++;
+  }
+  ring->ready = frame;
+}
+
+// The newest frame for the presenter, -1 if nothing new was published.
+// The frames replaced since the last call are added to superseded.
+int frame_ring_take(frame_ring *ring, uint32_t *superseded) {
+  int frame = ring->ready;
+  if (frame >= 0) {
+    ring->presented = frame;
+    ring->ready = -1;
+  }
+  *superseded += ring->superseded;
+  ring->superseded = 0;
+  return frame;
+}
@@ -0,0 +1,41 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Decode targets shared by the decoder and the presenter. The decoder
+// writes into one texture while the presenter shows another and a third
+// one waits for the next refresh, so three are always enough.
+//
+// The ring only tracks indices and does no locking, the owner serializes
+// the calls.
+#define FRAME_RING_SIZE 3
+
+typedef struct {
+  // -1 means no texture
+  int ready;
+  int presented;
+  // frames replaced before the presenter took them
+  uint32_t superseded;
+} frame_ring;
+
+void frame_ring_init(frame_ring *ring);
+int frame_ring_acquire(const frame_ring *ring);
+void frame_ring_publish(frame_ring *ring, int frame);
+int frame_ring_take(frame_ring *ring, uint32_t *superseded);
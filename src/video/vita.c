@@ -21,12 +21,17 @@
 #include "../config.h"
 #include "../debug.h"
 #include "../gui/guilib.h"
+#include "../histogram.h"
 #include "vita.h"
+#include "es_buffer.h"
+#include "frame_drop.h"
+#include "frame_ring.h"
 #include "sps.h"
 
 #include <Limelight.h>
 
 #include <stdbool.h>
+#include <psp2/kernel/processmgr.h>
 #include <psp2/kernel/sysmem.h>
 #include <psp2/kernel/threadmgr.h>
 #include <psp2/display.h>
@@ -55,11 +60,10 @@ enum {
   VITA_VIDEO_ERROR_GET_MEMBASE          = 0x80010005,
   VITA_VIDEO_ERROR_CREATE_DEC           = 0x80010006,
   VITA_VIDEO_ERROR_CREATE_PACER_THREAD  = 0x80010007,
+  VITA_VIDEO_ERROR_CREATE_PRESENTER     = 0x80010008,
 };
 
-#define DECODER_BUFFER_SIZE (92 * 1024)
-
-static char* decoder_buffer = NULL;
+static es_buffer decoder_es;
 
 enum {
   SCREEN_WIDTH = 960,
@@ -77,15 +81,98 @@ enum VideoStatus {
   INIT_DECODER_MEMBLOCK,
   INIT_AVC_DEC,
   INIT_FRAME_PACER_THREAD,
+  INIT_PRESENTER_THREAD,
 };
 
-vita2d_texture *frame_texture = NULL;
+// The decoder writes into one texture of the ring while the presenter draws
+// another one, so a slow present never blocks the next decode.
+vita2d_texture *frame_textures[FRAME_RING_SIZE] = {0};
 enum VideoStatus video_status = NOT_INIT;
 
+// protected by frame_ring_mutex
+static SceKernelLwMutexWork frame_ring_mutex;
+static frame_ring ring;
+
+// protected by frame_ring_mutex while the presenter runs, the vblank wait
+// the presenter goes back to after a late frame
+static bool vblank_wait = true;
+
+// When a frame arrived and went through the decoder, filled in by the
+// decoder before the texture is published and read by the presenter to
+// decide when the frame gets a refresh.
+typedef struct {
+  int frame_number;
+  uint64_t receive_ms;
+  // receive_ms carried over to the process clock, see vita_receive_time_us
+  uint64_t receive_us;
+  uint64_t submit_us;
+  uint64_t decoded_us;
+} frame_info;
+
+static frame_info frame_infos[FRAME_RING_SIZE];
+
+// pictures the decoder skipped to catch up, see frame_drop_skip_decode
+static uint32_t frames_skipped;
+
+enum PacingDecision {
+  PACING_PRESENT,
+  PACING_HELD,
+  PACING_SUPERSEDED,
+  PACING_LATE,
+};
+
+static const char *pacing_decision_names[] = { "present", "held", "superseded", "late" };
+
+// The last pacing decisions, dumped to the debug log on cleanup so a
+// session can be replayed offline. Only the presenter writes to it.
+#define PACING_LOG_SIZE 256
+
+typedef struct {
+  int frame_number;
+  uint32_t receive_ms;
+  uint32_t vcount;
+  uint16_t latency_ms;
+  uint8_t superseded;
+  uint8_t decision;
+} pacing_record;
+
+static pacing_record pacing_log[PACING_LOG_SIZE];
+static uint32_t pacing_log_count = 0;
+
+// Per stage frame latency. The first two are written by the decoder, the
+// rest by the presenter, each histogram has a single writer.
+static histogram latency_receive;
+static histogram latency_decode;
+static histogram latency_queue;
+static histogram latency_swap;
+static histogram latency_total;
+
+// Arrival of the latest frame on the process clock and the host's capture
+// interval, read by the input thread to sample right before the host grabs
+// a frame
+static uint64_t frame_clock_us;
+static uint32_t frame_interval_us;
+
+static uint32_t elapsed_us(uint64_t from_us, uint64_t to_us) {
+  return to_us > from_us ? to_us - from_us : 0;
+}
+
+// receiveTimeMs is stamped with moonlight-common-c's millisecond clock,
+// which doesn't have to share an epoch with sceKernelGetProcessTimeWide.
+// Take the age of the unit on that clock and apply it to the process
+// clock, which is the one all pacing and latency timestamps here use.
+static uint64_t vita_receive_time_us(PDECODE_UNIT decodeUnit, uint64_t now_us) {
+  uint64_t now_ms = LiGetMillis();
+  uint64_t age_us = now_ms > decodeUnit->receiveTimeMs ? (now_ms - decodeUnit->receiveTimeMs) * 1000 : 0;
+  return now_us > age_us ? now_us - age_us : 0;
+}
+
 SceAvcdecCtrl *decoder = NULL;
 SceUID displayblock = -1;
 SceUID decoderblock = -1;
 SceUID pacer_thread = -1;
+SceUID presenter_thread = -1;
+SceUID presenter_sema = -1;
 SceVideodecQueryInitInfoHwAvcdec *init = NULL;
 SceAvcdecQueryDecoderInfo *decoder_info = NULL;
 
@@ -98,10 +185,10 @@ typedef struct {
 static unsigned numframes;
 static bool active_video_thread = true;
 static bool active_pacer_thread = false;
+static bool active_presenter_thread = false;
 static indicator_status poor_net_indicator = {0};
 
 uint32_t frame_count = 0;
-uint32_t need_drop = 0;
 uint32_t curr_fps[2] = {0, 0};
 float carry = 0;
 
@@ -182,11 +269,10 @@ static int vita_pacer_thread_main(SceSize args, void *argp) {
   //if (config.stream.fps == 30) {
   //  max_fps /= 2;
   //}
-  int max_fps = config.stream.fps;
+  // frame drops are decided per vblank by the presenter, this thread only
+  // keeps the fps counters for the overlay
   uint64_t last_vblank_count = sceDisplayGetVcount();
   uint64_t last_check_time = sceKernelGetSystemTimeWide();
-  //float carry = 0;
-  need_drop = 0;
   frame_count = 0;
   while (active_pacer_thread) {
     uint64_t curr_vblank_count = sceDisplayGetVcount();
@@ -194,21 +280,6 @@ static int vita_pacer_thread_main(SceSize args, void *argp) {
     uint32_t curr_frame_count = frame_count;
     frame_count = 0;
 
-    if (!active_video_thread) {
-    //  carry = 0;
-    } else {
-      if (config.enable_frame_pacer && curr_frame_count > max_fps) {
-        //carry += curr_frame_count - max_fps;
-        //if (carry > 1) {
-        //  need_drop += (int)carry;
-        //  carry -= (int)carry;
-        //}
-        need_drop += curr_frame_count - max_fps;
-      }
-      //vita_debug_log("fps0/fps1/carry/need_drop: %u/%u/%f/%u\n",
-      //               curr_frame_count, vblank_fps, carry, need_drop);
-    }
-
     curr_fps[0] = curr_frame_count;
     curr_fps[1] = vblank_fps;
 
@@ -226,7 +297,195 @@ static int vita_pacer_thread_main(SceSize args, void *argp) {
   return 0;
 }
 
+static int vita_frame_ring_acquire() {
+  sceKernelLockLwMutex(&frame_ring_mutex, 1, NULL);
+  int frame = frame_ring_acquire(&ring);
+  sceKernelUnlockLwMutex(&frame_ring_mutex, 1);
+  return frame;
+}
+
+static void vita_frame_ring_publish(int frame) {
+  sceKernelLockLwMutex(&frame_ring_mutex, 1, NULL);
+  frame_ring_publish(&ring, frame);
+  sceKernelUnlockLwMutex(&frame_ring_mutex, 1);
+  sceKernelSignalSema(presenter_sema, 1);
+}
+
+static int vita_frame_ring_take(uint32_t *superseded) {
+  sceKernelLockLwMutex(&frame_ring_mutex, 1, NULL);
+  int frame = frame_ring_take(&ring, superseded);
+  sceKernelUnlockLwMutex(&frame_ring_mutex, 1);
+  return frame;
+}
+
+static bool vita_frame_ring_has_ready() {
+  sceKernelLockLwMutex(&frame_ring_mutex, 1, NULL);
+  bool ready = ring.ready >= 0;
+  sceKernelUnlockLwMutex(&frame_ring_mutex, 1);
+  return ready;
+}
+
+static void vita_pacing_log(int frame, uint32_t vcount, uint32_t superseded, int decision) {
+  pacing_record *record = &pacing_log[pacing_log_count % PACING_LOG_SIZE];
+  uint64_t now_ms = sceKernelGetProcessTimeWide() / 1000;
+
+  record->frame_number = frame_infos[frame].frame_number;
+  record->receive_ms = (uint32_t) frame_infos[frame].receive_ms;
+  record->vcount = vcount;
+  record->latency_ms = now_ms - frame_infos[frame].receive_us / 1000;
+  record->superseded = superseded > 0xff ? 0xff : superseded;
+  record->decision = decision;
+  pacing_log_count++;
+}
+
+static void vita_pacing_log_dump() {
+  uint32_t count = pacing_log_count < PACING_LOG_SIZE ? pacing_log_count : PACING_LOG_SIZE;
+  uint32_t first = pacing_log_count - count;
+
+  vita_debug_log("video pacing: last %u of %u decisions (frame receive_ms vcount latency_ms superseded decision)\n",
+                 count, pacing_log_count);
+  for (uint32_t i = first; i < pacing_log_count; i++) {
+    pacing_record *record = &pacing_log[i % PACING_LOG_SIZE];
+    vita_debug_log("pacing: %d %u %u %u %u %s\n", record->frame_number, record->receive_ms,
+                   record->vcount, record->latency_ms, record->superseded,
+                   pacing_decision_names[record->decision]);
+  }
+  pacing_log_count = 0;
+}
+
+// vita2d_set_vblank_wait() is called by the presenter and by
+// start/stop_output, the mutex keeps the two from undoing each other.
+static void vita_set_vblank_wait(bool enable) {
+  bool locked = video_status == INIT_PRESENTER_THREAD;
+  if (locked) {
+    sceKernelLockLwMutex(&frame_ring_mutex, 1, NULL);
+  }
+  vblank_wait = enable;
+  vita2d_set_vblank_wait(enable);
+  if (locked) {
+    sceKernelUnlockLwMutex(&frame_ring_mutex, 1);
+  }
+}
+
+static void vita_skip_vblank_wait(bool skip) {
+  sceKernelLockLwMutex(&frame_ring_mutex, 1, NULL);
+  vita2d_set_vblank_wait(skip ? false : vblank_wait);
+  sceKernelUnlockLwMutex(&frame_ring_mutex, 1);
+}
+
+// Present at most one frame per refresh, the newest one that is ready at
+// the vblank. A frame that arrives when the current refresh already has one
+// waits for the next vblank and may be superseded by a newer frame. A frame
+// is late once a full frame interval has passed since it was received, in
+// low latency mode it is queued without waiting for the vblank.
+static int vita_presenter_thread_main(SceSize args, void *argp) {
+  uint32_t last_vcount = sceDisplayGetVcount() - 2;
+
+  while (active_presenter_thread) {
+    // wake up now and then to notice cleanup even without frames
+    SceUInt timeout = 100000;
+    if (sceKernelWaitSema(presenter_sema, 1, &timeout) < 0) {
+      continue;
+    }
+
+    uint32_t superseded = 0;
+    int frame = vita_frame_ring_take(&superseded);
+    if (frame < 0 || !active_video_thread) {
+      continue;
+    }
+
+    uint32_t vcount = sceDisplayGetVcount();
+    uint64_t deadline_us = frame_infos[frame].receive_us + frame_interval_us;
+    int decision = PACING_PRESENT;
+
+    if (frame_interval_us > 0 && sceKernelGetProcessTimeWide() > deadline_us) {
+      decision = PACING_LATE;
+    } else if (config.enable_frame_pacer && vcount == last_vcount) {
+      sceDisplayWaitVblankStart();
+      vcount = sceDisplayGetVcount();
+      decision = PACING_HELD;
+
+      // a frame decoded during the wait is newer, show that one instead
+      if (vita_frame_ring_has_ready()) {
+        vita_pacing_log(frame, vcount, superseded, PACING_SUPERSEDED);
+        superseded = 0;
+        frame = vita_frame_ring_take(&superseded);
+      }
+    }
+
+    bool skip_vblank_wait = decision == PACING_LATE && config.low_latency_pacing;
+    if (skip_vblank_wait) {
+      vita_skip_vblank_wait(true);
+    }
+
+    vita2d_start_drawing();
+
+    draw_streaming(frame_textures[frame]);
+    draw_fps();
+    draw_indicators();
+
+    vita2d_end_drawing();
+
+    vita2d_wait_rendering_done();
+    uint64_t drawn_us = sceKernelGetProcessTimeWide();
+    vita2d_swap_buffers();
+    uint64_t swapped_us = sceKernelGetProcessTimeWide();
+
+    histogram_add(&latency_queue, elapsed_us(frame_infos[frame].decoded_us, drawn_us));
+    histogram_add(&latency_swap, elapsed_us(drawn_us, swapped_us));
+    histogram_add(&latency_total, elapsed_us(frame_infos[frame].receive_us, swapped_us));
+
+    if (skip_vblank_wait) {
+      vita_skip_vblank_wait(false);
+    }
+
+    vita_pacing_log(frame, vcount, superseded, decision);
+    last_vcount = vcount;
+    frame_count++;
+  }
+  return 0;
+}
+
 static void vita_cleanup() {
+  if (decoder_es.units > 0) {
+    vita_debug_log("video es: %u units, %u passed through, %llu bytes copied\n",
+                   decoder_es.units, decoder_es.units_passthrough, decoder_es.bytes_copied);
+    vita_debug_log("video es buffer: %u bytes, high water mark %u, %u reallocations\n",
+                   decoder_es.size, decoder_es.high_water_mark, decoder_es.reallocations);
+    decoder_es.units = 0;
+    decoder_es.units_passthrough = 0;
+    decoder_es.bytes_copied = 0;
+  }
+
+  if (pacing_log_count > 0) {
+    vita_pacing_log_dump();
+  }
+
+  if (frames_skipped > 0) {
+    vita_debug_log("video: skipped decoding %u non-reference frames\n", frames_skipped);
+    frames_skipped = 0;
+  }
+
+  histogram_log(&latency_receive);
+  histogram_log(&latency_decode);
+  histogram_log(&latency_queue);
+  histogram_log(&latency_swap);
+  histogram_log(&latency_total);
+
+  if (video_status == INIT_PRESENTER_THREAD) {
+    active_presenter_thread = false;
+    sceKernelSignalSema(presenter_sema, 1);
+    // wait 10sec
+    SceUInt timeout = 10000000;
+    int ret;
+    sceKernelWaitThreadEnd(presenter_thread, &ret, &timeout);
+    sceKernelDeleteThread(presenter_thread);
+    sceKernelDeleteSema(presenter_sema);
+    sceKernelDeleteLwMutex(&frame_ring_mutex);
+    presenter_sema = -1;
+    video_status--;
+  }
+
   if (video_status == INIT_FRAME_PACER_THREAD) {
     active_pacer_thread = false;
     // wait 10sec
@@ -269,15 +528,14 @@ static void vita_cleanup() {
   }
 
   if (video_status == INIT_FRAMEBUFFER) {
-    if (frame_texture != NULL) {
-      vita2d_free_texture(frame_texture);
-      frame_texture = NULL;
+    for (int i = 0; i < FRAME_RING_SIZE; i++) {
+      if (frame_textures[i] != NULL) {
+        vita2d_free_texture(frame_textures[i]);
+        frame_textures[i] = NULL;
+      }
     }
 
-    if (decoder_buffer != NULL) {
-      free(decoder_buffer);
-      decoder_buffer = NULL;
-    }
+    es_buffer_free(&decoder_es);
     video_status--;
   }
 
@@ -301,19 +559,30 @@ static int vita_setup(int videoFormat, int width, int height, int redrawRate, vo
     // INIT_FRAMEBUFFER
     update_scaling_settings(width, height);
 
-    decoder_buffer = malloc(DECODER_BUFFER_SIZE);
-    if (decoder_buffer == NULL) {
+    if (!es_buffer_init(&decoder_es)) {
       printf("not enough memory\n");
       ret = VITA_VIDEO_ERROR_NO_MEM;
       goto cleanup;
     }
 
-    frame_texture = vita2d_create_empty_texture_format(image_scaling.texture_width, image_scaling.texture_height, SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR);
-    if (frame_texture == NULL) {
-      printf("not enough memory\n");
-      ret = VITA_VIDEO_ERROR_NO_MEM;
-      goto cleanup;
+    for (int i = 0; i < FRAME_RING_SIZE; i++) {
+      frame_textures[i] = vita2d_create_empty_texture_format(image_scaling.texture_width, image_scaling.texture_height, SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR);
+      if (frame_textures[i] == NULL) {
+        printf("not enough memory\n");
+        ret = VITA_VIDEO_ERROR_NO_MEM;
+        goto cleanup;
+      }
     }
+    frame_ring_init(&ring);
+
+    histogram_init(&latency_receive, "video receive->submit", 500);
+    histogram_init(&latency_decode, "video submit->decoded", 250);
+    histogram_init(&latency_queue, "video decoded->drawn", 500);
+    histogram_init(&latency_swap, "video drawn->swapped", 250);
+    histogram_init(&latency_total, "video receive->swapped", 1000);
+
+    __atomic_store_n(&frame_clock_us, 0, __ATOMIC_RELAXED);
+    frame_interval_us = redrawRate > 0 ? 1000000 / redrawRate : 0;
 
     video_status++;
   }
@@ -420,6 +689,38 @@ static int vita_setup(int videoFormat, int width, int height, int redrawRate, vo
     video_status++;
   }
 
+  if (video_status == INIT_FRAME_PACER_THREAD) {
+    // INIT_PRESENTER_THREAD
+    ret = sceKernelCreateLwMutex(&frame_ring_mutex, "frame_ring", 0, 0, NULL);
+    if (ret < 0) {
+      printf("sceKernelCreateLwMutex 0x%x\n", ret);
+      ret = VITA_VIDEO_ERROR_CREATE_PRESENTER;
+      goto cleanup;
+    }
+
+    presenter_sema = sceKernelCreateSema("frame_ready", 0, 0, 1, NULL);
+    if (presenter_sema < 0) {
+      printf("sceKernelCreateSema 0x%x\n", presenter_sema);
+      sceKernelDeleteLwMutex(&frame_ring_mutex);
+      ret = VITA_VIDEO_ERROR_CREATE_PRESENTER;
+      goto cleanup;
+    }
+
+    ret = sceKernelCreateThread("frame_presenter", vita_presenter_thread_main, 0, 0x10000, 0, 0, NULL);
+    if (ret < 0) {
+      printf("sceKernelCreateThread 0x%x\n", ret);
+      sceKernelDeleteSema(presenter_sema);
+      sceKernelDeleteLwMutex(&frame_ring_mutex);
+      presenter_sema = -1;
+      ret = VITA_VIDEO_ERROR_CREATE_PRESENTER;
+      goto cleanup;
+    }
+    presenter_thread = ret;
+    active_presenter_thread = true;
+    sceKernelStartThread(presenter_thread, 0, NULL);
+    video_status++;
+  }
+
   return VITA_VIDEO_INIT_OK;
 
 cleanup:
@@ -428,6 +729,8 @@ cleanup:
 }
 
 static int vita_submit_decode_unit(PDECODE_UNIT decodeUnit) {
+  uint64_t submit_us = sceKernelGetProcessTimeWide();
+  uint64_t receive_us = vita_receive_time_us(decodeUnit, submit_us);
   SceAvcdecAu au = {0};
   SceAvcdecArrayPicture array_picture = {0};
   struct SceAvcdecPicture picture = {0};
@@ -437,32 +740,36 @@ static int vita_submit_decode_unit(PDECODE_UNIT decodeUnit) {
 
   //frame->time = decodeUnit->receiveTimeMs;
 
+  if (config.enable_frame_pacer) {
+    frame_slice_info slice_info;
+    frame_drop_parse(decodeUnit, &slice_info);
+    if (frame_drop_skip_decode(&slice_info, elapsed_us(receive_us, submit_us), frame_interval_us)) {
+      frames_skipped++;
+      return DR_OK;
+    }
+  }
+
   picture.size = sizeof(picture);
   picture.frame.pixelType = 0;
   picture.frame.framePitch = image_scaling.texture_width;
   picture.frame.frameWidth = image_scaling.texture_width;
   picture.frame.frameHeight = image_scaling.texture_height;
-  picture.frame.pPicture[0] = vita2d_texture_get_datap(frame_texture);
-
-  if (decodeUnit->fullLength >= DECODER_BUFFER_SIZE) {
-    printf("Video decode buffer too small\n");
-    exit(1);
-  }
-
-  PLENTRY entry = decodeUnit->bufferList;
-  uint32_t length = 0;
-  while (entry != NULL) {
-    if (entry->bufferType == BUFFER_TYPE_SPS) {
-      gs_sps_fix(entry, GS_SPS_BITSTREAM_FIXUP, decoder_buffer, &length);
-    } else {
-      memcpy(decoder_buffer+length, entry->data, entry->length);
-      length += entry->length;
-    }
-    entry = entry->next;
+  int frame = vita_frame_ring_acquire();
+  picture.frame.pPicture[0] = vita2d_texture_get_datap(frame_textures[frame]);
+  frame_infos[frame].frame_number = decodeUnit->frameNumber;
+  frame_infos[frame].receive_ms = decodeUnit->receiveTimeMs;
+  frame_infos[frame].receive_us = receive_us;
+  frame_infos[frame].submit_us = submit_us;
+  __atomic_store_n(&frame_clock_us, receive_us, __ATOMIC_RELAXED);
+
+  // the rewritten SPS can differ in size, use the assembled length
+  char *es = NULL;
+  au.es.size = es_buffer_assemble(&decoder_es, decodeUnit, &es);
+  au.es.pBuf = es;
+  if (au.es.size == 0) {
+    vita_debug_log("Video decode buffer too small for 0x%x bytes\n", decodeUnit->fullLength);
+    return DR_NEED_IDR;
   }
-
-  au.es.pBuf = decoder_buffer;
-  au.es.size = decodeUnit->fullLength;
   au.dts.lower = 0xFFFFFFFF;
   au.dts.upper = 0xFFFFFFFF;
   au.pts.lower = 0xFFFFFFFF;
@@ -475,30 +782,17 @@ static int vita_submit_decode_unit(PDECODE_UNIT decodeUnit) {
     return DR_NEED_IDR;
   }
 
+  frame_infos[frame].decoded_us = sceKernelGetProcessTimeWide();
+  histogram_add(&latency_receive, elapsed_us(receive_us, submit_us));
+  histogram_add(&latency_decode, elapsed_us(submit_us, frame_infos[frame].decoded_us));
+
   if (array_picture.numOfOutput != 1) {
     //printf("numOfOutput %d\n", array_picture.numOfOutput);
     return DR_OK;
   }
 
   if (active_video_thread) {
-    if (need_drop > 0) {
-      vita_debug_log("remain frameskip: %d\n", need_drop);
-      // skip
-      need_drop--;
-    } else {
-      vita2d_start_drawing();
-
-      draw_streaming(frame_texture);
-      draw_fps();
-      draw_indicators();
-
-      vita2d_end_drawing();
-
-      vita2d_wait_rendering_done();
-      vita2d_swap_buffers();
-
-      frame_count++;
-    }
+    vita_frame_ring_publish(frame);
   }
 
   // if (numframes++ % 6 == 0)
@@ -519,10 +813,25 @@ void draw_streaming(vita2d_texture *frame_texture) {
                            image_scaling.region_y2);
 }
 
+static void draw_latency(int y, const histogram *h) {
+  vita2d_font_draw_textf(font, 40, y, RGBA8(0xFF, 0xFF, 0xFF, 0xFF), 16, "%s: %.1f / %.1f / %.1f ms",
+                         h->name, histogram_percentile(h, 50) / 1000.0f,
+                         histogram_percentile(h, 95) / 1000.0f, histogram_percentile(h, 99) / 1000.0f);
+}
+
 void draw_fps() {
   if (config.show_fps) {
     vita2d_font_draw_textf(font, 40, 20, RGBA8(0xFF, 0xFF, 0xFF, 0xFF), 16, "fps: %u / %u", curr_fps[0], curr_fps[1]);
   }
+
+  if (config.show_latency) {
+    vita2d_font_draw_text(font, 40, 44, RGBA8(0xFF, 0xFF, 0xFF, 0xFF), 16, "latency p50 / p95 / p99");
+    draw_latency(64, &latency_receive);
+    draw_latency(84, &latency_decode);
+    draw_latency(104, &latency_queue);
+    draw_latency(124, &latency_swap);
+    draw_latency(144, &latency_total);
+  }
 }
 
 void draw_indicators() {
@@ -538,11 +847,11 @@ void draw_indicators() {
 
 void vitavideo_start() {
   active_video_thread = true;
-  vita2d_set_vblank_wait(config.enable_vita_vblank_wait);
+  vita_set_vblank_wait(config.enable_vita_vblank_wait);
 }
 
 void vitavideo_stop() {
-  vita2d_set_vblank_wait(true);
+  vita_set_vblank_wait(true);
   active_video_thread = false;
 }
 
@@ -559,6 +868,17 @@ int vitavideo_initialized() {
   return video_status != NOT_INIT;
 }
 
+void vitavideo_get_buffer_stats(uint32_t *size, uint32_t *high_water_mark, uint32_t *reallocations) {
+  *size = decoder_es.size;
+  *high_water_mark = decoder_es.high_water_mark;
+  *reallocations = decoder_es.reallocations;
+}
+
+void vitavideo_get_frame_clock(uint64_t *last_us, uint32_t *interval_us) {
+  *last_us = __atomic_load_n(&frame_clock_us, __ATOMIC_RELAXED);
+  *interval_us = frame_interval_us;
+}
+
 DECODER_RENDERER_CALLBACKS decoder_callbacks_vita = {
   .setup = vita_setup,
   .cleanup = vita_cleanup,
@@ -17,6 +17,7 @@
  * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
  */
 #include <math.h>
+#include <stdint.h>
 
 // Vita's sceVideodecInitLibrary only accept resolution that is multiple of 16 on either dimension,
 // and the smallest resolution is 64
@@ -31,3 +32,5 @@ void vitavideo_stop();
 void vitavideo_show_poor_net_indicator();
 void vitavideo_hide_poor_net_indicator();
 int vitavideo_initialized();
+void vitavideo_get_buffer_stats(uint32_t *size, uint32_t *high_water_mark, uint32_t *reallocations);
+void vitavideo_get_frame_clock(uint64_t *last_us, uint32_t *interval_us);
@@ -0,0 +1,80 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Times the windowed bitstream reader and writer against the bit at a time
+// version they replaced, on the field mix of an SPS and slice header: short
+// fixed width fields and small Exp-Golomb codes.
+
+#include "host.h"
+#include "bs_ops.h"
+
+#include <string.h>
+
+#define OPS 4096
+#define ROUNDS 500
+
+static uint8_t buf[OPS * 4];
+static bs_op read_ops[OPS];
+static bs_op write_ops[OPS];
+static bs_result results[OPS];
+
+typedef void (*bs_ops_fn)(uint8_t *buf, size_t size, const bs_op *ops, int count, bs_result *results);
+
+static double run(bs_ops_fn fn, const bs_op *ops) {
+  uint64_t start = host_time_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    fn(buf, sizeof(buf), ops, OPS, results);
+  }
+  return (double) (host_time_ns() - start) / ((double) ROUNDS * OPS);
+}
+
+int main(void) {
+  static const int widths[] = { 1, 1, 2, 4, 5, 8, 16 };
+  uint32_t seed = 1;
+
+  for (int i = 0; i < OPS; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t r = seed >> 8;
+    int n = widths[r % 7];
+    uint32_t v = (r >> 4) & ((1u << n) - 1);
+    uint32_t ue = (r >> 4) % 40;
+    switch (r % 4) {
+    case 0:
+    case 1:
+      read_ops[i] = (bs_op) { BS_OP_READ_U, n, 0 };
+      write_ops[i] = (bs_op) { BS_OP_WRITE_U, n, v };
+      break;
+    case 2:
+      read_ops[i] = (bs_op) { BS_OP_READ_UE, 0, 0 };
+      write_ops[i] = (bs_op) { BS_OP_WRITE_UE, 0, ue };
+      break;
+    default:
+      read_ops[i] = (bs_op) { BS_OP_READ_SE, 0, 0 };
+      write_ops[i] = (bs_op) { BS_OP_WRITE_SE, 0, ue - 20 };
+      break;
+    }
+  }
+
+  // read back what the writer produced, so the codes are well formed
+  bs_ops_ref(buf, sizeof(buf), write_ops, OPS, results);
+
+  printf("bs read  bit at a time: %5.2f ns/field, windowed: %5.2f ns/field\n",
+         run(bs_ops_ref, read_ops), run(bs_ops_cur, read_ops));
+  printf("bs write bit at a time: %5.2f ns/field, windowed: %5.2f ns/field\n",
+         run(bs_ops_ref, write_ops), run(bs_ops_cur, write_ops));
+  return 0;
+}
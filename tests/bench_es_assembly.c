@@ -0,0 +1,125 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares building the elementary stream the old way, copying every entry
+// of every decode unit into one fixed buffer, with es_buffer_assemble.
+//
+// The stream is synthetic: an IDR frame of SPS, PPS and picture data every
+// GOP frames and single buffer P frames in between, the way
+// moonlight-common-c hands them over. Frame sizes follow a 10 Mbps 60 fps
+// stream with IDR frames four times the size of P frames.
+
+#include "host.h"
+#include "video/es_buffer.h"
+#include "sps.h"
+
+#include <string.h>
+
+#define FRAMES 6000
+#define GOP 120
+#define P_FRAME_SIZE (10000000 / 8 / 60)
+#define IDR_FRAME_SIZE (P_FRAME_SIZE * 4)
+
+static char sps_nal[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50,
+  0x05, 0xbb, 0x01, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03,
+  0x03, 0xc0, 0xf1, 0x83, 0x19, 0x60,
+};
+static char pps_nal[] = { 0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0 };
+
+static DECODE_UNIT units[FRAMES];
+static LENTRY entries[FRAMES][3];
+static volatile uint32_t sink;
+
+// the submit path before the es_buffer: one copy of everything
+static uint64_t baseline_bytes;
+static char baseline_buffer[IDR_FRAME_SIZE * 2];
+
+static uint32_t baseline_assemble(PDECODE_UNIT decodeUnit) {
+  PLENTRY entry = decodeUnit->bufferList;
+  uint32_t length = 0;
+  while (entry != NULL) {
+    if (entry->bufferType == BUFFER_TYPE_SPS) {
+      uint32_t start = length;
+      gs_sps_fix(entry, GS_SPS_BITSTREAM_FIXUP, (uint8_t*) baseline_buffer, &length);
+      baseline_bytes += length - start;
+    } else {
+      memcpy(baseline_buffer+length, entry->data, entry->length);
+      length += entry->length;
+      baseline_bytes += entry->length;
+    }
+    entry = entry->next;
+  }
+  return length;
+}
+
+static void build_stream(char *payload) {
+  for (int i = 0; i < FRAMES; i++) {
+    DECODE_UNIT *unit = &units[i];
+    LENTRY *e = entries[i];
+    unit->frameNumber = i;
+    if (i % GOP == 0) {
+      e[0] = (LENTRY) { &e[1], sps_nal, sizeof(sps_nal), BUFFER_TYPE_SPS };
+      e[1] = (LENTRY) { &e[2], pps_nal, sizeof(pps_nal), BUFFER_TYPE_PPS };
+      e[2] = (LENTRY) { NULL, payload, IDR_FRAME_SIZE, BUFFER_TYPE_PICDATA };
+      unit->fullLength = sizeof(sps_nal) + sizeof(pps_nal) + IDR_FRAME_SIZE;
+    } else {
+      // vary the size a little so the copies don't all look alike
+      int length = P_FRAME_SIZE / 2 + (i * 7919) % P_FRAME_SIZE;
+      e[0] = (LENTRY) { NULL, payload + (i % 64), length, BUFFER_TYPE_PICDATA };
+      unit->fullLength = length;
+    }
+    unit->bufferList = e;
+  }
+}
+
+int main(void) {
+  char *payload = malloc(IDR_FRAME_SIZE + 64);
+  for (int i = 0; i < IDR_FRAME_SIZE + 64; i++) {
+    payload[i] = (char) (i * 131);
+  }
+  build_stream(payload);
+  gs_sps_init(1280, 720);
+
+  uint64_t start = host_time_ns();
+  for (int i = 0; i < FRAMES; i++) {
+    sink += baseline_assemble(&units[i]);
+  }
+  uint64_t baseline_ns = host_time_ns() - start;
+
+  es_buffer buffer;
+  CHECK(es_buffer_init(&buffer));
+  start = host_time_ns();
+  for (int i = 0; i < FRAMES; i++) {
+    char *es;
+    uint32_t length = es_buffer_assemble(&buffer, &units[i], &es);
+    CHECK(length > 0);
+    sink += length + es[0];
+  }
+  uint64_t assemble_ns = host_time_ns() - start;
+
+  printf("copy every entry: %8.1f ns/frame, %6.1f MB copied\n",
+         (double) baseline_ns / FRAMES, baseline_bytes / 1e6);
+  printf("es_buffer:        %8.1f ns/frame, %6.1f MB copied, %u of %u frames passed through, %u reallocations\n",
+         (double) assemble_ns / FRAMES, buffer.bytes_copied / 1e6,
+         buffer.units_passthrough, buffer.units, buffer.reallocations);
+
+  es_buffer_free(&buffer);
+  gs_sps_stop();
+  free(payload);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Throughput of start code scanning and emulation prevention removal and
+// insertion, current against the byte at a time versions in tests/ref.
+//
+// There are no stream captures in the tree, so the input is a synthetic
+// access unit: entropy coded slice data is close to random, with a zero
+// byte about every 256 and an occasional 00 00 03 escape, split into NAL
+// units by four byte start codes.
+
+#include "host.h"
+#include "h264_stream.h"
+#include "ref/h264_nal_ref.h"
+
+#include <string.h>
+
+#define STREAM_SIZE (1024 * 1024)
+#define ROUNDS 50
+#define NAL_SIZE 16384
+
+static uint8_t stream[STREAM_SIZE + 8];
+static uint8_t out[STREAM_SIZE * 2];
+static volatile int sink;
+
+static void build_stream(void) {
+  uint32_t seed = 88172645;
+  for (int i = 0; i < STREAM_SIZE; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    stream[i] = (uint8_t) seed;
+    // keep escapes valid: no 00 00 0x with x <= 3 except where written below
+    if (i >= 2 && stream[i - 1] == 0 && stream[i - 2] == 0 && stream[i] <= 3) {
+      stream[i] = 0x03;
+      if (i + 1 < STREAM_SIZE) {
+        stream[++i] = 0x80 | (uint8_t) seed;
+      }
+    }
+  }
+  for (int i = 0; i + 4 < STREAM_SIZE; i += NAL_SIZE) {
+    stream[i] = stream[i + 1] = stream[i + 2] = 0;
+    stream[i + 3] = 1;
+    stream[i + 4] = 0x41;
+  }
+  memset(stream + STREAM_SIZE, 0xff, 8);
+}
+
+typedef int (*find_fn)(uint8_t *buf, int size, int *nal_start, int *nal_end);
+typedef int (*nal_to_rbsp_fn)(const uint8_t *nal_buf, int *nal_size, uint8_t *rbsp_buf, int *rbsp_size);
+typedef int (*rbsp_to_nal_fn)(const uint8_t *rbsp_buf, const int *rbsp_size, uint8_t *nal_buf, int *nal_size);
+
+static double mbps(uint64_t ns) {
+  return (double) STREAM_SIZE * ROUNDS / 1e6 / (ns / 1e9);
+}
+
+static double bench_find(find_fn find) {
+  uint64_t start = host_time_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    int offset = 0, nal_start, nal_end, units = 0;
+    while (find(stream + offset, STREAM_SIZE - offset, &nal_start, &nal_end) != 0) {
+      offset += nal_end;
+      units++;
+    }
+    sink += units;
+  }
+  return mbps(host_time_ns() - start);
+}
+
+static double bench_nal_to_rbsp(nal_to_rbsp_fn fn) {
+  uint64_t start = host_time_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < STREAM_SIZE; i += NAL_SIZE) {
+      int nal_size = NAL_SIZE - 4, rbsp_size = NAL_SIZE;
+      sink += fn(stream + i + 4, &nal_size, out, &rbsp_size);
+    }
+  }
+  return mbps(host_time_ns() - start);
+}
+
+static double bench_rbsp_to_nal(rbsp_to_nal_fn fn) {
+  uint64_t start = host_time_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < STREAM_SIZE; i += NAL_SIZE) {
+      int rbsp_size = NAL_SIZE - 4, nal_size = NAL_SIZE * 2;
+      sink += fn(stream + i + 4, &rbsp_size, out, &nal_size);
+    }
+  }
+  return mbps(host_time_ns() - start);
+}
+
+int main(void) {
+  build_stream();
+
+  printf("find_nal_unit: byte at a time %7.1f MB/s, current %7.1f MB/s\n",
+         bench_find(ref_find_nal_unit), bench_find(find_nal_unit));
+  printf("nal_to_rbsp:   byte at a time %7.1f MB/s, current %7.1f MB/s\n",
+         bench_nal_to_rbsp(ref_nal_to_rbsp), bench_nal_to_rbsp(nal_to_rbsp));
+  printf("rbsp_to_nal:   byte at a time %7.1f MB/s, current %7.1f MB/s\n",
+         bench_rbsp_to_nal(ref_rbsp_to_nal), bench_rbsp_to_nal(rbsp_to_nal));
+  return 0;
+}
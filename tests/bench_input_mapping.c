@@ -0,0 +1,141 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Cost of one poll: the per-poll decoding the mapping used to do, in
+// tests/ref, against the compiled tables of the input pipeline, which
+// also run the stick response. The whole pipeline adds the gesture
+// recognizer and the mouse, timed once with fingers only on the back
+// panel and a corner button and once with fingers moving on the front.
+// Pad buttons and axes are random, so branches on them mispredict.
+
+#include "host.h"
+#include "input/pipeline.h"
+#include "ref/input_mapping_ref.h"
+
+#include <string.h>
+
+#define SAMPLES 4096
+#define ROUNDS 200
+
+static input_record_sample samples[SAMPLES];
+
+static void make_samples(bool front_fingers) {
+  uint32_t seed = 3;
+  for (int i = 0; i < SAMPLES; i++) {
+    input_record_sample *s = &samples[i];
+    memset(s, 0, sizeof(input_record_sample));
+    s->time_us = 1000000 + i * 5000;
+    seed = seed * 1103515245 + 12345;
+    s->buttons = (seed >> 8) & 0xffff;
+    s->lx = 128 + (seed >> 4) % 64;
+    s->ly = 128 - (seed >> 10) % 64;
+    s->rx = seed >> 16;
+    s->ry = seed >> 24;
+    s->lt = seed >> 12;
+    s->rt = seed >> 20;
+
+    // two fingers on the back, one on a corner button
+    s->back_count = 2;
+    s->back[0] = (input_record_touch) { 0, 300 + i % 64, 200 };
+    s->back[1] = (input_record_touch) { 1, 1500, 800 + i % 64 };
+    s->front_count = 1;
+    s->front[0] = (input_record_touch) { 2, 20, 20 };
+    if (front_fingers) {
+      s->front_count = 3;
+      s->front[1] = (input_record_touch) { 3, 800 + i % 256, 500 };
+      s->front[2] = (input_record_touch) { 4, 1000 + i % 256, 520 };
+    }
+  }
+}
+
+static void ignore_controller(short buttons, unsigned char lt, unsigned char rt,
+                              short lx, short ly, short rx, short ry) {
+}
+
+static void ignore_mouse_move(short dx, short dy) {
+}
+
+static void ignore_mouse_button(char action, int button) {
+}
+
+static void ignore_keyboard(short key, char action, char modifiers) {
+}
+
+static void ignore_scroll(signed char amount) {
+}
+
+static void ignore_pause(void) {
+}
+
+static const input_sink null_sink = {
+  .controller = ignore_controller,
+  .mouse_move = ignore_mouse_move,
+  .mouse_button = ignore_mouse_button,
+  .keyboard = ignore_keyboard,
+  .scroll = ignore_scroll,
+  .pause = ignore_pause,
+};
+
+static void process(input_pipeline *p, const input_record_sample *sample) {
+  input_pipeline_process(p, sample);
+}
+
+static double bench_ref(void) {
+  ref_input out;
+  uint64_t start = host_time_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < SAMPLES; i++) {
+      ref_input_process(&samples[i], &out);
+    }
+  }
+  return (double) (host_time_ns() - start) / ROUNDS / SAMPLES;
+}
+
+static double bench_pipeline(input_pipeline *p, void (*poll)(input_pipeline *, const input_record_sample *)) {
+  uint64_t start = host_time_ns();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < SAMPLES; i++) {
+      poll(p, &samples[i]);
+    }
+  }
+  return (double) (host_time_ns() - start) / ROUNDS / SAMPLES;
+}
+
+int main(void) {
+  // the default Vita mapping, the back quarters are l2, r2, l3 and r3
+  input_settings settings = {0};
+  input_default_mapping(&settings.map, false);
+  settings.rate = 200;
+  settings.touch = true;
+  settings.special_size = 100;
+  settings.special_nw = INPUT_PAD_START | INPUT_TYPE_GAMEPAD;
+  settings.stick_curve = 100;
+  settings.left_deadzone = 10;
+  settings.right_deadzone = 10;
+
+  static input_pipeline p;
+  input_pipeline_config(&p, &settings, &null_sink);
+  ref_input_config(&settings);
+
+  make_samples(false);
+  printf("mapping, per-poll decoding:       %6.1f ns/poll\n", bench_ref());
+  printf("mapping, compiled tables:         %6.1f ns/poll\n", bench_pipeline(&p, input_pipeline_map));
+  printf("whole pipeline:                   %6.1f ns/poll\n", bench_pipeline(&p, process));
+  make_samples(true);
+  printf("whole pipeline, front fingers:    %6.1f ns/poll\n", bench_pipeline(&p, process));
+  return 0;
+}
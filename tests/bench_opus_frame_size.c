@@ -0,0 +1,88 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Decode CPU time per second of audio for each Opus frame duration the
+// host can send, with the multistream decoder the Vita renderer uses. The
+// input is ten seconds of a synthetic mix of tones and noise, encoded
+// once per duration in the low delay mode GameStream hosts use. Packet
+// rate is reported along with it, as that is what longer frames save.
+
+#include "host.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <opus/opus.h>
+#include <opus/opus_multistream.h>
+
+#define SAMPLE_RATE 48000
+#define SECONDS 10
+#define MAX_FRAME_SIZE 5760
+#define MAX_PACKET_BYTES 1500
+
+static short pcm[2 * SAMPLE_RATE * SECONDS];
+static short decoded[2 * MAX_FRAME_SIZE];
+
+static void bench(int frame_size) {
+  int error;
+  OpusEncoder *encoder = opus_encoder_create(SAMPLE_RATE, 2, OPUS_APPLICATION_RESTRICTED_LOWDELAY, &error);
+  CHECK(error == OPUS_OK);
+  opus_encoder_ctl(encoder, OPUS_SET_BITRATE(96000));
+
+  int packet_count = SAMPLE_RATE * SECONDS / frame_size;
+  unsigned char (*packets)[MAX_PACKET_BYTES] = malloc(packet_count * MAX_PACKET_BYTES);
+  int *lengths = malloc(packet_count * sizeof(int));
+  CHECK(packets != NULL && lengths != NULL);
+  for (int n = 0; n < packet_count; n++) {
+    lengths[n] = opus_encode(encoder, &pcm[2 * n * frame_size], frame_size, packets[n], MAX_PACKET_BYTES);
+    CHECK(lengths[n] > 0);
+  }
+  opus_encoder_destroy(encoder);
+
+  static const unsigned char mapping[] = {0, 1};
+  OpusMSDecoder *decoder = opus_multistream_decoder_create(SAMPLE_RATE, 2, 1, 1, mapping, &error);
+  CHECK(error == OPUS_OK);
+
+  uint64_t start = host_time_ns();
+  for (int n = 0; n < packet_count; n++) {
+    CHECK(opus_multistream_decode(decoder, packets[n], lengths[n], decoded, MAX_FRAME_SIZE, 0) == frame_size);
+  }
+  uint64_t elapsed_ns = host_time_ns() - start;
+  opus_multistream_decoder_destroy(decoder);
+
+  printf("%5.1f ms frames: %4d packets/s, %6.0f us decode time per second of audio\n",
+         frame_size * 1000.0 / SAMPLE_RATE, SAMPLE_RATE / frame_size,
+         elapsed_ns / 1000.0 / SECONDS);
+  free(packets);
+  free(lengths);
+}
+
+int main(void) {
+  uint32_t seed = 1;
+  for (int i = 0; i < SAMPLE_RATE * SECONDS; i++) {
+    seed = seed * 1103515245 + 12345;
+    double t = (double) i / SAMPLE_RATE;
+    double noise = ((int) (seed >> 16 & 0x7fff) - 16384) / 16384.0;
+    pcm[2 * i] = 8000 * sin(2 * M_PI * 220 * t) + 3000 * sin(2 * M_PI * 1760 * t) + 1000 * noise;
+    pcm[2 * i + 1] = 8000 * sin(2 * M_PI * 330 * t) + 3000 * sin(2 * M_PI * 2640 * t) + 1000 * noise;
+  }
+
+  static const int frame_sizes[] = {120, 240, 480, 960, 1920, 2880};
+  for (size_t i = 0; i < sizeof(frame_sizes) / sizeof(*frame_sizes); i++) {
+    bench(frame_sizes[i]);
+  }
+  return 0;
+}
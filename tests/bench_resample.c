@@ -0,0 +1,49 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Throughput of the interpolation, scalar and vectorized, on 256 frame
+// blocks at a 500 ppm step.
+
+#include "host.h"
+#include "audio/resample.h"
+
+#define FRAMES 256
+#define ITERATIONS 200000
+
+static short input[2 * (FRAMES + 16)];
+static short output[2 * FRAMES];
+
+typedef uint64_t (*interpolate_fn)(short *, const short *, uint64_t, uint64_t, uint32_t);
+
+static double run(interpolate_fn interpolate) {
+  uint64_t step = (1LL << 32) + 500 * (1LL << 32) / 1000000;
+  uint64_t pos = 0;
+  uint64_t start = host_time_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    pos = interpolate(output, input, pos, step, FRAMES) & 0xffffffff;
+  }
+  return (double) (host_time_ns() - start) / ITERATIONS / FRAMES;
+}
+
+int main(void) {
+  for (int i = 0; i < 2 * (FRAMES + 16); i++) {
+    input[i] = i * 2654435761u >> 16;
+  }
+  printf("resample scalar:     %6.2f ns/frame\n", run(audio_resample_interpolate_scalar));
+  printf("resample vectorized: %6.2f ns/frame\n", run(audio_resample_interpolate));
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// serverinfo parsed in one streaming pass, fed in TCP sized chunks the way
+// http_request_stream hands it over, against the earlier parse with a
+// pass per field over the whole response (tests/ref). The response is
+// shaped like one from GFE 3 with a list of display modes.
+
+#include "host.h"
+#include "errors.h"
+#include "xml.h"
+#include "ref/serverinfo_ref.h"
+
+#include <string.h>
+
+#define ITERATIONS 20000
+#define CHUNK_SIZE 1448
+#define MODES 24
+
+static char response[8192];
+static size_t response_length;
+
+static void make_response(void) {
+  static const unsigned int modes[MODES / 3][2] = {
+    {3840, 2160}, {2560, 1440}, {1920, 1080}, {1680, 1050},
+    {1600, 900}, {1280, 720}, {1024, 768}, {960, 544},
+  };
+  char *p = response;
+  char *end = response + sizeof(response);
+  p += snprintf(p, end - p,
+                "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\n"
+                "<root protocol_version=\"0.1\" query=\"serverinfo\" status_code=\"200\">\n"
+                "<hostname>DESKTOP-GAMING</hostname>\n"
+                "<appversion>7.1.431.0</appversion>\n"
+                "<GfeVersion>3.23.0.74</GfeVersion>\n"
+                "<uniqueid>4d6b3a1c-8e0f-4b7a-9a52-3f1e6c2d7b90</uniqueid>\n"
+                "<HttpsPort>47984</HttpsPort>\n"
+                "<ExternalPort>47989</ExternalPort>\n"
+                "<mac>01:23:45:67:89:ab</mac>\n"
+                "<MaxLumaPixelsHEVC>1869449984</MaxLumaPixelsHEVC>\n"
+                "<LocalIP>192.168.1.20</LocalIP>\n"
+                "<ServerCodecModeSupport>259</ServerCodecModeSupport>\n"
+                "<SupportedDisplayMode>\n");
+  for (int i = 0; i < MODES; i++) {
+    static const unsigned int rates[3] = {60, 120, 144};
+    p += snprintf(p, end - p,
+                  "<DisplayMode>\n<Width>%u</Width>\n<Height>%u</Height>\n<RefreshRate>%u</RefreshRate>\n</DisplayMode>\n",
+                  modes[i / 3][0], modes[i / 3][1], rates[i % 3]);
+  }
+  p += snprintf(p, end - p,
+                "</SupportedDisplayMode>\n"
+                "<PairStatus>1</PairStatus>\n"
+                "<currentgame>0</currentgame>\n"
+                "<state>SUNSHINE_SERVER_FREE</state>\n"
+                "<gputype>NVIDIA GeForce RTX 3070</gputype>\n"
+                "<GsVersion>7.1.431.0</GsVersion>\n"
+                "</root>\n");
+  CHECK(p < end);
+  response_length = p - response;
+}
+
+static const char *error;
+static char message[XML_MESSAGE_LENGTH];
+
+static int parse_stream(SERVERINFO *info) {
+  PXML_STREAM stream = xml_serverinfo_stream(info, &error, message);
+  CHECK(stream);
+  for (size_t offset = 0; offset < response_length; offset += CHUNK_SIZE) {
+    size_t size = response_length - offset < CHUNK_SIZE ? response_length - offset : CHUNK_SIZE;
+    CHECK(xml_stream_write(response + offset, size, stream));
+  }
+  int ret = xml_stream_end(stream);
+  xml_stream_free(stream);
+  return ret;
+}
+
+static int count_modes(PDISPLAY_MODE mode) {
+  int count = 0;
+  for (; mode != NULL; mode = mode->next) {
+    count++;
+  }
+  return count;
+}
+
+int main(void) {
+  make_response();
+
+  // both come to the same result
+  static SERVERINFO info;
+  ref_serverinfo ref;
+  CHECK(parse_stream(&info) == GS_OK);
+  CHECK(ref_serverinfo_parse(response, response_length, &ref, &error, message) == GS_OK);
+  CHECK(info.currentGame == ref.currentGame && info.paired == ref.paired);
+  CHECK(info.codecModeSupport == ref.codecModeSupport);
+  CHECK(strcmp(info.appVersion, ref.appVersion) == 0 && strcmp(info.state, ref.state) == 0);
+  CHECK(strcmp(info.gpuType, ref.gpuType) == 0 && strcmp(info.gsVersion, ref.gsVersion) == 0);
+  CHECK(strcmp(info.gfeVersion, ref.gfeVersion) == 0);
+  CHECK(count_modes(info.modes) == MODES && count_modes(ref.modes) == MODES);
+  for (PDISPLAY_MODE a = info.modes, b = ref.modes; a != NULL; a = a->next, b = b->next) {
+    CHECK(a->width == b->width && a->height == b->height && a->refresh == b->refresh);
+  }
+  ref_serverinfo_free(&ref);
+
+  uint64_t start = host_time_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    CHECK(parse_stream(&info) == GS_OK);
+  }
+  uint64_t stream_ns = host_time_ns() - start;
+
+  start = host_time_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    CHECK(ref_serverinfo_parse(response, response_length, &ref, &error, message) == GS_OK);
+    ref_serverinfo_free(&ref);
+  }
+  uint64_t ref_ns = host_time_ns() - start;
+
+  printf("serverinfo, %zu bytes, %d display modes\n", response_length, MODES);
+  printf("single pass, streamed: %7.1f us/response\n", stream_ns / 1000.0 / ITERATIONS);
+  printf("pass per field:        %7.1f us/response\n", ref_ns / 1000.0 / ITERATIONS);
+  return 0;
+}
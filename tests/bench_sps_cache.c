@@ -0,0 +1,81 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares gs_sps_fix on a cache hit with the full parse and rewrite. The
+// stream resends the same SPS with every IDR frame, which is what the host
+// does. For the uncached run the level byte is cycled through more SPS
+// variants than the cache holds, so every call misses.
+
+#include "host.h"
+#include "sps.h"
+
+#include <string.h>
+
+#define ITERATIONS 200000
+#define VARIANTS 7
+
+static char sps_nal[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50,
+  0x05, 0xbb, 0x01, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03,
+  0x03, 0xc0, 0xf1, 0x83, 0x19, 0x60,
+};
+static const char levels[VARIANTS] = { 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x28, 0x29 };
+
+static char variants[VARIANTS][sizeof(sps_nal)];
+static uint8_t out[VARIANTS][4 + 128];
+static uint32_t out_length[VARIANTS];
+
+static uint64_t run(int variant_count) {
+  uint8_t buf[4 + 128];
+  LENTRY entry = { NULL, NULL, sizeof(sps_nal), BUFFER_TYPE_SPS };
+
+  uint64_t start = host_time_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    int v = i % variant_count;
+    uint32_t length = 0;
+    entry.data = variants[v];
+    gs_sps_fix(&entry, GS_SPS_BITSTREAM_FIXUP, buf, &length);
+    // cached or not, the rewrite comes out the same
+    CHECK(length == out_length[v] && memcmp(buf, out[v], length) == 0);
+  }
+  return host_time_ns() - start;
+}
+
+int main(void) {
+  for (int v = 0; v < VARIANTS; v++) {
+    memcpy(variants[v], sps_nal, sizeof(sps_nal));
+    variants[v][7] = levels[v];
+  }
+
+  // reference output, each variant rewritten on its own
+  for (int v = 0; v < VARIANTS; v++) {
+    LENTRY entry = { NULL, variants[v], sizeof(sps_nal), BUFFER_TYPE_SPS };
+    gs_sps_init(1280, 720);
+    gs_sps_fix(&entry, GS_SPS_BITSTREAM_FIXUP, out[v], &out_length[v]);
+    gs_sps_stop();
+    CHECK(out_length[v] > 4);
+  }
+
+  gs_sps_init(1280, 720);
+  uint64_t cached_ns = run(1);
+  uint64_t uncached_ns = run(VARIANTS);
+  gs_sps_stop();
+
+  printf("sps cache hit:  %7.1f ns/SPS\n", (double) cached_ns / ITERATIONS);
+  printf("sps cache miss: %7.1f ns/SPS\n", (double) uncached_ns / ITERATIONS);
+  return 0;
+}
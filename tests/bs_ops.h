@@ -0,0 +1,54 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  BS_OP_READ_U1,
+  BS_OP_READ_U,
+  BS_OP_READ_U8,
+  BS_OP_READ_UE,
+  BS_OP_READ_SE,
+  BS_OP_PEEK_U1,
+  BS_OP_NEXT_BITS,
+  BS_OP_SKIP_U,
+  BS_OP_WRITE_U1,
+  BS_OP_WRITE_U,
+  BS_OP_WRITE_U8,
+  BS_OP_WRITE_UE,
+  BS_OP_WRITE_SE,
+} bs_op_type;
+
+typedef struct {
+  bs_op_type type;
+  int n;
+  uint32_t v;
+} bs_op;
+
+typedef struct {
+  uint32_t value;
+  int offset;
+  int bits_left;
+} bs_result;
+
+// the bitstream functions in third_party/h264bitstream/bs.h
+void bs_ops_cur(uint8_t *buf, size_t size, const bs_op *ops, int count, bs_result *results);
+// the same functions as they were before the windowed reader and writer
+void bs_ops_ref(uint8_t *buf, size_t size, const bs_op *ops, int count, bs_result *results);
@@ -0,0 +1,44 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "host.h"
+#include "debug.h"
+
+#include <stdarg.h>
+#include <time.h>
+
+uint64_t host_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t host_time_us(void) {
+  return host_time_ns() / 1000;
+}
+
+void host_sleep_us(uint64_t us) {
+  struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+  nanosleep(&ts, NULL);
+}
+
+void vita_debug_log(const char *s, ...) {
+  va_list va;
+  va_start(va, s);
+  vfprintf(stderr, s, va);
+  va_end(va);
+}
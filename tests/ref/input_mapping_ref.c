@@ -0,0 +1,285 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Copyright (C) 2016 Ilya Zhuravlev, Sunguk Lee, Vasyl Horbachenko
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// read_frontscreen, read_backscreen, is_pressed, read_analog and the
+// button part of vitainput_process as they were before the mapping was
+// compiled, taking recorded samples instead of the psp2 structures.
+
+#include "input_mapping_ref.h"
+
+#include <Limelight.h>
+
+#include <string.h>
+
+#define WIDTH INPUT_WIDTH
+#define HEIGHT INPUT_HEIGHT
+
+typedef struct Point {
+  short x;
+  short y;
+} Point;
+
+typedef struct Section {
+  Point left;
+  Point right;
+} Section;
+
+#define lerp(value, from_max, to_max) ((((value*10) * (to_max*10))/(from_max*10))/10)
+
+#define IN_SECTION(SECTION, X, Y) \
+    ((SECTION).left.x <= (X) && (X) <= (SECTION).right.x && \
+     (SECTION).left.y <= (Y) && (Y) <= (SECTION).right.y)
+
+static struct mapping map;
+static input_settings config;
+static Section BACK_SECTIONS[4];
+static Section FRONT_SECTIONS[4];
+
+static const input_record_sample *pad;
+static ref_input curr;
+static short touch_button;
+
+static void read_backscreen(void) {
+  for (int i = 0; i < pad->back_count; i++) {
+    int x = lerp(pad->back[i].x, 1919, WIDTH);
+    int y = lerp(pad->back[i].y, 1087, HEIGHT);
+
+    if ((touch_button & TOUCHSEC_NORTHWEST) == 0) {
+      if (IN_SECTION(BACK_SECTIONS[0], x, y)) {
+        touch_button |= TOUCHSEC_NORTHWEST;
+        continue;
+      }
+    }
+
+    if ((touch_button & TOUCHSEC_NORTHEAST) == 0) {
+      if (IN_SECTION(BACK_SECTIONS[1], x, y)) {
+        touch_button |= TOUCHSEC_NORTHEAST;
+        continue;
+      }
+    }
+
+    if ((touch_button & TOUCHSEC_SOUTHWEST) == 0) {
+      if (IN_SECTION(BACK_SECTIONS[2], x, y)) {
+        touch_button |= TOUCHSEC_SOUTHWEST;
+        continue;
+      }
+    }
+
+    if ((touch_button & TOUCHSEC_SOUTHEAST) == 0) {
+      if (IN_SECTION(BACK_SECTIONS[3], x, y)) {
+        touch_button |= TOUCHSEC_SOUTHEAST;
+        continue;
+      }
+    }
+  }
+}
+
+static void read_frontscreen(void) {
+  for (int i = 0; i < pad->front_count; i++) {
+    int x = lerp(pad->front[i].x, 1919, WIDTH);
+    int y = lerp(pad->front[i].y, 1087, HEIGHT);
+
+    if ((touch_button & TOUCHSEC_SPECIAL_NW) == 0) {
+      if (IN_SECTION(FRONT_SECTIONS[0], x, y)) {
+        touch_button |= TOUCHSEC_SPECIAL_NW;
+        continue;
+      }
+    }
+
+    if ((touch_button & TOUCHSEC_SPECIAL_NE) == 0) {
+      if (IN_SECTION(FRONT_SECTIONS[1], x, y)) {
+        touch_button |= TOUCHSEC_SPECIAL_NE;
+        continue;
+      }
+    }
+
+    if ((touch_button & TOUCHSEC_SPECIAL_SW) == 0) {
+      if (IN_SECTION(FRONT_SECTIONS[2], x, y)) {
+        touch_button |= TOUCHSEC_SPECIAL_SW;
+        continue;
+      }
+    }
+
+    if ((touch_button & TOUCHSEC_SPECIAL_SE) == 0) {
+      if (IN_SECTION(FRONT_SECTIONS[3], x, y)) {
+        touch_button |= TOUCHSEC_SPECIAL_SE;
+        continue;
+      }
+    }
+  }
+}
+
+static uint32_t is_pressed(uint32_t defined) {
+  uint32_t dev_type = defined & INPUT_TYPE_MASK;
+  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+
+  switch(dev_type) {
+    case INPUT_TYPE_GAMEPAD:
+      return pad->buttons & dev_val;
+    case INPUT_TYPE_TOUCHSCREEN:
+      return touch_button & dev_val;
+  }
+  return 0;
+}
+
+static short read_analog(uint32_t defined) {
+  uint32_t dev_type = defined & INPUT_TYPE_MASK;
+  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+
+  if (dev_type == INPUT_TYPE_ANALOG) {
+    int v;
+    switch(dev_val) {
+      case LEFTX:
+        v = pad->lx;
+        break;
+      case LEFTY:
+        v = pad->ly;
+        break;
+      case RIGHTX:
+        v = pad->rx;
+        break;
+      case RIGHTY:
+        v = pad->ry;
+        break;
+      case LEFT_TRIGGER:
+        return pad->lt;
+      case RIGHT_TRIGGER:
+        return pad->rt;
+      default:
+        return 0;
+    }
+    v = v * 256 - (1 << 15) + 128;
+    return (short)(v);
+  }
+  return is_pressed(defined) ? 0xff : 0;
+}
+
+// only the gamepad and analog actions, the others send events
+static void special(uint32_t defined, uint32_t pressed) {
+  uint32_t dev_type = defined & INPUT_TYPE_MASK;
+  uint32_t dev_val  = defined & INPUT_VALUE_MASK;
+
+  if (pressed) {
+    switch(dev_type) {
+      case INPUT_TYPE_GAMEPAD:
+        curr.button |= dev_val;
+        return;
+      case INPUT_TYPE_ANALOG:
+        switch(dev_val) {
+          case LEFT_TRIGGER:
+            curr.lt = 0xff;
+            return;
+          case RIGHT_TRIGGER:
+            curr.rt = 0xff;
+            return;
+        }
+        return;
+    }
+  }
+}
+
+void ref_input_config(const input_settings *settings) {
+  config = *settings;
+  map = settings->map;
+
+  int VERTICAL   = (WIDTH - config.back_left - config.back_right) / 2 + config.back_left;
+  int HORIZONTAL = (HEIGHT - config.back_top - config.back_bottom) / 2 + config.back_top;
+
+  BACK_SECTIONS[0].left.x  = config.back_left;
+  BACK_SECTIONS[0].left.y  = config.back_top;
+  BACK_SECTIONS[0].right.x = VERTICAL;
+  BACK_SECTIONS[0].right.y = HORIZONTAL;
+
+  BACK_SECTIONS[1].left.x  = VERTICAL;
+  BACK_SECTIONS[1].left.y  = config.back_top;
+  BACK_SECTIONS[1].right.x = WIDTH - config.back_right;
+  BACK_SECTIONS[1].right.y = HORIZONTAL;
+
+  BACK_SECTIONS[2].left.x  = config.back_left;
+  BACK_SECTIONS[2].left.y  = HORIZONTAL;
+  BACK_SECTIONS[2].right.x = VERTICAL;
+  BACK_SECTIONS[2].right.y = HEIGHT - config.back_bottom;
+
+  BACK_SECTIONS[3].left.x  = VERTICAL;
+  BACK_SECTIONS[3].left.y  = HORIZONTAL;
+  BACK_SECTIONS[3].right.x = WIDTH - config.back_right;
+  BACK_SECTIONS[3].right.y = HEIGHT - config.back_bottom;
+
+  FRONT_SECTIONS[0].left.x  = config.special_offset;
+  FRONT_SECTIONS[0].left.y  = config.special_offset;
+  FRONT_SECTIONS[0].right.x = config.special_offset + config.special_size;
+  FRONT_SECTIONS[0].right.y = config.special_offset + config.special_size;
+
+  FRONT_SECTIONS[1].left.x  = WIDTH - config.special_offset - config.special_size;
+  FRONT_SECTIONS[1].left.y  = config.special_offset;
+  FRONT_SECTIONS[1].right.x = WIDTH - config.special_offset;
+  FRONT_SECTIONS[1].right.y = config.special_offset + config.special_size;
+
+  FRONT_SECTIONS[2].left.x  = config.special_offset;
+  FRONT_SECTIONS[2].left.y  = HEIGHT - config.special_offset - config.special_size;
+  FRONT_SECTIONS[2].right.x = config.special_offset + config.special_size;
+  FRONT_SECTIONS[2].right.y = HEIGHT - config.special_offset;
+
+  FRONT_SECTIONS[3].left.x  = WIDTH - config.special_offset - config.special_size;
+  FRONT_SECTIONS[3].left.y  = HEIGHT - config.special_offset - config.special_size;
+  FRONT_SECTIONS[3].right.x = WIDTH - config.special_offset;
+  FRONT_SECTIONS[3].right.y = HEIGHT - config.special_offset;
+}
+
+void ref_input_process(const input_record_sample *sample, ref_input *out) {
+  pad = sample;
+  touch_button = 0;
+  memset(&curr, 0, sizeof(curr));
+
+  read_frontscreen();
+  read_backscreen();
+
+  // buttons
+  curr.button |= is_pressed(map.btn_dpad_up)    ? UP_FLAG     : 0;
+  curr.button |= is_pressed(map.btn_dpad_left)  ? LEFT_FLAG   : 0;
+  curr.button |= is_pressed(map.btn_dpad_down)  ? DOWN_FLAG   : 0;
+  curr.button |= is_pressed(map.btn_dpad_right) ? RIGHT_FLAG  : 0;
+  curr.button |= is_pressed(map.btn_start)      ? PLAY_FLAG   : 0;
+  curr.button |= is_pressed(map.btn_select)     ? BACK_FLAG   : 0;
+  curr.button |= is_pressed(map.btn_north)      ? Y_FLAG      : 0;
+  curr.button |= is_pressed(map.btn_east)       ? B_FLAG      : 0;
+  curr.button |= is_pressed(map.btn_south)      ? A_FLAG      : 0;
+  curr.button |= is_pressed(map.btn_west)       ? X_FLAG      : 0;
+  curr.button |= is_pressed(map.btn_thumbl)     ? LB_FLAG     : 0; // l1
+  curr.button |= is_pressed(map.btn_thumbr)     ? RB_FLAG     : 0; // r1
+  curr.button |= is_pressed(map.btn_tl2)        ? LS_CLK_FLAG : 0; // l3
+  curr.button |= is_pressed(map.btn_tr2)        ? RS_CLK_FLAG : 0; // r3
+
+  // analogs
+  curr.lt = read_analog(map.btn_tl); // l2
+  curr.rt = read_analog(map.btn_tr); // r2
+  curr.lx = read_analog(map.abs_x);
+  curr.ly = read_analog(map.abs_y);
+  curr.rx = read_analog(map.abs_rx);
+  curr.ry = read_analog(map.abs_ry);
+
+  // special touchscreen buttons
+  special(config.special_nw, is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NW));
+  special(config.special_ne, is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_NE));
+  special(config.special_sw, is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SW));
+  special(config.special_se, is_pressed(INPUT_TYPE_TOUCHSCREEN | TOUCHSEC_SPECIAL_SE));
+
+  *out = curr;
+  out->touch_button = touch_button;
+}
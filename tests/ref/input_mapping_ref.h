@@ -0,0 +1,41 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Copyright (C) 2016 Ilya Zhuravlev, Sunguk Lee, Vasyl Horbachenko
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "input/pipeline.h"
+
+// The controller mapping as it was before it was compiled into tables:
+// every poll decodes each mapping entry with is_pressed and read_analog,
+// and tests touches against the section rectangles one by one.
+
+typedef struct {
+  short button;
+  short lx;
+  short ly;
+  short rx;
+  short ry;
+  char  lt;
+  char  rt;
+  // sections touched on both panels
+  short touch_button;
+} ref_input;
+
+void ref_input_config(const input_settings *settings);
+void ref_input_process(const input_record_sample *sample, ref_input *out);
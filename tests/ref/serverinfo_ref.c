@@ -0,0 +1,164 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Copyright (C) 2015 Iwan Timmer
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serverinfo_ref.h"
+#include "errors.h"
+
+#include <expat.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct xml_query {
+  char *memory;
+  size_t size;
+  int start;
+  void* data;
+};
+
+static void XMLCALL _xml_start_mode_element(void *userData, const char *name, const char **atts) {
+  struct xml_query *search = (struct xml_query*) userData;
+  if (strcmp("DisplayMode", name) == 0) {
+    PDISPLAY_MODE mode = calloc(1, sizeof(DISPLAY_MODE));
+    if (mode != NULL) {
+      mode->next = (PDISPLAY_MODE) search->data;
+      search->data = mode;
+    }
+  } else if (search->data != NULL && (strcmp("Height", name) == 0 || strcmp("Width", name) == 0 || strcmp("RefreshRate", name) == 0)) {
+    search->memory = malloc(1);
+    search->size = 0;
+    search->start = 1;
+  }
+}
+
+static void XMLCALL _xml_end_mode_element(void *userData, const char *name) {
+  struct xml_query *search = (struct xml_query*) userData;
+  if (search->data != NULL && search->start) {
+    PDISPLAY_MODE mode = (PDISPLAY_MODE) search->data;
+    if (strcmp("Width", name) == 0)
+      mode->width = atoi(search->memory);
+    else if (strcmp("Height", name) == 0)
+      mode->height = atoi(search->memory);
+    else if (strcmp("RefreshRate", name) == 0)
+      mode->refresh = atoi(search->memory);
+
+    free(search->memory);
+    search->start = 0;
+  }
+}
+
+static void XMLCALL _xml_write_data(void *userData, const XML_Char *s, int len) {
+  struct xml_query *search = (struct xml_query*) userData;
+  if (search->start > 0) {
+    search->memory = realloc(search->memory, search->size + len + 1);
+    if(search->memory == NULL)
+      return;
+
+    memcpy(&(search->memory[search->size]), s, len);
+    search->size += len;
+    search->memory[search->size] = 0;
+  }
+}
+
+static int xml_modelist(char* data, size_t len, PDISPLAY_MODE *mode_list, const char **error) {
+  struct xml_query query = {0};
+  query.memory = calloc(1, 1);
+  XML_Parser parser = XML_ParserCreate("UTF-8");
+  XML_SetUserData(parser, &query);
+  XML_SetElementHandler(parser, _xml_start_mode_element, _xml_end_mode_element);
+  XML_SetCharacterDataHandler(parser, _xml_write_data);
+  if (! XML_Parse(parser, data, len, 1)) {
+    int code = XML_GetErrorCode(parser);
+    *error = XML_ErrorString(code);
+    XML_ParserFree(parser);
+    return GS_INVALID;
+  }
+
+  XML_ParserFree(parser);
+  *mode_list = (PDISPLAY_MODE) query.data;
+
+  return GS_OK;
+}
+
+int ref_serverinfo_parse(char *data, size_t len, ref_serverinfo *info, const char **error, char *message) {
+  char *pairedText = NULL;
+  char *currentGameText = NULL;
+  char *serverCodecModeSupportText = NULL;
+  int ret = GS_INVALID;
+
+  memset(info, 0, sizeof(ref_serverinfo));
+  if (xml_status(data, len, error, message) == GS_ERROR) {
+    ret = GS_ERROR;
+    goto cleanup;
+  }
+
+  if (xml_search(data, len, "currentgame", &currentGameText, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_search(data, len, "PairStatus", &pairedText, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_search(data, len, "appversion", &info->appVersion, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_search(data, len, "state", &info->state, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_search(data, len, "ServerCodecModeSupport", &serverCodecModeSupportText, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_search(data, len, "gputype", &info->gpuType, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_search(data, len, "GsVersion", &info->gsVersion, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_search(data, len, "GfeVersion", &info->gfeVersion, error) != GS_OK)
+    goto cleanup;
+
+  if (xml_modelist(data, len, &info->modes, error) != GS_OK)
+    goto cleanup;
+
+  // These fields are present on all version of GFE that this client supports
+  if (!strlen(currentGameText) || !strlen(pairedText) || !strlen(info->appVersion) || !strlen(info->state))
+    goto cleanup;
+
+  info->paired = strcmp(pairedText, "1") == 0;
+  info->currentGame = atoi(currentGameText);
+  info->codecModeSupport = strlen(serverCodecModeSupportText) > 0;
+  ret = GS_OK;
+
+  cleanup:
+  free(pairedText);
+  free(currentGameText);
+  free(serverCodecModeSupportText);
+  return ret;
+}
+
+void ref_serverinfo_free(ref_serverinfo *info) {
+  free(info->appVersion);
+  free(info->state);
+  free(info->gpuType);
+  free(info->gsVersion);
+  free(info->gfeVersion);
+  while (info->modes != NULL) {
+    PDISPLAY_MODE next = info->modes->next;
+    free(info->modes);
+    info->modes = next;
+  }
+}
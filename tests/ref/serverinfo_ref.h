@@ -0,0 +1,41 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Copyright (C) 2015 Iwan Timmer
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "xml.h"
+
+// serverinfo as it was parsed before the single pass: the status, then a
+// separate expat pass with xml_search for each field and one more for the
+// display modes, all of them allocated.
+
+typedef struct {
+  int currentGame;
+  bool paired;
+  bool codecModeSupport;
+  char *appVersion;
+  char *state;
+  char *gpuType;
+  char *gsVersion;
+  char *gfeVersion;
+  PDISPLAY_MODE modes;
+} ref_serverinfo;
+
+int ref_serverinfo_parse(char *data, size_t len, ref_serverinfo *info, const char **error, char *message);
+void ref_serverinfo_free(ref_serverinfo *info);
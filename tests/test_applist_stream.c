@@ -0,0 +1,139 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// An applist of 1000 apps parsed while it streams in, cut into chunks of
+// every size from one byte to a TCP segment, so tags, entities and titles
+// get split at every possible place. Every app has to come out once, in
+// order, with its title, and the status and parse errors of broken
+// responses have to be reported.
+
+#include "host.h"
+#include "errors.h"
+#include "xml.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define APPS 1000
+#define TITLE_LENGTH 255
+
+static char *response;
+static size_t response_length;
+
+static void title_of(int i, char *title) {
+  // every 100th title is longer than a title can be
+  if (i % 100 == 99) {
+    memset(title, 'a' + i % 26, TITLE_LENGTH + 40);
+    title[TITLE_LENGTH + 40] = 0;
+  } else {
+    sprintf(title, "Game %d & Friends <%d>", i, i * 7);
+  }
+}
+
+static void make_response(void) {
+  size_t size = APPS * 512 + 512;
+  response = malloc(size);
+  CHECK(response);
+  char *p = response;
+  p += sprintf(p, "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\n"
+                  "<root protocol_version=\"0.1\" query=\"applist\" status_code=\"200\">\n");
+  for (int i = 0; i < APPS; i++) {
+    char title[TITLE_LENGTH + 64];
+    title_of(i, title);
+    p += sprintf(p, "<App>\n<IsHdrSupported>%d</IsHdrSupported>\n<AppTitle>", i % 2);
+    for (char *c = title; *c; c++) {
+      if (*c == '&')
+        p += sprintf(p, "&amp;");
+      else if (*c == '<')
+        p += sprintf(p, "&lt;");
+      else if (*c == '>')
+        p += sprintf(p, "&gt;");
+      else
+        *p++ = *c;
+    }
+    p += sprintf(p, "</AppTitle>\n<ID>%d</ID>\n</App>\n", 100000 + i);
+  }
+  p += sprintf(p, "</root>\n");
+  CHECK((size_t) (p - response) < size);
+  response_length = p - response;
+}
+
+static int apps_seen;
+static bool apps_in_order;
+
+static void check_app(int id, const char *name, void *context) {
+  char title[TITLE_LENGTH + 64];
+  title_of(apps_seen, title);
+  title[TITLE_LENGTH] = 0;
+  if (id != 100000 + apps_seen || strcmp(name, title) != 0)
+    apps_in_order = false;
+  apps_seen++;
+}
+
+static const char *error;
+static char message[XML_MESSAGE_LENGTH];
+
+static int parse(const char *data, size_t length, size_t chunk) {
+  apps_seen = 0;
+  apps_in_order = true;
+  error = NULL;
+  PXML_STREAM stream = xml_applist_stream(check_app, NULL, &error, message);
+  CHECK(stream);
+  int ret = GS_OK;
+  for (size_t offset = 0; offset < length; offset += chunk) {
+    size_t size = length - offset < chunk ? length - offset : chunk;
+    if (!xml_stream_write(data + offset, size, stream)) {
+      ret = GS_INVALID;
+      break;
+    }
+  }
+  if (ret == GS_OK)
+    ret = xml_stream_end(stream);
+  xml_stream_free(stream);
+  return ret;
+}
+
+int main(int argc, char **argv) {
+  make_response();
+
+  for (size_t chunk = 1; chunk <= 1448; chunk = chunk < 16 ? chunk + 1 : chunk * 3 / 2) {
+    CHECK(parse(response, response_length, chunk) == GS_OK);
+    CHECK(apps_seen == APPS && apps_in_order);
+  }
+  uint64_t start = host_time_us();
+  CHECK(parse(response, response_length, 1448) == GS_OK);
+  printf("%d apps, %zu bytes, parsed in %u us\n", APPS, response_length,
+         (uint32_t) (host_time_us() - start));
+
+  // cut off in the middle, the apps so far are reported and the end fails
+  CHECK(parse(response, response_length / 2, 1448) == GS_INVALID);
+  CHECK(apps_seen > 0 && apps_seen < APPS && apps_in_order);
+  CHECK(error != NULL);
+
+  // broken markup stops the stream at the chunk it is in
+  char broken[] = "<root status_code=\"200\"><App><ID>1</ID></Ap></root>";
+  CHECK(parse(broken, strlen(broken), 8) == GS_INVALID);
+  CHECK(error != NULL);
+
+  // the host's status message ends up in the message buffer
+  char refused[] = "<root status_code=\"401\" status_message=\"The client is not authorized. Certificate verification failed.\"/>";
+  CHECK(parse(refused, strlen(refused), 16) == GS_ERROR);
+  CHECK(error == message && strcmp(message, "The client is not authorized. Certificate verification failed.") == 0);
+
+  free(response);
+  return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The PCM ring and jitter target, first on their own and then between a
+// fake decoder thread and a null sink. The decoder pushes 5 ms packets
+// that arrive with random jitter and the occasional late burst, the sink
+// drains 256 frame blocks on a fixed clock the way sceAudioOutOutput does,
+// after building up the target like the Vita output thread. Every frame
+// carries its packet and frame number, so the sink can check nothing was
+// torn, reordered or duplicated. Underruns and overruns are reported.
+
+#include "host.h"
+#include "audio/buffer.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define SAMPLE_RATE 48000
+#define RING_FRAMES 4096
+#define PACKET_FRAMES 240
+#define OUTPUT_FRAMES 256
+#define LATENCY_FRAMES 960
+// two seconds of audio per scenario
+#define PACKETS 400
+
+static short ring_data[2 * RING_FRAMES];
+static pcm_ring ring;
+
+// Left holds the packet number, right the frame within the packet
+static void fill_packet(short *pcm, uint32_t frames, uint32_t packet) {
+  for (uint32_t i = 0; i < frames; i++) {
+    pcm[2 * i] = (short) packet;
+    pcm[2 * i + 1] = (short) i;
+  }
+}
+
+static void test_ring() {
+  static short pcm[2 * RING_FRAMES];
+  static short out[2 * RING_FRAMES];
+  pcm_ring_init(&ring, ring_data, RING_FRAMES);
+
+  // wrap around the end of the storage several times with odd sizes
+  uint32_t pushed = 0, popped = 0;
+  for (int round = 0; round < 1000; round++) {
+    uint32_t frames = 1 + (round * 997) % 1500;
+    fill_packet(pcm, frames, round);
+    CHECK(pcm_ring_push(&ring, pcm, frames));
+    pushed += frames;
+    CHECK(pcm_ring_fill_producer(&ring) == pushed - popped);
+    CHECK(pcm_ring_fill_consumer(&ring) == pushed - popped);
+
+    CHECK(pcm_ring_pop(&ring, out, frames) == frames);
+    for (uint32_t i = 0; i < frames; i++) {
+      CHECK(out[2 * i] == round && out[2 * i + 1] == (short) i);
+    }
+    popped += frames;
+  }
+
+  // a full ring refuses more and keeps what it has
+  CHECK(pcm_ring_push(&ring, pcm, RING_FRAMES));
+  CHECK(!pcm_ring_push(&ring, pcm, 1));
+  CHECK(pcm_ring_fill_consumer(&ring) == RING_FRAMES);
+  pcm_ring_drop(&ring, RING_FRAMES - 10);
+  CHECK(pcm_ring_fill_consumer(&ring) == 10);
+  CHECK(!pcm_ring_push(&ring, pcm, RING_FRAMES - 9));
+  CHECK(pcm_ring_push(&ring, pcm, RING_FRAMES - 10));
+
+  // a pop never goes past what was written
+  pcm_ring_drop(&ring, RING_FRAMES - 5);
+  CHECK(pcm_ring_pop(&ring, out, 100) == 5);
+  CHECK(pcm_ring_fill_consumer(&ring) == 0);
+  CHECK(pcm_ring_pop(&ring, out, 1) == 0);
+  CHECK(pcm_ring_push(&ring, pcm, RING_FRAMES));
+}
+
+static void test_jitter() {
+  audio_jitter jitter = {0};
+
+  // evenly spaced packets leave no jitter
+  for (int i = 0; i < 100; i++) {
+    audio_jitter_update(&jitter, 1000000 + i * 5000, 5000);
+  }
+  CHECK(jitter.jitter_us == 0);
+
+  // packets alternating 2 ms early and late settle around 2 ms
+  uint64_t now = jitter.last_packet_us;
+  for (int i = 0; i < 200; i++) {
+    now += i % 2 ? 7000 : 3000;
+    audio_jitter_update(&jitter, now, 5000);
+  }
+  CHECK(jitter.jitter_us > 1800 && jitter.jitter_us <= 2000);
+
+  CHECK(audio_target_frames(960, 96, 256, 3000) == 960 + 2 * 96);
+  CHECK(audio_target_frames(0, 0, 256, 3000) == 256);
+  CHECK(audio_target_frames(960, 4000, 256, 3000) == 3000);
+}
+
+typedef struct {
+  const char *name;
+  // maximum random delay of a packet
+  uint32_t jitter_us;
+  // every this many packets the network stalls and delivers a burst
+  uint32_t burst_every;
+  uint32_t burst_us;
+} scenario;
+
+static const scenario *current;
+static volatile uint32_t target_frames;
+static volatile bool producer_done;
+static uint32_t underruns;
+static uint32_t overruns;
+static uint32_t frames_played;
+static uint32_t max_fill;
+
+// The decoder side, a packet every 5 ms, each delayed by a random amount
+static void *producer_main(void *arg) {
+  static short pcm[2 * PACKET_FRAMES];
+  audio_jitter jitter = {0};
+  uint32_t seed = 12345;
+  uint64_t start = host_time_us();
+
+  for (uint32_t n = 0; n < PACKETS; n++) {
+    seed = seed * 1103515245 + 12345;
+    uint64_t due = start + (uint64_t) n * PACKET_FRAMES * 1000000 / SAMPLE_RATE;
+    due += (seed >> 8) % (current->jitter_us + 1);
+    if (current->burst_every && n % current->burst_every == 0) {
+      due += current->burst_us;
+    }
+    uint64_t now = host_time_us();
+    if (due > now) {
+      host_sleep_us(due - now);
+    }
+
+    now = host_time_us();
+    audio_jitter_update(&jitter, now, PACKET_FRAMES * 1000000 / SAMPLE_RATE);
+    target_frames = audio_target_frames(LATENCY_FRAMES, jitter.jitter_us * (SAMPLE_RATE / 1000) / 1000,
+                                        OUTPUT_FRAMES, RING_FRAMES - PACKET_FRAMES);
+
+    // same overrun policy as the Vita backend
+    fill_packet(pcm, PACKET_FRAMES, n);
+    if (pcm_ring_fill_producer(&ring) > 2 * target_frames + OUTPUT_FRAMES ||
+        !pcm_ring_push(&ring, pcm, PACKET_FRAMES)) {
+      overruns++;
+    }
+  }
+
+  producer_done = true;
+  return NULL;
+}
+
+// Stands in for sceAudioOutOutput, which blocks until the previous block
+// has played. Checks the frames follow each other, allowing for the gaps
+// dropped packets leave.
+static void *sink_main(void *arg) {
+  static short out[2 * OUTPUT_FRAMES];
+  uint64_t block_us = (uint64_t) OUTPUT_FRAMES * 1000000 / SAMPLE_RATE;
+  uint64_t next = host_time_us();
+  bool prebuffering = true;
+  int packet = -1;
+  int frame = PACKET_FRAMES - 1;
+
+  while (!producer_done || pcm_ring_fill_consumer(&ring) >= OUTPUT_FRAMES) {
+    uint32_t fill = pcm_ring_fill_consumer(&ring);
+    if (fill > max_fill) {
+      max_fill = fill;
+    }
+
+    if (prebuffering && fill >= target_frames) {
+      prebuffering = false;
+    }
+    if (!prebuffering && fill < OUTPUT_FRAMES) {
+      underruns++;
+      prebuffering = true;
+    }
+
+    if (prebuffering) {
+      memset(out, 0, sizeof(out));
+    } else {
+      pcm_ring_pop(&ring, out, OUTPUT_FRAMES);
+      for (uint32_t i = 0; i < OUTPUT_FRAMES; i++) {
+        // a packet boundary may skip dropped packets, nothing else may
+        if (out[2 * i] == packet) {
+          CHECK(out[2 * i + 1] == frame + 1);
+        } else {
+          CHECK(frame == PACKET_FRAMES - 1);
+          CHECK(out[2 * i] > packet && out[2 * i + 1] == 0);
+        }
+        packet = out[2 * i];
+        frame = out[2 * i + 1];
+      }
+      frames_played += OUTPUT_FRAMES;
+    }
+
+    next += block_us;
+    uint64_t now = host_time_us();
+    if (next > now) {
+      host_sleep_us(next - now);
+    }
+  }
+  return NULL;
+}
+
+static void run(const scenario *s) {
+  current = s;
+  pcm_ring_init(&ring, ring_data, RING_FRAMES);
+  target_frames = LATENCY_FRAMES;
+  producer_done = false;
+  underruns = 0;
+  overruns = 0;
+  frames_played = 0;
+  max_fill = 0;
+
+  pthread_t producer, sink;
+  pthread_create(&sink, NULL, sink_main, NULL);
+  pthread_create(&producer, NULL, producer_main, NULL);
+  pthread_join(producer, NULL);
+  pthread_join(sink, NULL);
+
+  printf("%-16s played %6u frames, underruns %3u, overruns %3u, max fill %4u, target %4u\n",
+         s->name, frames_played, underruns, overruns, max_fill, target_frames);
+  CHECK(max_fill <= RING_FRAMES);
+  CHECK(frames_played > PACKETS * PACKET_FRAMES / 2);
+}
+
+int main(int argc, char **argv) {
+  test_ring();
+  test_jitter();
+
+  static const scenario scenarios[] = {
+    {"steady", 0, 0, 0},
+    {"jitter 4 ms", 4000, 0, 0},
+    {"jitter 15 ms", 15000, 0, 0},
+    {"bursts 40 ms", 1000, 100, 40000},
+  };
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); i++) {
+    run(&scenarios[i]);
+  }
+
+  // a steady stream with the default latency must play without a gap
+  run(&scenarios[0]);
+  CHECK(underruns == 0 && overruns == 0);
+  return 0;
+}
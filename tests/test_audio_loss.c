@@ -0,0 +1,130 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The loss handling against a fake decoder that records what it is asked
+// for: single losses are rebuilt from the FEC data of the next packet,
+// longer ones concealed in front of it, and losses longer than the pending
+// limit concealed as they happen.
+
+#include "host.h"
+#include "audio/loss.h"
+
+#include <string.h>
+
+#define MAX_FRAMES 5760
+
+typedef struct {
+  // P for a decoded packet, F for FEC, C for concealment
+  char kind;
+  int frames;
+} decode_call;
+
+static decode_call calls[64];
+static int call_count;
+// kinds the fake decoder fails on
+static const char *failing = "";
+
+static int fake_decode(void *context, const unsigned char *data, int length, int frames, int fec) {
+  char kind = data == NULL ? 'C' : fec ? 'F' : 'P';
+  CHECK(call_count < 64);
+  calls[call_count].kind = kind;
+  calls[call_count].frames = frames;
+  call_count++;
+  if (strchr(failing, kind)) {
+    return -1;
+  }
+  // a packet decodes to its own length, the fake packets hold it
+  return data == NULL || fec ? frames : data[0] * 120;
+}
+
+// The calls since the last check as a string of kinds
+static void check_calls(const char *expected) {
+  char kinds[65];
+  for (int i = 0; i < call_count; i++) {
+    kinds[i] = calls[i].kind;
+  }
+  kinds[call_count] = 0;
+  if (strcmp(kinds, expected) != 0) {
+    fprintf(stderr, "decoder calls %s, expected %s\n", kinds, expected);
+    CHECK(0);
+  }
+  call_count = 0;
+}
+
+int main(int argc, char **argv) {
+  audio_loss loss;
+  audio_loss_init(&loss, fake_decode, NULL, 240, MAX_FRAMES);
+
+  // a 10 ms packet decodes in full and sets the length for concealment
+  unsigned char packet[] = {4};
+  CHECK(audio_loss_packet(&loss, packet, 1, 480) == 480);
+  check_calls("P");
+  CHECK(calls[0].frames == MAX_FRAMES);
+  CHECK(loss.packet_frames == 480);
+
+  // one loss comes back from the FEC data of the next packet
+  audio_loss_packet_lost(&loss);
+  check_calls("");
+  audio_loss_packet(&loss, packet, 1, 480);
+  check_calls("FP");
+  CHECK(calls[0].frames == 480);
+  CHECK(loss.recovered == 1 && loss.concealed == 0);
+
+  // three losses, two concealed and the last one rebuilt
+  for (int i = 0; i < 3; i++) {
+    audio_loss_packet_lost(&loss);
+  }
+  check_calls("");
+  audio_loss_packet(&loss, packet, 1, 480);
+  check_calls("CCFP");
+  CHECK(calls[0].frames == 480 && calls[1].frames == 480);
+  CHECK(loss.recovered == 2 && loss.concealed == 2);
+
+  // beyond the pending limit every further loss is concealed right away
+  for (int i = 0; i < AUDIO_MAX_PENDING_LOSSES + 3; i++) {
+    audio_loss_packet_lost(&loss);
+  }
+  check_calls("CCC");
+  audio_loss_packet(&loss, packet, 1, 480);
+  check_calls("CCCFP");
+  CHECK(loss.concealed == 2 + 3 + AUDIO_MAX_PENDING_LOSSES - 1);
+  CHECK(loss.lost == 1 + 3 + AUDIO_MAX_PENDING_LOSSES + 3);
+  CHECK(loss.received == 4);
+
+  // a packet of a different length changes the FEC request, a broken
+  // one keeps the last good length
+  audio_loss_packet_lost(&loss);
+  unsigned char short_packet[] = {2};
+  audio_loss_packet(&loss, short_packet, 1, 240);
+  check_calls("FP");
+  CHECK(calls[0].frames == 240);
+  audio_loss_packet(&loss, short_packet, 1, -4);
+  check_calls("P");
+  CHECK(loss.packet_frames == 240);
+
+  // failed decodes are passed on and not counted
+  failing = "CFP";
+  uint32_t concealed = loss.concealed, recovered = loss.recovered;
+  audio_loss_packet_lost(&loss);
+  audio_loss_packet_lost(&loss);
+  CHECK(audio_loss_packet(&loss, packet, 1, 480) < 0);
+  check_calls("CFP");
+  CHECK(loss.concealed == concealed && loss.recovered == recovered);
+  CHECK(loss.pending == 0);
+
+  return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Replays an Opus stream through the loss handling with a real decoder and
+// injected packet losses, and reports the gaps left in the output. The
+// stream is read from a file of packets, each with a two byte big endian
+// length in front, recorded from a stereo 48 kHz session:
+//
+//   test_audio_loss_replay [packets]
+//
+// Without a file a synthetic stream is encoded: ten seconds of a pair of
+// tones in 20 ms packets with in-band FEC, the way a host would send it
+// with FEC enabled.
+//
+// Each loss pattern is replayed twice, once dropping lost packets the way
+// the renderer used to and once through audio_loss. Reported are the audio
+// missing from the output, the 2.5 ms windows that came out silent where
+// the lossless decode has sound, and the SNR against the lossless decode.
+
+#include "host.h"
+#include "audio/loss.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+#include <opus/opus.h>
+
+#define SAMPLE_RATE 48000
+#define MAX_FRAME_SIZE 5760
+#define MAX_PACKETS 4096
+#define MAX_PACKET_BYTES 1500
+#define WINDOW_FRAMES 120
+
+typedef struct {
+  unsigned char data[MAX_PACKET_BYTES];
+  int length;
+} packet;
+
+static packet packets[MAX_PACKETS];
+static int packet_count;
+
+static short *reference;
+static uint32_t reference_frames;
+
+static OpusDecoder *decoder;
+static short *output;
+static uint32_t output_frames;
+static uint32_t output_capacity;
+
+static int load_packets(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  unsigned char header[2];
+  while (packet_count < MAX_PACKETS && fread(header, 1, 2, file) == 2) {
+    packet *p = &packets[packet_count];
+    p->length = header[0] << 8 | header[1];
+    if (p->length > MAX_PACKET_BYTES || fread(p->data, 1, p->length, file) != (size_t) p->length) {
+      fprintf(stderr, "%s: broken packet %d\n", path, packet_count);
+      fclose(file);
+      return -1;
+    }
+    packet_count++;
+  }
+  fclose(file);
+  return 0;
+}
+
+static void encode_packets() {
+  int error;
+  OpusEncoder *encoder = opus_encoder_create(SAMPLE_RATE, 2, OPUS_APPLICATION_VOIP, &error);
+  CHECK(error == OPUS_OK);
+  opus_encoder_ctl(encoder, OPUS_SET_BITRATE(64000));
+  opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(1));
+  opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(10));
+
+  short pcm[2 * 960];
+  uint32_t t = 0;
+  for (packet_count = 0; packet_count < 500; packet_count++) {
+    for (int i = 0; i < 960; i++, t++) {
+      double envelope = 0.5 + 0.4 * sin(2 * M_PI * 0.5 * t / SAMPLE_RATE);
+      pcm[2 * i] = 12000 * envelope * sin(2 * M_PI * 440 * t / SAMPLE_RATE);
+      pcm[2 * i + 1] = 12000 * envelope * sin(2 * M_PI * 660 * t / SAMPLE_RATE);
+    }
+    packet *p = &packets[packet_count];
+    p->length = opus_encode(encoder, pcm, 960, p->data, MAX_PACKET_BYTES);
+    CHECK(p->length > 0);
+  }
+  opus_encoder_destroy(encoder);
+}
+
+static int replay_decode(void *context, const unsigned char *data, int length, int frames, int fec) {
+  CHECK(output_frames + frames <= output_capacity);
+  int decodeLen = opus_decode(decoder, data, length, &output[2 * output_frames], frames, fec);
+  if (decodeLen > 0) {
+    output_frames += decodeLen;
+  }
+  return decodeLen;
+}
+
+static void reset_decoder() {
+  int error;
+  if (decoder != NULL) {
+    opus_decoder_destroy(decoder);
+  }
+  decoder = opus_decoder_create(SAMPLE_RATE, 2, &error);
+  CHECK(error == OPUS_OK);
+  output_frames = 0;
+}
+
+typedef struct {
+  const char *name;
+  // chance of losing a packet, and of losing the next one after a loss
+  double loss;
+  double burst;
+} pattern;
+
+typedef struct {
+  uint32_t lost;
+  uint32_t concealed;
+  uint32_t recovered;
+  uint32_t missing_frames;
+  uint32_t silent_windows;
+  double snr_db;
+} gap_stats;
+
+static void measure(gap_stats *stats) {
+  stats->missing_frames = output_frames < reference_frames ? reference_frames - output_frames : 0;
+
+  stats->silent_windows = 0;
+  double signal = 0, noise = 0;
+  for (uint32_t w = 0; w + WINDOW_FRAMES <= reference_frames; w += WINDOW_FRAMES) {
+    double ref_energy = 0, out_energy = 0;
+    for (uint32_t i = 2 * w; i < 2 * (w + WINDOW_FRAMES); i++) {
+      double r = reference[i];
+      double o = i < 2 * output_frames ? output[i] : 0;
+      ref_energy += r * r;
+      out_energy += o * o;
+      noise += (r - o) * (r - o);
+    }
+    signal += ref_energy;
+    if (out_energy < ref_energy / 100) {
+      stats->silent_windows++;
+    }
+  }
+  stats->snr_db = noise > 0 ? 10 * log10(signal / noise) : 99;
+}
+
+static void replay(const pattern *pat, bool conceal, gap_stats *stats) {
+  audio_loss loss;
+  audio_loss_init(&loss, replay_decode, NULL, 240, MAX_FRAME_SIZE);
+  reset_decoder();
+
+  // same losses for both runs
+  uint32_t seed = 42;
+  bool lost = false;
+  for (int n = 0; n < packet_count; n++) {
+    seed = seed * 1103515245 + 12345;
+    double chance = (seed >> 8) / (double) (1 << 24);
+    lost = chance < (lost ? pat->burst : pat->loss);
+
+    const packet *p = &packets[n];
+    if (lost) {
+      if (conceal) {
+        audio_loss_packet_lost(&loss);
+      } else {
+        loss.lost++;
+      }
+    } else {
+      int frames = opus_packet_get_nb_samples(p->data, p->length, SAMPLE_RATE);
+      if (conceal) {
+        audio_loss_packet(&loss, p->data, p->length, frames);
+      } else {
+        loss.received++;
+        replay_decode(NULL, p->data, p->length, MAX_FRAME_SIZE, 0);
+      }
+    }
+  }
+
+  stats->lost = loss.lost;
+  stats->concealed = loss.concealed;
+  stats->recovered = loss.recovered;
+  measure(stats);
+}
+
+static void print_stats(const char *name, const char *mode, const gap_stats *stats) {
+  printf("%-14s %-8s lost %4u, concealed %4u, recovered %4u, missing %6.1f ms, silent windows %4u, snr %5.1f dB\n",
+         name, mode, stats->lost, stats->concealed, stats->recovered,
+         stats->missing_frames * 1000.0 / SAMPLE_RATE, stats->silent_windows, stats->snr_db);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    if (load_packets(argv[1]) < 0) {
+      return 1;
+    }
+  } else {
+    encode_packets();
+  }
+
+  uint32_t total_frames = 0;
+  for (int n = 0; n < packet_count; n++) {
+    int frames = opus_packet_get_nb_samples(packets[n].data, packets[n].length, SAMPLE_RATE);
+    CHECK(frames > 0);
+    total_frames += frames;
+  }
+  output_capacity = total_frames + 16 * MAX_FRAME_SIZE;
+  output = malloc(output_capacity * 2 * sizeof(short));
+  CHECK(output != NULL);
+
+  // the lossless decode everything is compared against
+  pattern none = {"none", 0, 0};
+  gap_stats stats;
+  replay(&none, true, &stats);
+  CHECK(stats.lost == 0 && output_frames == total_frames);
+  reference_frames = output_frames;
+  reference = malloc(reference_frames * 2 * sizeof(short));
+  CHECK(reference != NULL);
+  memcpy(reference, output, reference_frames * 2 * sizeof(short));
+
+  static const pattern patterns[] = {
+    {"random 1%", 0.01, 0.01},
+    {"random 5%", 0.05, 0.05},
+    {"random 10%", 0.10, 0.10},
+    {"bursts 2%", 0.02, 0.60},
+  };
+  for (size_t i = 0; i < sizeof(patterns) / sizeof(*patterns); i++) {
+    gap_stats dropped, concealed;
+    replay(&patterns[i], false, &dropped);
+    replay(&patterns[i], true, &concealed);
+    print_stats(patterns[i].name, "dropped", &dropped);
+    print_stats(patterns[i].name, "conceal", &concealed);
+
+    // concealment keeps the stream the length of the lossless one, as far
+    // as the losses at the very end which no packet follows
+    CHECK(concealed.lost == dropped.lost);
+    CHECK(concealed.missing_frames <= AUDIO_MAX_PENDING_LOSSES * MAX_FRAME_SIZE);
+    CHECK(concealed.silent_windows <= dropped.silent_windows);
+    CHECK(concealed.recovered > 0 || concealed.lost == 0);
+  }
+
+  opus_decoder_destroy(decoder);
+  free(output);
+  free(reference);
+  return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Differential test of the windowed bitstream reader and writer against
+// the bit at a time version they replaced. Random operation sequences run
+// on random buffers, including reads and writes past the end, and every
+// value, position and written byte has to match.
+
+#include "host.h"
+#include "bs_ops.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define CASES 100000
+#define MAX_OPS 200
+#define MAX_SIZE 64
+
+static uint32_t seed = 12345;
+
+static uint32_t next_random(void) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+// Mostly random bytes, with zeros so long Exp-Golomb prefixes and zero
+// fields come up as well. Runs stop at two zero bytes: a prefix of 32 zero
+// bits overflows (1 << i) in bs_read_ue, in both versions.
+static void fill_buffer(uint8_t *buf, int size) {
+  int zeros = 0;
+  for (int i = 0; i < size; i++) {
+    uint32_t r = next_random();
+    if ((r & 7) == 0 && zeros < 2) {
+      buf[i] = 0;
+    } else {
+      buf[i] = (uint8_t) (r >> 8) ? (uint8_t) (r >> 8) : 0x80;
+    }
+    zeros = buf[i] == 0 ? zeros + 1 : 0;
+  }
+}
+
+static void random_read(bs_op *op) {
+  uint32_t r = next_random();
+  op->type = (bs_op_type) (r % (BS_OP_SKIP_U + 1));
+  op->n = (r >> 8) % 33;
+  op->v = 0;
+}
+
+static void random_write(bs_op *op) {
+  uint32_t r = next_random();
+  op->type = (bs_op_type) (BS_OP_WRITE_U1 + r % (BS_OP_WRITE_SE - BS_OP_WRITE_U1 + 1));
+  op->n = (r >> 8) % 33;
+  op->v = next_random();
+  // keep Exp-Golomb codes within the 32 bits bs_write_u can take
+  if (op->type == BS_OP_WRITE_UE) {
+    op->v %= (r & 0x100000) ? 0xffff : 64;
+  } else if (op->type == BS_OP_WRITE_SE) {
+    op->v = (uint32_t) ((int32_t) (op->v % 0xffff) - 0x7fff);
+  }
+}
+
+int main(void) {
+  static uint8_t cur_buf[MAX_SIZE], ref_buf[MAX_SIZE];
+  static bs_op ops[MAX_OPS];
+  static bs_result cur[MAX_OPS], ref[MAX_OPS];
+
+  for (int c = 0; c < CASES; c++) {
+    int size = next_random() % (MAX_SIZE + 1);
+    int count = 1 + next_random() % MAX_OPS;
+    bool write = c & 1;
+
+    fill_buffer(ref_buf, size);
+    memcpy(cur_buf, ref_buf, size);
+    for (int i = 0; i < count; i++) {
+      if (write) {
+        random_write(&ops[i]);
+      } else {
+        random_read(&ops[i]);
+      }
+    }
+
+    bs_ops_ref(ref_buf, size, ops, count, ref);
+    bs_ops_cur(cur_buf, size, ops, count, cur);
+
+    for (int i = 0; i < count; i++) {
+      if (memcmp(&cur[i], &ref[i], sizeof(bs_result)) != 0) {
+        fprintf(stderr, "case %d op %d type %d n %d v %u: got %u @%d/%d, expected %u @%d/%d\n",
+                c, i, ops[i].type, ops[i].n, ops[i].v,
+                cur[i].value, cur[i].offset, cur[i].bits_left,
+                ref[i].value, ref[i].offset, ref[i].bits_left);
+        return 1;
+      }
+    }
+    CHECK(memcmp(cur_buf, ref_buf, size) == 0);
+  }
+
+  return 0;
+}
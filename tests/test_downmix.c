@@ -0,0 +1,99 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The 5.1 to stereo downmix: the weight of each channel, that full scale
+// input on every channel stays in range, and the vectorized kernel against
+// the scalar one on random input of every length up to a few blocks.
+
+#include "host.h"
+#include "audio/downmix.h"
+
+#include <string.h>
+
+#define MAX_FRAMES 64
+
+enum { FL, FR, C, LFE, BL, BR };
+
+static void downmix_one(const short in[6], short out[2]) {
+  short pcm[6 * 4];
+  // one frame in the middle of a vector block, the rest silent
+  memset(pcm, 0, sizeof(pcm));
+  memcpy(&pcm[6], in, 6 * sizeof(short));
+  audio_downmix(pcm, 4);
+  memcpy(out, &pcm[2], 2 * sizeof(short));
+}
+
+static void check_channel(int channel, short left, short right) {
+  short in[6] = {0}, out[2];
+  in[channel] = 16384;
+  downmix_one(in, out);
+  if (out[0] != left || out[1] != right) {
+    fprintf(stderr, "channel %d: %d %d, expected %d %d\n", channel, out[0], out[1], left, right);
+    CHECK(0);
+  }
+}
+
+static uint32_t seed = 1;
+
+static short random16() {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+int main(int argc, char **argv) {
+  // half scale on one channel gives half its weight, Q14 to Q15
+  check_channel(FL, DOWNMIX_FRONT, 0);
+  check_channel(FR, 0, DOWNMIX_FRONT);
+  check_channel(C, DOWNMIX_CENTER, DOWNMIX_CENTER);
+  check_channel(LFE, 0, 0);
+  check_channel(BL, DOWNMIX_BACK, 0);
+  check_channel(BR, 0, DOWNMIX_BACK);
+
+  // the weights of one side add up to unity, so full scale stays in range
+  CHECK(DOWNMIX_FRONT + DOWNMIX_CENTER + DOWNMIX_BACK == 1 << 14);
+  short out[2];
+  short high[6] = {32767, 32767, 32767, 32767, 32767, 32767};
+  downmix_one(high, out);
+  CHECK(out[0] == 32767 && out[1] == 32767);
+  short low[6] = {-32768, -32768, -32768, -32768, -32768, -32768};
+  downmix_one(low, out);
+  CHECK(out[0] == -32768 && out[1] == -32768);
+  // opposite channels cancel
+  short opposite[6] = {32767, -32768, 0, 0, -32768, 32767};
+  downmix_one(opposite, out);
+  CHECK(out[0] == (32767 * DOWNMIX_FRONT - 32768 * DOWNMIX_BACK + (1 << 13)) >> 14);
+  CHECK(out[1] == (-32768 * DOWNMIX_FRONT + 32767 * DOWNMIX_BACK + (1 << 13)) >> 14);
+
+  static short vector[6 * MAX_FRAMES];
+  static short scalar[6 * MAX_FRAMES];
+  for (int round = 0; round < 20000; round++) {
+    uint32_t frames = round % (MAX_FRAMES + 1);
+    for (int i = 0; i < 6 * MAX_FRAMES; i++) {
+      // every few rounds full scale only
+      vector[i] = round % 5 == 0 ? (random16() & 1 ? 32767 : -32768) : random16();
+    }
+    memcpy(scalar, vector, sizeof(scalar));
+
+    audio_downmix(vector, frames);
+    audio_downmix_scalar(scalar, frames);
+    // the downmix and the untouched rest of the buffer agree
+    CHECK(memcmp(vector, scalar, sizeof(scalar)) == 0);
+  }
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Feeds the elementary stream buffer decode units of growing size, checks
+// that it moves through the size classes once, keeps track of the largest
+// unit, passes single buffer units through untouched, rewrites the SPS in
+// place and refuses units above ES_BUFFER_MAX_SIZE.
+
+#include "host.h"
+#include "video/es_buffer.h"
+#include "sps.h"
+
+#include <string.h>
+
+static char sps_nal[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50,
+  0x05, 0xbb, 0x01, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03,
+  0x03, 0xc0, 0xf1, 0x83, 0x19, 0x60,
+};
+static char pps_nal[] = { 0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0 };
+
+static char *payload;
+
+static void fill_unit(DECODE_UNIT *unit, LENTRY *entries, int count, uint32_t picdata_length) {
+  memset(unit, 0, sizeof(*unit));
+  for (int i = 0; i < count; i++) {
+    entries[i].next = i + 1 < count ? &entries[i + 1] : NULL;
+  }
+  entries[count - 1].data = payload;
+  entries[count - 1].length = picdata_length;
+  entries[count - 1].bufferType = BUFFER_TYPE_PICDATA;
+  unit->bufferList = entries;
+  for (int i = 0; i < count; i++) {
+    unit->fullLength += entries[i].length;
+  }
+}
+
+static void test_growth(void) {
+  es_buffer buffer;
+  CHECK(es_buffer_init(&buffer));
+  CHECK(buffer.size == ES_BUFFER_MIN_SIZE);
+
+  DECODE_UNIT unit;
+  LENTRY entries[2];
+  entries[0].data = pps_nal;
+  entries[0].length = sizeof(pps_nal);
+  entries[0].bufferType = BUFFER_TYPE_PPS;
+
+  uint32_t largest = 0;
+  for (uint32_t length = 1024; length + sizeof(pps_nal) + 4 + 128 <= ES_BUFFER_MAX_SIZE; length = length * 5 / 4) {
+    fill_unit(&unit, entries, 2, length);
+    char *es = NULL;
+    uint32_t es_length = es_buffer_assemble(&buffer, &unit, &es);
+    CHECK(es_length == unit.fullLength);
+    CHECK(es == buffer.data);
+    CHECK(memcmp(es, pps_nal, sizeof(pps_nal)) == 0);
+    CHECK(memcmp(es + sizeof(pps_nal), payload, length) == 0);
+    CHECK(buffer.size >= es_length);
+    largest = unit.fullLength;
+  }
+  CHECK(buffer.high_water_mark == largest);
+  CHECK(buffer.size == ES_BUFFER_MAX_SIZE);
+  // one reallocation per size class from 128KB to 4MB
+  CHECK(buffer.reallocations == 5);
+
+  // smaller units after a large one reuse the buffer
+  fill_unit(&unit, entries, 2, 4096);
+  char *es = NULL;
+  CHECK(es_buffer_assemble(&buffer, &unit, &es) == unit.fullLength);
+  CHECK(buffer.reallocations == 5);
+
+  // a unit that doesn't fit even the largest class is refused
+  fill_unit(&unit, entries, 2, ES_BUFFER_MAX_SIZE);
+  CHECK(es_buffer_assemble(&buffer, &unit, &es) == 0);
+  CHECK(buffer.size == ES_BUFFER_MAX_SIZE);
+
+  es_buffer_free(&buffer);
+}
+
+static void test_passthrough(void) {
+  es_buffer buffer;
+  CHECK(es_buffer_init(&buffer));
+
+  DECODE_UNIT unit;
+  LENTRY entry;
+  // larger than the buffer, but passed through without a copy
+  fill_unit(&unit, &entry, 1, ES_BUFFER_MIN_SIZE * 2);
+  char *es = NULL;
+  CHECK(es_buffer_assemble(&buffer, &unit, &es) == ES_BUFFER_MIN_SIZE * 2);
+  CHECK(es == payload);
+  CHECK(buffer.units_passthrough == 1);
+  CHECK(buffer.bytes_copied == 0);
+  CHECK(buffer.reallocations == 0);
+
+  es_buffer_free(&buffer);
+}
+
+static void test_sps_rewrite(void) {
+  es_buffer buffer;
+  CHECK(es_buffer_init(&buffer));
+
+  DECODE_UNIT unit;
+  LENTRY entries[3];
+  entries[0].data = sps_nal;
+  entries[0].length = sizeof(sps_nal);
+  entries[0].bufferType = BUFFER_TYPE_SPS;
+  entries[1].data = pps_nal;
+  entries[1].length = sizeof(pps_nal);
+  entries[1].bufferType = BUFFER_TYPE_PPS;
+  fill_unit(&unit, entries, 3, 50000);
+
+  // the rewritten SPS is written straight in front of the PPS
+  char *es = NULL;
+  uint32_t length = es_buffer_assemble(&buffer, &unit, &es);
+  CHECK(length > 0);
+  uint32_t sps_length = length - sizeof(pps_nal) - 50000;
+  CHECK(memcmp(es, sps_nal, 5) == 0);
+  CHECK(memcmp(es + sps_length, pps_nal, sizeof(pps_nal)) == 0);
+  CHECK(memcmp(es + sps_length + sizeof(pps_nal), payload, 50000) == 0);
+  CHECK(buffer.units_passthrough == 0);
+
+  // the same unit again comes out identical, now from the SPS cache
+  char *first = malloc(length);
+  memcpy(first, es, length);
+  CHECK(es_buffer_assemble(&buffer, &unit, &es) == length);
+  CHECK(memcmp(es, first, length) == 0);
+  free(first);
+
+  es_buffer_free(&buffer);
+}
+
+int main(void) {
+  payload = malloc(ES_BUFFER_MAX_SIZE * 2);
+  for (uint32_t i = 0; i < ES_BUFFER_MAX_SIZE * 2; i++) {
+    payload[i] = (char) (i * 131 + (i >> 8));
+  }
+
+  gs_sps_init(1280, 720);
+  test_growth();
+  test_passthrough();
+  test_sps_rewrite();
+  gs_sps_stop();
+
+  free(payload);
+  return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks the slice header peek of frame_drop_parse, then replays frame
+// arrival traces through a simulated decoder and 60 Hz display, once with
+// newest-wins presentation alone and once with non-reference pictures
+// skipped when the decoder is behind, and reports latency and judder for
+// both.
+//
+// A trace has one frame per line: arrival time and decode time in us and
+// the kind of picture (0 non-reference, 1 reference, 2 IDR). Without an
+// argument a few built-in traces are generated.
+//
+//   test_frame_drop [trace]
+
+#include "host.h"
+#include "video/frame_drop.h"
+#include "video/frame_ring.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define VBLANK_US 16667
+#define INTERVAL_US 16667
+#define MAX_FRAMES 4096
+
+enum { PICTURE_NON_REF, PICTURE_REF, PICTURE_IDR };
+
+typedef struct {
+  uint64_t arrival_us;
+  uint32_t decode_us;
+  int kind;
+} trace_frame;
+
+typedef struct {
+  uint32_t shown;
+  uint32_t superseded;
+  uint32_t skipped;
+  double latency_mean_ms;
+  double latency_p95_ms;
+  double latency_max_ms;
+  // standard deviation of the latency of shown frames
+  double judder_ms;
+  // refreshes without a new picture while one had already arrived
+  uint32_t stalls;
+} sim_result;
+
+static trace_frame trace[MAX_FRAMES];
+static int trace_length;
+
+static uint32_t seed = 1;
+
+static uint32_t next_random(uint32_t range) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed % range;
+}
+
+// An IDR slice, a reference P slice and a non-reference P slice, each
+// behind an access unit delimiter
+static char idr_slice[] = { 0, 0, 0, 1, 0x09, 0x10, 0, 0, 0, 1, 0x65, 0x88, 0x84, 0x00, 0x33 };
+static char ref_slice[] = { 0, 0, 0, 1, 0x09, 0x30, 0, 0, 0, 1, 0x41, 0x9a, 0x02, 0x04 };
+static char non_ref_slice[] = { 0, 0, 0, 1, 0x09, 0x30, 0, 0, 0, 1, 0x01, 0x9a, 0x02, 0x04 };
+static char pps[] = { 0, 0, 0, 1, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0 };
+
+static void parse(char *picdata, int length, frame_slice_info *info) {
+  LENTRY entries[2] = {
+    { &entries[1], pps, sizeof(pps), BUFFER_TYPE_PPS },
+    { NULL, picdata, length, BUFFER_TYPE_PICDATA },
+  };
+  DECODE_UNIT unit = { 0 };
+  unit.bufferList = entries;
+  unit.fullLength = sizeof(pps) + length;
+  frame_drop_parse(&unit, info);
+}
+
+static void test_parse(void) {
+  frame_slice_info info;
+
+  parse(idr_slice, sizeof(idr_slice), &info);
+  CHECK(info.parsed && info.idr && info.reference && info.slice_type == 2);
+  CHECK(!frame_drop_skip_decode(&info, INTERVAL_US * 10, INTERVAL_US));
+
+  parse(ref_slice, sizeof(ref_slice), &info);
+  CHECK(info.parsed && !info.idr && info.reference && info.slice_type == 0);
+  CHECK(!frame_drop_skip_decode(&info, INTERVAL_US * 10, INTERVAL_US));
+
+  parse(non_ref_slice, sizeof(non_ref_slice), &info);
+  CHECK(info.parsed && !info.idr && !info.reference && info.slice_type == 0);
+  CHECK(!frame_drop_skip_decode(&info, INTERVAL_US / 2, INTERVAL_US));
+  CHECK(frame_drop_skip_decode(&info, INTERVAL_US + 1, INTERVAL_US));
+
+  // no slice in the unit, always decoded
+  parse(non_ref_slice, 6, &info);
+  CHECK(!info.parsed);
+  CHECK(!frame_drop_skip_decode(&info, INTERVAL_US * 10, INTERVAL_US));
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double*) a, y = *(const double*) b;
+  return x < y ? -1 : x > y;
+}
+
+static void simulate(bool skip_policy, sim_result *result) {
+  static uint64_t done_us[MAX_FRAMES];
+  static bool decoded[MAX_FRAMES];
+  static double latency[MAX_FRAMES];
+  memset(result, 0, sizeof(*result));
+
+  // the decoder takes one unit at a time, in order, as soon as it is free
+  uint64_t decoder_free_us = 0;
+  for (int i = 0; i < trace_length; i++) {
+    uint64_t start = trace[i].arrival_us > decoder_free_us ? trace[i].arrival_us : decoder_free_us;
+    frame_slice_info info = {
+      .parsed = true,
+      .idr = trace[i].kind == PICTURE_IDR,
+      .reference = trace[i].kind != PICTURE_NON_REF,
+    };
+    decoded[i] = !(skip_policy && frame_drop_skip_decode(&info, start - trace[i].arrival_us, INTERVAL_US));
+    if (!decoded[i]) {
+      CHECK(trace[i].kind == PICTURE_NON_REF);
+      result->skipped++;
+      done_us[i] = start;
+      continue;
+    }
+    decoder_free_us = start + trace[i].decode_us;
+    done_us[i] = decoder_free_us;
+  }
+
+  // the presenter shows the newest published frame at each vblank
+  frame_ring ring;
+  int texture_frame[FRAME_RING_SIZE];
+  frame_ring_init(&ring);
+  int next = 0;
+  uint64_t end_us = decoder_free_us + VBLANK_US;
+  for (uint64_t vblank = VBLANK_US; vblank <= end_us; vblank += VBLANK_US) {
+    for (; next < trace_length && done_us[next] <= vblank; next++) {
+      if (decoded[next]) {
+        int texture = frame_ring_acquire(&ring);
+        texture_frame[texture] = next;
+        frame_ring_publish(&ring, texture);
+      }
+    }
+
+    int texture = frame_ring_take(&ring, &result->superseded);
+    if (texture >= 0) {
+      int frame = texture_frame[texture];
+      latency[result->shown++] = (vblank - trace[frame].arrival_us) / 1000.0;
+    } else if (next < trace_length && trace[next].arrival_us <= vblank) {
+      result->stalls++;
+    }
+  }
+
+  double sum = 0, squares = 0;
+  for (uint32_t i = 0; i < result->shown; i++) {
+    sum += latency[i];
+  }
+  result->latency_mean_ms = sum / result->shown;
+  for (uint32_t i = 0; i < result->shown; i++) {
+    squares += (latency[i] - result->latency_mean_ms) * (latency[i] - result->latency_mean_ms);
+  }
+  result->judder_ms = sqrt(squares / result->shown);
+  qsort(latency, result->shown, sizeof(double), compare_double);
+  result->latency_p95_ms = latency[result->shown * 95 / 100];
+  result->latency_max_ms = latency[result->shown - 1];
+}
+
+static void print_result(const char *policy, const sim_result *r) {
+  printf("  %-12s shown %4u superseded %4u skipped %4u stalls %4u  latency mean %6.1f p95 %6.1f max %6.1f ms  judder %5.1f ms\n",
+         policy, r->shown, r->superseded, r->skipped, r->stalls,
+         r->latency_mean_ms, r->latency_p95_ms, r->latency_max_ms, r->judder_ms);
+}
+
+static void run_trace(const char *name, sim_result *newest, sim_result *skip) {
+  simulate(false, newest);
+  simulate(true, skip);
+  printf("%s\n", name);
+  print_result("newest-wins", newest);
+  print_result("skip non-ref", skip);
+}
+
+// 60 fps with a little network jitter. Every other picture is a
+// non-reference one when non_ref is set, with an IDR every gop frames.
+static void generate(int frames, uint32_t decode_min_us, uint32_t decode_max_us, bool non_ref, int stall_every) {
+  seed = 1;
+  trace_length = frames;
+  for (int i = 0; i < frames; i++) {
+    trace[i].arrival_us = (uint64_t) i * INTERVAL_US + next_random(2000);
+    trace[i].decode_us = decode_min_us + next_random(decode_max_us - decode_min_us + 1);
+    trace[i].kind = i % 300 == 0 ? PICTURE_IDR : (non_ref && i % 2) ? PICTURE_NON_REF : PICTURE_REF;
+  }
+
+  // a network stall holds back ten frames, which then arrive together
+  for (int i = stall_every; stall_every > 0 && i < frames; i += stall_every) {
+    for (int k = 0; k < 10 && i + k < frames; k++) {
+      trace[i + k].arrival_us = (uint64_t) (i + 10) * INTERVAL_US + k * 100;
+    }
+  }
+}
+
+static bool same_result(const sim_result *a, const sim_result *b) {
+  return a->shown == b->shown && a->superseded == b->superseded && a->skipped == b->skipped &&
+         a->latency_mean_ms == b->latency_mean_ms && a->judder_ms == b->judder_ms;
+}
+
+static int load_trace(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    perror(path);
+    return -1;
+  }
+  unsigned long long arrival;
+  unsigned decode;
+  int kind;
+  trace_length = 0;
+  while (trace_length < MAX_FRAMES && fscanf(f, "%llu %u %d", &arrival, &decode, &kind) == 3) {
+    trace[trace_length].arrival_us = arrival;
+    trace[trace_length].decode_us = decode;
+    trace[trace_length].kind = kind;
+    trace_length++;
+  }
+  fclose(f);
+  return trace_length > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+  sim_result newest, skip;
+
+  test_parse();
+
+  if (argc > 1) {
+    if (load_trace(argv[1]) < 0) {
+      return 1;
+    }
+    run_trace(argv[1], &newest, &skip);
+    return 0;
+  }
+
+  // nothing falls behind, both policies behave the same
+  generate(1200, 8000, 12000, true, 0);
+  run_trace("steady stream, decoder keeps up", &newest, &skip);
+  CHECK(skip.skipped == 0 && same_result(&newest, &skip));
+
+  // the backlog after a stall drains faster when non-reference pictures
+  // are skipped
+  generate(1200, 11000, 15000, true, 120);
+  run_trace("network stalls, every other picture non-reference", &newest, &skip);
+  CHECK(skip.skipped > 0);
+  CHECK(skip.latency_p95_ms < newest.latency_p95_ms);
+
+  // a decoder slower than the stream falls further behind with every frame
+  // unless it can skip
+  generate(1200, 15000, 20000, true, 0);
+  run_trace("decoder slower than the stream, every other picture non-reference", &newest, &skip);
+  CHECK(skip.latency_max_ms < newest.latency_max_ms);
+  CHECK(skip.latency_max_ms < 4 * INTERVAL_US / 1000.0);
+
+  // with only reference pictures there is nothing to skip
+  generate(1200, 11000, 15000, false, 120);
+  run_trace("network stalls, reference pictures only", &newest, &skip);
+  CHECK(skip.skipped == 0 && same_result(&newest, &skip));
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A fake decoder and presenter driving the frame ring the way the Vita
+// backend does. The decoder submits a frame every decode_us, the presenter
+// wakes up on each published frame, shows the newest one and takes
+// present_us to draw it, then waits for the next refresh. The test checks
+// that the decoder never writes into a texture that is on screen or about
+// to be, that frames are shown in order and every one is either shown or
+// superseded, and reports how long submit calls were blocked.
+
+#include "host.h"
+#include "video/frame_ring.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#define FRAMES 400
+
+typedef struct {
+  const char *name;
+  uint32_t decode_us;
+  uint32_t present_us;
+  uint32_t refresh_us;
+} scenario;
+
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_cond = PTHREAD_COND_INITIALIZER;
+static frame_ring ring;
+static bool decoder_done;
+
+// frame number written into each texture, -1 while the decoder writes it
+static volatile int texture_frame[FRAME_RING_SIZE];
+
+static const scenario *current;
+static uint64_t blocked_max_us;
+static uint64_t blocked_sum_us;
+static uint32_t presented;
+static uint32_t superseded;
+
+static void *decoder_main(void *arg) {
+  for (int n = 0; n < FRAMES; n++) {
+    uint64_t start = host_time_us();
+    pthread_mutex_lock(&ring_lock);
+    int frame = frame_ring_acquire(&ring);
+    CHECK(frame >= 0 && frame < FRAME_RING_SIZE);
+    CHECK(frame != ring.ready && frame != ring.presented);
+    pthread_mutex_unlock(&ring_lock);
+    uint64_t blocked = host_time_us() - start;
+
+    texture_frame[frame] = -1;
+    host_sleep_us(current->decode_us);
+    texture_frame[frame] = n;
+
+    start = host_time_us();
+    pthread_mutex_lock(&ring_lock);
+    frame_ring_publish(&ring, frame);
+    pthread_cond_signal(&ring_cond);
+    pthread_mutex_unlock(&ring_lock);
+    blocked += host_time_us() - start;
+
+    blocked_sum_us += blocked;
+    if (blocked > blocked_max_us) {
+      blocked_max_us = blocked;
+    }
+  }
+
+  pthread_mutex_lock(&ring_lock);
+  decoder_done = true;
+  pthread_cond_signal(&ring_cond);
+  pthread_mutex_unlock(&ring_lock);
+  return NULL;
+}
+
+static void *presenter_main(void *arg) {
+  int last = -1;
+  uint64_t next_refresh = host_time_us();
+
+  while (true) {
+    pthread_mutex_lock(&ring_lock);
+    while (ring.ready < 0 && !decoder_done) {
+      pthread_cond_wait(&ring_cond, &ring_lock);
+    }
+    int frame = frame_ring_take(&ring, &superseded);
+    pthread_mutex_unlock(&ring_lock);
+    if (frame < 0) {
+      break;
+    }
+
+    // newest wins, and the texture must hold a finished frame
+    int number = texture_frame[frame];
+    CHECK(number > last);
+    host_sleep_us(current->present_us);
+    CHECK(texture_frame[frame] == number);
+    last = number;
+    presented++;
+
+    uint64_t now = host_time_us();
+    while (next_refresh <= now) {
+      next_refresh += current->refresh_us;
+    }
+    host_sleep_us(next_refresh - now);
+  }
+  return NULL;
+}
+
+static void run(const scenario *s) {
+  current = s;
+  frame_ring_init(&ring);
+  for (int i = 0; i < FRAME_RING_SIZE; i++) {
+    texture_frame[i] = -1;
+  }
+  decoder_done = false;
+  blocked_max_us = 0;
+  blocked_sum_us = 0;
+  presented = 0;
+  superseded = 0;
+
+  pthread_t decoder, presenter;
+  pthread_create(&presenter, NULL, presenter_main, NULL);
+  pthread_create(&decoder, NULL, decoder_main, NULL);
+  pthread_join(decoder, NULL);
+  pthread_join(presenter, NULL);
+
+  printf("%s: %u frames, %u presented, %u superseded, submit blocked avg %llu us, max %llu us\n",
+         s->name, FRAMES, presented, superseded,
+         (unsigned long long) blocked_sum_us / FRAMES, (unsigned long long) blocked_max_us);
+  CHECK(presented + superseded == FRAMES);
+  CHECK(presented > 0);
+}
+
+int main(void) {
+  static const scenario scenarios[] = {
+    { "presenter keeps up", 2000, 300, 1000 },
+    { "slow present", 1000, 3000, 1000 },
+    { "decoder faster than refresh", 500, 500, 4000 },
+  };
+
+  for (int i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    run(&scenarios[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Touch traces recorded and replayed into the gesture recognizer, with
+// the recognizer configured the way the input pipeline does it. Checks
+// taps, including two finger taps that don't land together, strokes that
+// keep the motion made inside the slop, scrolls, pinches, edge swipes,
+// and that pinch steps past the event limit are counted as dropped.
+
+#include "host.h"
+#include "input/gesture.h"
+#include "input/record.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_PATH "test_gesture.rec"
+#define RATE 200
+#define PERIOD_US (1000000 / RATE)
+
+static const gesture_config config = {
+  .width = 960,
+  .height = 544,
+  .tap_us = 100000,
+  .double_tap_us = 300000,
+  .slop = 8,
+  .edge_size = 24,
+  .edge_travel = 120,
+  .edges = 1 << GESTURE_EDGE_LEFT,
+  .pinch_step = 40,
+};
+
+static FILE *recording;
+static uint64_t trace_us;
+
+static void record_start(void) {
+  recording = input_record_open(RECORD_PATH, RATE);
+  CHECK(recording);
+  trace_us = 1000000;
+}
+
+// One sample with up to two fingers, in screen coordinates. Touch panels
+// report twice the screen resolution.
+static void touch(int count, int x0, int y0, int x1, int y1) {
+  input_record_sample sample = {0};
+  sample.time_us = trace_us;
+  sample.front_count = count;
+  sample.front[0].id = 1;
+  sample.front[0].x = x0 * 2;
+  sample.front[0].y = y0 * 2;
+  sample.front[1].id = 2;
+  sample.front[1].x = x1 * 2;
+  sample.front[1].y = y1 * 2;
+  CHECK(input_record_write(recording, &sample));
+  trace_us += PERIOD_US;
+}
+
+static void hold(int samples, int count, int x0, int y0, int x1, int y1) {
+  for (int i = 0; i < samples; i++) {
+    touch(count, x0, y0, x1, y1);
+  }
+}
+
+static void lift(int samples) {
+  hold(samples, 0, 0, 0, 0, 0);
+}
+
+typedef struct {
+  int counts[GESTURE_EDGE_SWIPE + 1];
+  int tap_fingers;
+  int move_x;
+  int move_y;
+  int scroll_y;
+  gesture_edge edge;
+  uint32_t dropped;
+} summary;
+
+static void replay(summary *s) {
+  fclose(recording);
+  uint32_t rate;
+  FILE *fd = input_replay_open(RECORD_PATH, &rate);
+  CHECK(fd && rate == RATE);
+
+  gesture_recognizer g;
+  gesture_init(&g, &config);
+  memset(s, 0, sizeof(summary));
+
+  input_record_sample sample;
+  while (input_replay_read(fd, &sample)) {
+    gesture_touch touches[GESTURE_MAX_FINGERS];
+    int count = sample.front_count < GESTURE_MAX_FINGERS ? sample.front_count : GESTURE_MAX_FINGERS;
+    for (int i = 0; i < count; i++) {
+      touches[i].id = sample.front[i].id;
+      touches[i].x = sample.front[i].x / 2;
+      touches[i].y = sample.front[i].y / 2;
+    }
+
+    gesture_event events[GESTURE_MAX_EVENTS];
+    int n = gesture_update(&g, sample.time_us, touches, count, events);
+    CHECK(n >= 0 && n <= GESTURE_MAX_EVENTS);
+    for (int e = 0; e < n; e++) {
+      s->counts[events[e].type]++;
+      switch (events[e].type) {
+        case GESTURE_TAP:
+          s->tap_fingers = events[e].fingers;
+          break;
+        case GESTURE_MOVE:
+          s->move_x += events[e].dx;
+          s->move_y += events[e].dy;
+          break;
+        case GESTURE_SCROLL:
+          s->scroll_y += events[e].dy;
+          break;
+        case GESTURE_EDGE_SWIPE:
+          s->edge = events[e].edge;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  fclose(fd);
+  s->dropped = g.dropped;
+}
+
+static void test_taps(void) {
+  summary s;
+
+  // 50 ms on one spot
+  record_start();
+  hold(10, 1, 300, 300, 0, 0);
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_TAP] == 1 && s.tap_fingers == 1);
+
+  // held too long to be a tap
+  record_start();
+  hold(30, 1, 300, 300, 0, 0);
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_TAP] == 0);
+
+  // the second finger lands 80 ms after the first, both lift 70 ms later,
+  // 150 ms after the first touched
+  record_start();
+  hold(16, 1, 300, 300, 0, 0);
+  hold(14, 2, 300, 300, 400, 300);
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_TAP] == 1 && s.tap_fingers == 2);
+
+  // the same, but the second finger stays too long
+  record_start();
+  hold(16, 1, 300, 300, 0, 0);
+  hold(30, 2, 300, 300, 400, 300);
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_TAP] == 0);
+
+  // two taps 150 ms apart
+  record_start();
+  hold(10, 1, 300, 300, 0, 0);
+  lift(20);
+  hold(10, 1, 302, 301, 0, 0);
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_TAP] == 1 && s.counts[GESTURE_DOUBLE_TAP] == 1);
+}
+
+static void test_strokes(void) {
+  summary s;
+
+  // a slow stroke, half a pixel per sample, so the slop takes 16 samples
+  record_start();
+  for (int i = 0; i <= 200; i++) {
+    touch(1, 300 + i / 2, 200 + i / 4, 0, 0);
+  }
+  lift(1);
+  replay(&s);
+  printf("slow stroke: moved %d %d of 100 50\n", s.move_x, s.move_y);
+  CHECK(s.move_x == 100 && s.move_y == 50);
+  CHECK(s.counts[GESTURE_DRAG_BEGIN] == 0);
+
+  // tap, then touch again and drag, the drag keeps its full length too
+  record_start();
+  hold(10, 1, 500, 300, 0, 0);
+  lift(10);
+  for (int i = 0; i <= 60; i++) {
+    touch(1, 500 - i, 300 + i / 3, 0, 0);
+  }
+  lift(1);
+  replay(&s);
+  printf("drag: moved %d %d of -60 20\n", s.move_x, s.move_y);
+  CHECK(s.counts[GESTURE_TAP] == 1);
+  CHECK(s.counts[GESTURE_DRAG_BEGIN] == 1 && s.counts[GESTURE_DRAG_END] == 1);
+  CHECK(s.move_x == -60 && s.move_y == 20);
+
+  // two fingers sliding up together scroll by their whole travel
+  record_start();
+  for (int i = 0; i <= 90; i++) {
+    touch(2, 400, 400 - i, 480, 400 - i);
+  }
+  lift(1);
+  replay(&s);
+  printf("scroll: %d of -90\n", s.scroll_y);
+  CHECK(s.scroll_y == -90);
+  CHECK(s.counts[GESTURE_MOVE] == 0);
+}
+
+static void test_pinch_and_edges(void) {
+  summary s;
+
+  // fingers spreading from 100 to 260 px apart, four steps
+  record_start();
+  for (int i = 0; i <= 80; i++) {
+    touch(2, 400 - i, 300, 500 + i, 300);
+  }
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_PINCH_OUT] == 4 && s.counts[GESTURE_PINCH_IN] == 0);
+  CHECK(s.dropped == 0);
+
+  // a jump of six steps in one sample, four fit in the update
+  record_start();
+  hold(4, 2, 400, 300, 500, 300);
+  touch(2, 390, 300, 510, 300);
+  touch(2, 270, 300, 630, 300);
+  lift(1);
+  replay(&s);
+  printf("pinch jump: %d pinch events, %u dropped\n", s.counts[GESTURE_PINCH_OUT], s.dropped);
+  CHECK(s.counts[GESTURE_PINCH_OUT] == GESTURE_MAX_EVENTS);
+  CHECK(s.dropped == 2);
+
+  // from the left edge inwards
+  record_start();
+  for (int i = 0; i <= 40; i++) {
+    touch(1, 10 + i * 4, 272, 0, 0);
+  }
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_EDGE_SWIPE] == 1 && s.edge == GESTURE_EDGE_LEFT);
+  CHECK(s.counts[GESTURE_MOVE] == 0);
+
+  // along the edge it is ordinary motion, with all of it reported
+  record_start();
+  for (int i = 0; i <= 40; i++) {
+    touch(1, 10, 100 + i * 4, 0, 0);
+  }
+  lift(1);
+  replay(&s);
+  CHECK(s.counts[GESTURE_EDGE_SWIPE] == 0);
+  CHECK(s.move_x == 0 && s.move_y == 160);
+}
+
+int main(int argc, char **argv) {
+  test_taps();
+  test_strokes();
+  test_pinch_and_edges();
+  remove(RECORD_PATH);
+  return 0;
+}
@@ -0,0 +1,443 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Several GS contexts, each with its own key directory, talking to hosts
+// from their own threads at the same time. The hosts are a local HTTPS
+// server on the GameStream port, one loopback address per context. It
+// checks every request came with the certificate of the context its
+// unique id belongs to, and answers applist with apps named after the
+// unique id, so nothing may cross between contexts. One host refuses its
+// client, that context alone has to report the host's message.
+//
+// A context that fails to initialise has to keep the reason.
+//
+// Needs port 47984, the test is skipped when it is taken.
+
+#include "host.h"
+#include "client.h"
+#include "errors.h"
+#include "mkcert.h"
+
+#include <curl/curl.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CONTEXTS 4
+#define ROUNDS 10
+#define APPS 3
+#define GAMESTREAM_PORT 47984
+#define MAX_CONNECTIONS 256
+#define SKIP 77
+
+// the context whose host refuses it
+#define REFUSED 2
+
+static const char *refused_message = "The client is not authorized. Certificate verification failed.";
+
+// Stand-ins for the Vita SDK and moonlight-common-c, only their headers
+// are used here
+int sceIoMkdir(const char *dir, int mode) {
+  if (mkdir(dir, mode) == 0)
+    return 0;
+  return errno == EEXIST ? (int) 0x80010011 : -1;
+}
+
+void LiInitializeServerInformation(SERVER_INFORMATION *serverInfo) {
+  memset(serverInfo, 0, sizeof(*serverInfo));
+}
+
+// The key directories come with their certificates, none are generated
+CERT_KEY_PAIR mkcert_generate() {
+  CHECK(false);
+  CERT_KEY_PAIR pair = {0};
+  return pair;
+}
+
+void mkcert_save(const char* certFile, const char* p12File, const char* keyPairFile, CERT_KEY_PAIR certKeyPair) {
+  CHECK(false);
+}
+
+void mkcert_free(CERT_KEY_PAIR certKeyPair) {
+}
+
+static char key_dirs[CONTEXTS][64];
+static unsigned char fingerprints[CONTEXTS][32];
+
+static void make_identity(int i) {
+  snprintf(key_dirs[i], sizeof(key_dirs[i]), "/tmp/test_gs_contexts.XXXXXX");
+  CHECK(mkdtemp(key_dirs[i]));
+
+  EVP_PKEY *key = EVP_EC_gen("P-256");
+  CHECK(key);
+  X509 *cert = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), i + 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME *name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *) "NVIDIA GameStream Client", -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  CHECK(X509_sign(cert, key, EVP_sha256()));
+  unsigned int length = sizeof(fingerprints[i]);
+  CHECK(X509_digest(cert, EVP_sha256(), fingerprints[i], &length));
+
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", key_dirs[i], CERTIFICATE_FILE_NAME);
+  FILE *fd = fopen(path, "w");
+  CHECK(fd && PEM_write_X509(fd, cert));
+  fclose(fd);
+  snprintf(path, sizeof(path), "%s/%s", key_dirs[i], KEY_FILE_NAME);
+  fd = fopen(path, "w");
+  CHECK(fd && PEM_write_PrivateKey(fd, key, NULL, NULL, 0, NULL, NULL));
+  fclose(fd);
+
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+
+static void remove_dir(const char *dir) {
+  static const char *const files[] = {CERTIFICATE_FILE_NAME, KEY_FILE_NAME, "uniqueid.dat"};
+  for (size_t i = 0; i < sizeof(files) / sizeof(*files); i++) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+    remove(path);
+  }
+  rmdir(dir);
+}
+
+static GS_CONTEXT contexts[CONTEXTS];
+
+// The host side
+static SSL_CTX *server_ctx;
+static int listen_fd;
+static volatile bool server_running;
+static pthread_t server_thread;
+static pthread_t connection_threads[MAX_CONNECTIONS];
+static int connection_count;
+
+static pthread_mutex_t counts_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t requests;
+static uint32_t wrong_identity;
+static uint32_t busiest_connections;
+static uint32_t open_connections;
+
+static int context_of(const char *unique_id) {
+  for (int i = 0; i < CONTEXTS; i++) {
+    if (strcmp(contexts[i].unique_id, unique_id) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static int accept_any(int ok, X509_STORE_CTX *store) {
+  return 1;
+}
+
+static bool read_request(SSL *ssl, char *request, size_t size) {
+  size_t length = 0;
+  while (length < size - 1) {
+    int n = SSL_read(ssl, request + length, size - 1 - length);
+    if (n <= 0)
+      return false;
+    length += n;
+    request[length] = 0;
+    if (strstr(request, "\r\n\r\n"))
+      return true;
+  }
+  return false;
+}
+
+static void reply(SSL *ssl, const char *body) {
+  char header[128];
+  int length = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n", strlen(body));
+  SSL_write(ssl, header, length);
+  SSL_write(ssl, body, strlen(body));
+}
+
+static void answer(SSL *ssl, const char *request, int context) {
+  char body[2048];
+  if (strncmp(request, "GET /serverinfo", 15) == 0) {
+    snprintf(body, sizeof(body),
+             "<root status_code=\"200\"><appversion>7.1.431.0</appversion><GfeVersion>3.23.0.74</GfeVersion>"
+             "<PairStatus>1</PairStatus><currentgame>0</currentgame><state>SUNSHINE_SERVER_FREE</state>"
+             "<gputype>GPU %d</gputype><GsVersion>7.1.431.0</GsVersion><SupportedDisplayMode><DisplayMode>"
+             "<Width>1280</Width><Height>720</Height><RefreshRate>60</RefreshRate></DisplayMode>"
+             "</SupportedDisplayMode></root>", context);
+  } else if (strncmp(request, "GET /applist", 12) == 0 && context == REFUSED) {
+    snprintf(body, sizeof(body), "<root status_code=\"401\" status_message=\"%s\"/>", refused_message);
+  } else if (strncmp(request, "GET /applist", 12) == 0) {
+    char *p = body;
+    p += sprintf(p, "<root status_code=\"200\">");
+    for (int i = 0; i < APPS; i++) {
+      p += sprintf(p, "<App><AppTitle>App %d of %s</AppTitle><ID>%d</ID></App>", i, contexts[context].unique_id, i);
+    }
+    sprintf(p, "</root>");
+  } else {
+    snprintf(body, sizeof(body), "<root status_code=\"404\" status_message=\"Not found\"/>");
+  }
+  reply(ssl, body);
+}
+
+static void *connection_main(void *arg) {
+  int fd = (int) (intptr_t) arg;
+  SSL *ssl = SSL_new(server_ctx);
+  SSL_set_fd(ssl, fd);
+  if (SSL_accept(ssl) != 1) {
+    SSL_free(ssl);
+    close(fd);
+    return NULL;
+  }
+
+  pthread_mutex_lock(&counts_lock);
+  if (++open_connections > busiest_connections)
+    busiest_connections = open_connections;
+  pthread_mutex_unlock(&counts_lock);
+
+  unsigned char fingerprint[32];
+  unsigned int length = 0;
+  X509 *peer = SSL_get1_peer_certificate(ssl);
+  if (peer != NULL) {
+    length = sizeof(fingerprint);
+    X509_digest(peer, EVP_sha256(), fingerprint, &length);
+    X509_free(peer);
+  }
+
+  char request[4096];
+  while (read_request(ssl, request, sizeof(request))) {
+    char unique_id[UNIQUEID_CHARS + 1] = {0};
+    const char *param = strstr(request, "uniqueid=");
+    if (param != NULL)
+      sscanf(param + 9, "%16[0-9a-f]", unique_id);
+
+    int context = context_of(unique_id);
+    pthread_mutex_lock(&counts_lock);
+    requests++;
+    if (context < 0 || length != sizeof(fingerprint) || memcmp(fingerprint, fingerprints[context], length) != 0)
+      wrong_identity++;
+    pthread_mutex_unlock(&counts_lock);
+
+    answer(ssl, request, context);
+  }
+
+  pthread_mutex_lock(&counts_lock);
+  open_connections--;
+  pthread_mutex_unlock(&counts_lock);
+  SSL_shutdown(ssl);
+  SSL_free(ssl);
+  close(fd);
+  return NULL;
+}
+
+static void *server_main(void *arg) {
+  while (server_running) {
+    struct pollfd pfd = { listen_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 20) <= 0)
+      continue;
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+      continue;
+    CHECK(connection_count < MAX_CONNECTIONS);
+    CHECK(pthread_create(&connection_threads[connection_count++], NULL, connection_main, (void *) (intptr_t) fd) == 0);
+  }
+  return NULL;
+}
+
+static bool server_start(void) {
+  EVP_PKEY *key = EVP_EC_gen("P-256");
+  CHECK(key);
+  X509 *cert = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME *name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *) "NVIDIA GameStream Server", -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  CHECK(X509_sign(cert, key, EVP_sha256()));
+
+  server_ctx = SSL_CTX_new(TLS_server_method());
+  CHECK(server_ctx);
+  CHECK(SSL_CTX_use_certificate(server_ctx, cert) == 1);
+  CHECK(SSL_CTX_use_PrivateKey(server_ctx, key) == 1);
+  // GameStream hosts ask for the client certificate, any will do here
+  SSL_CTX_set_verify(server_ctx, SSL_VERIFY_PEER, accept_any);
+  X509_free(cert);
+  EVP_PKEY_free(key);
+
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(listen_fd >= 0);
+  int on = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(GAMESTREAM_PORT);
+  if (bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+    close(listen_fd);
+    SSL_CTX_free(server_ctx);
+    return false;
+  }
+
+  server_running = true;
+  CHECK(pthread_create(&server_thread, NULL, server_main, NULL) == 0);
+  return true;
+}
+
+static void server_stop(void) {
+  server_running = false;
+  pthread_join(server_thread, NULL);
+  close(listen_fd);
+  for (int i = 0; i < connection_count; i++) {
+    pthread_join(connection_threads[i], NULL);
+  }
+  SSL_CTX_free(server_ctx);
+}
+
+// The client side, one thread per context
+static int failures[CONTEXTS];
+
+static void *client_main(void *arg) {
+  int i = (int) (intptr_t) arg;
+  PGS_CONTEXT ctx = &contexts[i];
+  char address[32];
+  snprintf(address, sizeof(address), "127.0.0.%d", i + 1);
+
+  for (int round = 0; round < ROUNDS; round++) {
+    SERVER_DATA server;
+    if (gs_init_context(ctx, &server, address, false) != GS_OK || !server.paired ||
+        server.serverMajorVersion != 7 || server.modes == NULL || server.modes->width != 1280) {
+      failures[i]++;
+      continue;
+    }
+    char gpu[32];
+    snprintf(gpu, sizeof(gpu), "GPU %d", i);
+    if (strcmp(server.gpuType, gpu) != 0)
+      failures[i]++;
+
+    PAPP_LIST list = NULL;
+    int ret = gs_applist(&server, &list);
+    if (i == REFUSED) {
+      if (ret != GS_ERROR || ctx->error != ctx->message || strcmp(ctx->message, refused_message) != 0)
+        failures[i]++;
+      continue;
+    }
+
+    int apps = 0;
+    if (ret != GS_OK)
+      failures[i]++;
+    while (list != NULL) {
+      char title[64];
+      snprintf(title, sizeof(title), "App %d of %s", list->id, ctx->unique_id);
+      if (strcmp(list->name, title) != 0)
+        failures[i]++;
+      apps++;
+      PAPP_LIST next = list->next;
+      free(list->name);
+      free(list);
+      list = next;
+    }
+    if (ret == GS_OK && apps != APPS)
+      failures[i]++;
+  }
+  return NULL;
+}
+
+static void test_failed_init(void) {
+  GS_CONTEXT ctx;
+
+  // a certificate that doesn't parse
+  char dir[] = "/tmp/test_gs_contexts.XXXXXX";
+  CHECK(mkdtemp(dir));
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", dir, CERTIFICATE_FILE_NAME);
+  FILE *fd = fopen(path, "w");
+  CHECK(fd);
+  fputs("not a certificate\n", fd);
+  fclose(fd);
+  CHECK(gs_context_init(&ctx, dir, 0) == GS_FAILED);
+  CHECK(ctx.error != NULL && strcmp(ctx.error, "Error loading cert into memory") == 0);
+  CHECK(ctx.http == NULL && ctx.cert == NULL);
+  remove_dir(dir);
+
+  // a key directory that can't be created
+  CHECK(gs_context_init(&ctx, "/dev/null/keys", 0) == GS_FAILED);
+  CHECK(ctx.error != NULL && strcmp(ctx.error, "Can't save unique id") == 0);
+}
+
+int main(int argc, char **argv) {
+  signal(SIGPIPE, SIG_IGN);
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  test_failed_init();
+
+  if (!server_start()) {
+    printf("port %d is taken, skipped\n", GAMESTREAM_PORT);
+    curl_global_cleanup();
+    return SKIP;
+  }
+
+  for (int i = 0; i < CONTEXTS; i++) {
+    make_identity(i);
+    CHECK(gs_context_init(&contexts[i], key_dirs[i], 0) == GS_OK);
+    for (int j = 0; j < i; j++) {
+      CHECK(strcmp(contexts[i].unique_id, contexts[j].unique_id) != 0);
+    }
+  }
+
+  pthread_t threads[CONTEXTS];
+  for (int i = 0; i < CONTEXTS; i++) {
+    CHECK(pthread_create(&threads[i], NULL, client_main, (void *) (intptr_t) i) == 0);
+  }
+  for (int i = 0; i < CONTEXTS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  for (int i = 0; i < CONTEXTS; i++) {
+    printf("context %d: %d of %d rounds failed, error %s\n", i, failures[i], ROUNDS,
+           contexts[i].error ? contexts[i].error : "none");
+    CHECK(failures[i] == 0);
+    if (i != REFUSED)
+      CHECK(contexts[i].error == NULL);
+    gs_context_cleanup(&contexts[i]);
+  }
+
+  server_stop();
+  printf("%u requests on %d connections, up to %u at once, %u with the wrong certificate\n",
+         requests, connection_count, busiest_connections, wrong_identity);
+  CHECK(requests == CONTEXTS * ROUNDS * 2);
+  CHECK(wrong_identity == 0);
+  // one kept-alive connection per context
+  CHECK(connection_count == CONTEXTS);
+
+  for (int i = 0; i < CONTEXTS; i++) {
+    remove_dir(key_dirs[i]);
+  }
+  curl_global_cleanup();
+  return 0;
+}
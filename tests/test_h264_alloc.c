@@ -0,0 +1,116 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Counts heap allocations while NAL units are parsed and written the way
+// the video thread does it, with caller-supplied RBSP scratch buffers. After
+// the first pass, which sizes the slice data buffer, parsing an SPS, PPS and
+// IDR slice and rewriting the SPS must not allocate at all. Built with
+// --wrap for malloc, calloc and realloc.
+
+#include "host.h"
+#include "h264_stream.h"
+
+#include <string.h>
+
+#define ROUNDS 1000
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static int allocations;
+
+void *__wrap_malloc(size_t size) {
+  allocations++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  allocations++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  allocations++;
+  return __real_realloc(ptr, size);
+}
+
+// NAL units without start codes, as gs_sps_fix hands them to the library
+static uint8_t sps[] = {
+  0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10,
+  0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xc0, 0xf1, 0x83,
+  0x19, 0x60,
+};
+static uint8_t pps[] = { 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0 };
+static uint8_t slice[4096];
+static int slice_length;
+
+static uint8_t rbsp[sizeof(slice)];
+static uint8_t out[sizeof(slice)];
+
+// an IDR slice header written by the library itself, followed by payload
+static void build_slice(h264_stream_t *h) {
+  CHECK(read_nal_unit_buf(h, sps, sizeof(sps), rbsp, sizeof(rbsp)) > 0);
+  CHECK(read_nal_unit_buf(h, pps, sizeof(pps), rbsp, sizeof(rbsp)) > 0);
+
+  h->nal->nal_ref_idc = 3;
+  h->nal->nal_unit_type = NAL_UNIT_TYPE_CODED_SLICE_IDR;
+  memset(h->sh, 0, sizeof(slice_header_t));
+  h->sh->slice_type = SH_SLICE_TYPE_I_ONLY;
+  h->sh->slice_qp_delta = -4;
+  h->slice_data->rbsp_size = 0;
+  int header_length = write_nal_unit_buf(h, slice, 64, rbsp, sizeof(rbsp));
+  CHECK(header_length > 0);
+
+  slice_length = header_length;
+  for (int i = slice_length; i < (int) sizeof(slice); i++) {
+    slice[i] = (uint8_t) (i * 37 + 11) | 0x10;
+  }
+  slice_length = sizeof(slice);
+}
+
+static void parse_access_unit(h264_stream_t *h) {
+  CHECK(read_nal_unit_buf(h, sps, sizeof(sps), rbsp, sizeof(rbsp)) > 0);
+  CHECK(h->sps->profile_idc == 100);
+  CHECK(read_nal_unit_buf(h, pps, sizeof(pps), rbsp, sizeof(rbsp)) > 0);
+  CHECK(peek_nal_unit(h, slice, slice_length) == NAL_UNIT_TYPE_CODED_SLICE_IDR);
+  CHECK(read_nal_unit_buf(h, slice, slice_length, rbsp, sizeof(rbsp)) > 0);
+  CHECK(h->sh->slice_type == SH_SLICE_TYPE_I_ONLY && h->sh->slice_qp_delta == -4);
+
+  // the SPS rewrite in gs_sps_fix
+  CHECK(read_nal_unit_buf(h, sps, sizeof(sps), rbsp, sizeof(rbsp)) > 0);
+  h->sps->num_ref_frames = 1;
+  CHECK(write_nal_unit_buf(h, out, 128, rbsp, sizeof(rbsp)) > 0);
+}
+
+int main(void) {
+  h264_stream_t *h = h264_new();
+  // make sure the wrappers are in place
+  CHECK(allocations > 0);
+  build_slice(h);
+  parse_access_unit(h);
+
+  allocations = 0;
+  for (int i = 0; i < ROUNDS; i++) {
+    parse_access_unit(h);
+  }
+  printf("%d heap allocations in %d access units\n", allocations, ROUNDS);
+  CHECK(allocations == 0);
+
+  h264_free(h);
+  return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Differential fuzz of find_nal_unit, nal_to_rbsp and rbsp_to_nal against
+// the byte at a time versions they replaced. Built once for each scanner
+// the host can run (scalar, SSE2, AVX2). The buffers are heavy in the bytes
+// that matter, 0x00 to 0x03, mixed with long zero free runs that the
+// scanners skip in blocks, at every alignment.
+
+#include "host.h"
+#include "h264_stream.h"
+#include "ref/h264_nal_ref.h"
+
+#include <string.h>
+
+#define CASES 200000
+#define MAX_SIZE 2048
+// the old find_nal_unit reads a few bytes past size on short buffers
+#define PADDING 8
+
+static uint32_t seed = 2463534242u;
+
+static uint32_t next_random(void) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+static void fill_buffer(uint8_t *buf, int size) {
+  int i = 0;
+  while (i < size) {
+    uint32_t r = next_random();
+    if ((r & 3) == 0) {
+      // a zero free run, sometimes long enough for several blocks
+      int run = (r >> 2) % ((r & 4) ? 200 : 20);
+      for (int k = 0; k < run && i < size; k++, i++) {
+        buf[i] = (uint8_t) (next_random() % 255 + 1);
+      }
+    } else {
+      static const uint8_t special[] = { 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x03, 0x04, 0xff };
+      buf[i++] = special[(r >> 2) % sizeof(special)];
+    }
+  }
+  memset(buf + size, 0xff, PADDING);
+}
+
+static void check_find(uint8_t *buf, int size) {
+  int cur_start = -1, cur_end = -1, ref_start = -1, ref_end = -1;
+  int cur = find_nal_unit(buf, size, &cur_start, &cur_end);
+  int ref = ref_find_nal_unit(buf, size, &ref_start, &ref_end);
+  CHECK(cur == ref);
+  CHECK(cur_start == ref_start && cur_end == ref_end);
+}
+
+static void check_nal_to_rbsp(const uint8_t *buf, int size, int capacity) {
+  static uint8_t cur_out[MAX_SIZE], ref_out[MAX_SIZE];
+  int cur_nal_size = size, ref_nal_size = size;
+  int cur_rbsp_size = capacity, ref_rbsp_size = capacity;
+  int cur = nal_to_rbsp(buf, &cur_nal_size, cur_out, &cur_rbsp_size);
+  int ref = ref_nal_to_rbsp(buf, &ref_nal_size, ref_out, &ref_rbsp_size);
+  CHECK(cur == ref);
+  CHECK(cur_nal_size == ref_nal_size && cur_rbsp_size == ref_rbsp_size);
+  if (ref >= 0) {
+    CHECK(memcmp(cur_out, ref_out, ref) == 0);
+  }
+}
+
+static void check_rbsp_to_nal(const uint8_t *buf, int size, int capacity) {
+  static uint8_t cur_out[MAX_SIZE * 2], ref_out[MAX_SIZE * 2];
+  int cur_nal_size = capacity, ref_nal_size = capacity;
+  int cur = rbsp_to_nal(buf, &size, cur_out, &cur_nal_size);
+  int ref = ref_rbsp_to_nal(buf, &size, ref_out, &ref_nal_size);
+  CHECK(cur == ref);
+  CHECK(cur_nal_size == ref_nal_size);
+  if (ref >= 0) {
+    CHECK(memcmp(cur_out, ref_out, ref) == 0);
+  }
+}
+
+int main(void) {
+#if defined(__AVX2__)
+  if (!__builtin_cpu_supports("avx2")) {
+    printf("no AVX2 on this CPU\n");
+    return 77;
+  }
+#endif
+
+  // one extra block so every alignment can be tried
+  static uint8_t storage[64 + MAX_SIZE + PADDING];
+
+  for (int c = 0; c < CASES; c++) {
+    int size = next_random() % ((c & 7) ? 128 : MAX_SIZE);
+    uint8_t *buf = storage + next_random() % 64;
+    fill_buffer(buf, size);
+
+    check_find(buf, size);
+
+    // room for the whole output, or cut somewhere inside it
+    int capacity = (c & 1) ? size : (int) (next_random() % (size + 1));
+    check_nal_to_rbsp(buf, size, capacity);
+    capacity = (c & 2) ? size * 2 : (int) (next_random() % (size * 4 / 3 + 2));
+    check_rbsp_to_nal(buf, size, capacity);
+  }
+
+  return 0;
+}
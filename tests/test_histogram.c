@@ -0,0 +1,99 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Percentiles of the fixed bucket histogram against the exact ones of the
+// same samples, the overflow bucket, and the cost of adding a sample.
+
+#include "host.h"
+#include "histogram.h"
+
+#include <string.h>
+
+#define SAMPLES 100000
+
+static uint32_t values[SAMPLES];
+
+static int compare_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+  return x < y ? -1 : x > y;
+}
+
+static void test_empty(void) {
+  histogram h;
+  histogram_init(&h, "empty", 100);
+  CHECK(histogram_percentile(&h, 50) == 0);
+  histogram_log(&h);
+}
+
+static void test_percentiles(void) {
+  histogram h;
+  histogram_init(&h, "test", 250);
+
+  uint32_t seed = 7;
+  for (int i = 0; i < SAMPLES; i++) {
+    seed = seed * 1103515245 + 12345;
+    // mostly a few ms, with a tail past the last bucket
+    values[i] = (seed >> 8) % 16000 + ((seed >> 4) % 50 == 0 ? 20000 : 0);
+    histogram_add(&h, values[i]);
+  }
+  CHECK(h.count == SAMPLES);
+
+  qsort(values, SAMPLES, sizeof(uint32_t), compare_u32);
+  CHECK(h.max_us == values[SAMPLES - 1]);
+
+  // the reported value is the upper bound of the bucket the exact
+  // percentile falls into
+  static const uint32_t percents[] = { 1, 50, 90, 95 };
+  for (int i = 0; i < 4; i++) {
+    uint32_t exact = values[(SAMPLES * percents[i] + 99) / 100 - 1];
+    uint32_t reported = histogram_percentile(&h, percents[i]);
+    CHECK(reported > exact && reported <= exact + h.bucket_us);
+  }
+
+  // p99 falls into the overflow bucket, which reports the largest sample
+  CHECK(histogram_percentile(&h, 99) == h.max_us);
+  CHECK(h.buckets[HISTOGRAM_BUCKETS - 1] > 0);
+
+  uint64_t sum = 0;
+  for (int i = 0; i < SAMPLES; i++) {
+    sum += values[i];
+  }
+  CHECK(h.sum_us == sum);
+
+  // every bucket in use, the log wraps its bucket lines
+  histogram_log(&h);
+}
+
+static void test_cost(void) {
+  histogram h;
+  histogram_init(&h, "cost", 500);
+
+  uint64_t start = host_time_ns();
+  for (int i = 0; i < SAMPLES * 10; i++) {
+    histogram_add(&h, (uint32_t) i * 37 % 40000);
+  }
+  uint64_t ns = host_time_ns() - start;
+  printf("histogram_add: %.1f ns/sample\n", (double) ns / (SAMPLES * 10));
+  CHECK(h.count == SAMPLES * 10);
+}
+
+int main(void) {
+  test_empty();
+  test_percentiles();
+  test_cost();
+  return 0;
+}
@@ -0,0 +1,347 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The HTTP client against a local HTTPS server standing in for the host.
+// The server counts TLS handshakes, how many of them resumed a session,
+// and the requests it answered, for the requests of a connect (serverinfo,
+// applist, launch) and of a pairing.
+//
+// The server can keep connections alive, close them after each reply the
+// way some hosts do, refuse resumed sessions, or drop a request without
+// answering. Requests have to succeed with as few handshakes as the server
+// allows, and a dropped request must not be sent again by the client.
+
+#include "host.h"
+#include "errors.h"
+#include "http.h"
+
+#include <curl/curl.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+enum {
+  // one connection for as long as the client keeps it
+  SERVER_KEEP_ALIVE,
+  // Connection: close after every reply
+  SERVER_CLOSE,
+  // closes after every reply without saying so
+  SERVER_CLOSE_SILENTLY,
+  // like SERVER_CLOSE, and fails handshakes that try to resume a session
+  SERVER_NO_RESUME,
+  // closes without a reply to the request for /drop
+  SERVER_DROP,
+};
+
+static SSL_CTX *server_ctx;
+static int listen_fd;
+static int port;
+static int mode;
+static volatile bool server_running;
+static pthread_t server_thread;
+
+// written by the server thread, read once it is idle between requests
+static volatile uint32_t handshakes;
+static volatile uint32_t resumed;
+static volatile uint32_t failed_handshakes;
+static volatile uint32_t requests;
+static volatile uint32_t drops;
+
+static bool offers_psk(SSL *ssl) {
+  const unsigned char *data;
+  size_t length;
+  // pre_shared_key, which TLS 1.3 resumes sessions with
+  return SSL_client_hello_get0_ext(ssl, 41, &data, &length) == 1;
+}
+
+static int client_hello(SSL *ssl, int *alert, void *arg) {
+  if (mode == SERVER_NO_RESUME && offers_psk(ssl)) {
+    *alert = SSL_AD_HANDSHAKE_FAILURE;
+    return SSL_CLIENT_HELLO_ERROR;
+  }
+  return SSL_CLIENT_HELLO_SUCCESS;
+}
+
+// Reads one request up to the end of its headers, false when the client
+// closed the connection
+static bool read_request(SSL *ssl, char *request, size_t size) {
+  size_t length = 0;
+  while (length < size - 1) {
+    int n = SSL_read(ssl, request + length, size - 1 - length);
+    if (n <= 0) {
+      return false;
+    }
+    length += n;
+    request[length] = 0;
+    if (strstr(request, "\r\n\r\n")) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void serve(int fd) {
+  SSL *ssl = SSL_new(server_ctx);
+  SSL_set_fd(ssl, fd);
+  if (SSL_accept(ssl) != 1) {
+    failed_handshakes++;
+    SSL_free(ssl);
+    close(fd);
+    return;
+  }
+  handshakes++;
+  if (SSL_session_reused(ssl)) {
+    resumed++;
+  }
+
+  char request[4096];
+  while (read_request(ssl, request, sizeof(request))) {
+    requests++;
+    if (mode == SERVER_DROP && strncmp(request, "GET /drop", 9) == 0) {
+      drops++;
+      break;
+    }
+
+    bool close_after = mode != SERVER_KEEP_ALIVE && mode != SERVER_DROP;
+    static const char body[] = "<root status_code=\"200\"><state>SERVER_STATE_FREE</state></root>";
+    char reply[512];
+    int length = snprintf(reply, sizeof(reply),
+                          "HTTP/1.1 200 OK\r\nContent-Type: application/xml\r\nContent-Length: %zu\r\n%s\r\n%s",
+                          sizeof(body) - 1,
+                          close_after && mode != SERVER_CLOSE_SILENTLY ? "Connection: close\r\n" : "", body);
+    if (SSL_write(ssl, reply, length) != length || close_after) {
+      break;
+    }
+  }
+  SSL_shutdown(ssl);
+  SSL_free(ssl);
+  close(fd);
+}
+
+static void *server_main(void *arg) {
+  while (server_running) {
+    struct pollfd pfd = { listen_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 20) <= 0) {
+      continue;
+    }
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd >= 0) {
+      serve(fd);
+    }
+  }
+  return NULL;
+}
+
+static void server_start(int server_mode) {
+  mode = server_mode;
+  handshakes = resumed = failed_handshakes = requests = drops = 0;
+  // a new session cache, so nothing resumes across scenarios
+  SSL_CTX_flush_sessions(server_ctx, 0);
+  server_running = true;
+  CHECK(pthread_create(&server_thread, NULL, server_main, NULL) == 0);
+}
+
+static void server_stop(void) {
+  server_running = false;
+  pthread_join(server_thread, NULL);
+}
+
+// A throwaway certificate for the server, also used as the client's
+static void make_identity(const char *key_dir) {
+  EVP_PKEY *key = EVP_EC_gen("P-256");
+  CHECK(key);
+  X509 *cert = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  X509_NAME *name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *) "NVIDIA GameStream Server", -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  CHECK(X509_sign(cert, key, EVP_sha256()));
+
+  server_ctx = SSL_CTX_new(TLS_server_method());
+  CHECK(server_ctx);
+  CHECK(SSL_CTX_use_certificate(server_ctx, cert) == 1);
+  CHECK(SSL_CTX_use_PrivateKey(server_ctx, key) == 1);
+  SSL_CTX_set_session_cache_mode(server_ctx, SSL_SESS_CACHE_SERVER);
+  SSL_CTX_set_client_hello_cb(server_ctx, client_hello, NULL);
+
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", key_dir, CERTIFICATE_FILE_NAME);
+  FILE *fd = fopen(path, "w");
+  CHECK(fd && PEM_write_X509(fd, cert));
+  fclose(fd);
+  snprintf(path, sizeof(path), "%s/%s", key_dir, KEY_FILE_NAME);
+  fd = fopen(path, "w");
+  CHECK(fd && PEM_write_PrivateKey(fd, key, NULL, NULL, 0, NULL, NULL));
+  fclose(fd);
+
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+
+static void listen_local(void) {
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(listen_fd >= 0);
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  CHECK(bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+  CHECK(listen(listen_fd, 8) == 0);
+  socklen_t length = sizeof(addr);
+  CHECK(getsockname(listen_fd, (struct sockaddr *) &addr, &length) == 0);
+  port = ntohs(addr.sin_port);
+}
+
+static const char *key_dir;
+static const char *error;
+
+static const char *const connect_flow[] = {"serverinfo", "applist", "launch"};
+static const char *const pair_flow[] = {"pair?phrase=getservercert", "pair?clientchallenge",
+                                        "pair?serverchallengeresp", "pair?clientpairingsecret",
+                                        "pair?phrase=pairchallenge"};
+
+// Runs the requests of a flow on one client, returns how many succeeded
+static int run_flow(PHTTP_CLIENT http, const char *const *paths, int count) {
+  int ok = 0;
+  for (int i = 0; i < count; i++) {
+    char url[256];
+    snprintf(url, sizeof(url), "https://127.0.0.1:%d/%s", port, paths[i]);
+    PHTTP_DATA data = http_create_data();
+    CHECK(data);
+    if (http_request(http, url, data) == GS_OK) {
+      CHECK(strstr(data->memory, "SERVER_STATE_FREE"));
+      ok++;
+    }
+    http_free_data(data);
+  }
+  return ok;
+}
+
+static void report(const char *scenario, const char *flow, int count) {
+  printf("%-16s %-8s %d requests: %u handshakes, %u resumed, %u failed, %u served\n",
+         scenario, flow, count, handshakes, resumed, failed_handshakes, requests);
+}
+
+static void scenario(const char *name, int server_mode) {
+  server_start(server_mode);
+  PHTTP_CLIENT http = http_create(key_dir, 0, &error);
+  CHECK(http);
+
+  int connect_count = sizeof(connect_flow) / sizeof(*connect_flow);
+  int pair_count = sizeof(pair_flow) / sizeof(*pair_flow);
+
+  CHECK(run_flow(http, connect_flow, connect_count) == connect_count);
+  report(name, "connect", connect_count);
+  uint32_t connect_handshakes = handshakes;
+  uint32_t connect_resumed = resumed;
+  uint32_t connect_failed = failed_handshakes;
+  CHECK(requests == (uint32_t) connect_count);
+
+  handshakes = resumed = failed_handshakes = requests = 0;
+  CHECK(run_flow(http, pair_flow, pair_count) == pair_count);
+  report(name, "pair", pair_count);
+  CHECK(requests == (uint32_t) pair_count);
+
+  switch (server_mode) {
+    case SERVER_KEEP_ALIVE:
+      // one handshake for the whole connect, the pairing reuses it
+      CHECK(connect_handshakes == 1 && handshakes == 0);
+      break;
+    case SERVER_CLOSE:
+    case SERVER_CLOSE_SILENTLY:
+      // a handshake per request, all but the very first one resumed
+      CHECK(connect_handshakes == (uint32_t) connect_count && connect_resumed == connect_handshakes - 1);
+      CHECK(handshakes == (uint32_t) pair_count && resumed == handshakes);
+      break;
+    case SERVER_NO_RESUME:
+      // one refused resumption, then full handshakes without a session
+      CHECK(connect_failed == 1 && failed_handshakes == 0);
+      CHECK(connect_resumed == 0 && resumed == 0);
+      CHECK(connect_handshakes == (uint32_t) connect_count && handshakes == (uint32_t) pair_count);
+      break;
+  }
+
+  http_destroy(http);
+  server_stop();
+}
+
+// A request the host dropped without replying may have run on the host,
+// the client fails it instead of sending it again
+static void test_drop(void) {
+  server_start(SERVER_DROP);
+  PHTTP_CLIENT http = http_create(key_dir, 0, &error);
+  CHECK(http);
+
+  // on a new connection it is sent exactly once
+  static const char *const first[] = {"drop"};
+  CHECK(run_flow(http, first, 1) == 0);
+  printf("%-16s %-8s 1 request: %u sent\n", "dropped reply", "new", drops);
+  CHECK(drops == 1);
+
+  // on a kept-alive connection libcurl itself reconnects once when the
+  // connection closes without any reply, nothing on top of that
+  drops = 0;
+  static const char *const second[] = {"serverinfo", "drop", "serverinfo"};
+  int ok = run_flow(http, second, 3);
+  printf("%-16s %-8s 3 requests: %d succeeded, dropped one sent %u times\n",
+         "dropped reply", "reused", ok, drops);
+  CHECK(ok == 2);
+  CHECK(drops >= 1 && drops <= 2);
+
+  http_destroy(http);
+  server_stop();
+}
+
+int main(int argc, char **argv) {
+  signal(SIGPIPE, SIG_IGN);
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  char dir[] = "/tmp/test_http_reuse.XXXXXX";
+  key_dir = mkdtemp(dir);
+  CHECK(key_dir);
+  make_identity(key_dir);
+  listen_local();
+
+  scenario("keep-alive", SERVER_KEEP_ALIVE);
+  scenario("close", SERVER_CLOSE);
+  scenario("close silently", SERVER_CLOSE_SILENTLY);
+  scenario("no resumption", SERVER_NO_RESUME);
+  test_drop();
+
+  close(listen_fd);
+  SSL_CTX_free(server_ctx);
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", key_dir, CERTIFICATE_FILE_NAME);
+  remove(path);
+  snprintf(path, sizeof(path), "%s/%s", key_dir, KEY_FILE_NAME);
+  remove(path);
+  rmdir(key_dir);
+  curl_global_cleanup();
+  return 0;
+}
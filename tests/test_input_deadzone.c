@@ -0,0 +1,195 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Reports how many controller events the stick deadzones save over a
+// recorded session, replayed without a deadzone, with the default one and
+// with a wider one.
+//
+// Without arguments the session is a synthetic two minutes of play:
+// thumbs resting near the centre with sensor noise, pushes to the edge,
+// circles on the right stick and the odd button. Every stick change while
+// resting has to be suppressed, and the pushes still have to reach full
+// scale. A recording taken on the Vita can be reported on instead:
+//
+//   test_input_deadzone input.rec
+
+#include "host.h"
+#include "input/pipeline.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#define RECORD_PATH "test_input_deadzone.rec"
+#define RATE 200
+#define PERIOD_US (1000000 / RATE)
+#define SESSION_SECONDS 120
+
+// stick changes between two resting samples
+static uint32_t resting_changes;
+
+static void write_session(void) {
+  FILE *fd = input_record_open(RECORD_PATH, RATE);
+  CHECK(fd);
+  input_record_sample sample = {0};
+  sample.time_us = 1000000;
+  uint8_t old_axes[4] = {128, 128, 128, 128};
+  bool was_resting = false;
+  uint32_t seed = 7;
+
+  for (int i = 0; i < SESSION_SECONDS * RATE; i++) {
+    // five second rounds: rest, push the left stick, rest, circle the right
+    int t = i % (5 * RATE);
+    bool resting = t < 2 * RATE || (t >= 3 * RATE && t < 4 * RATE);
+    seed = seed * 1103515245 + 12345;
+    // where the thumbs settle drifts a little from round to round
+    int offset = (int) (i / (5 * RATE) % 7) - 3;
+    int noise_l = (int) ((seed >> 16) % 3) - 1;
+    int noise_r = (int) ((seed >> 20) % 3) - 1;
+    sample.lx = 128 + offset + noise_l;
+    sample.ly = 128 - offset / 2 + noise_r;
+    sample.rx = 128 + noise_r;
+    sample.ry = 128 - offset + noise_l;
+
+    if (t >= 2 * RATE && t < 3 * RATE) {
+      // up to the edge and back in half a second each
+      int step = t - 2 * RATE;
+      int x = step < RATE / 2 ? step * 255 / (RATE / 2) : (RATE - step) * 255 / (RATE / 2);
+      sample.lx = x > 255 ? 255 : x;
+    } else if (t >= 4 * RATE) {
+      double a = (t - 4 * RATE) * 2 * M_PI / RATE;
+      sample.rx = 128 + lround(127 * cos(a));
+      sample.ry = 128 + lround(127 * sin(a));
+    }
+    // a button now and then, pressed while resting
+    sample.buttons = t >= RATE / 2 && t < RATE / 2 + 20 ? INPUT_PAD_CROSS : 0;
+
+    uint8_t axes[4] = {sample.lx, sample.ly, sample.rx, sample.ry};
+    if (resting && was_resting && memcmp(axes, old_axes, sizeof(axes)) != 0) {
+      resting_changes++;
+    }
+    memcpy(old_axes, axes, sizeof(axes));
+    was_resting = resting;
+
+    CHECK(input_record_write(fd, &sample));
+    sample.time_us += PERIOD_US;
+  }
+  fclose(fd);
+}
+
+static short max_lx;
+
+static void count_controller(short buttons, unsigned char lt, unsigned char rt,
+                             short lx, short ly, short rx, short ry) {
+  if (lx > max_lx) {
+    max_lx = lx;
+  }
+}
+
+static void ignore_mouse_move(short dx, short dy) {
+}
+
+static void ignore_mouse_button(char action, int button) {
+}
+
+static void ignore_keyboard(short key, char action, char modifiers) {
+}
+
+static void ignore_scroll(signed char amount) {
+}
+
+static void ignore_pause(void) {
+}
+
+static const input_sink count_sink = {
+  .controller = count_controller,
+  .mouse_move = ignore_mouse_move,
+  .mouse_button = ignore_mouse_button,
+  .keyboard = ignore_keyboard,
+  .scroll = ignore_scroll,
+  .pause = ignore_pause,
+};
+
+static uint64_t clock_us(void) {
+  return host_time_us();
+}
+
+static uint32_t samples;
+
+static void replay(const char *path, input_pipeline *p, int deadzone) {
+  uint32_t rate;
+  FILE *fd = input_replay_open(path, &rate);
+  CHECK(fd);
+
+  input_settings settings = {0};
+  input_default_mapping(&settings.map, false);
+  settings.rate = rate;
+  settings.left_deadzone = deadzone;
+  settings.right_deadzone = deadzone;
+  settings.stick_curve = 100;
+  input_pipeline_config(p, &settings, &count_sink);
+
+  histogram cost;
+  histogram_init(&cost, "input replay sample", 10);
+  max_lx = 0;
+  samples = input_pipeline_replay(p, fd, &cost, clock_us);
+  fclose(fd);
+}
+
+int main(int argc, char **argv) {
+  const char *path = RECORD_PATH;
+  if (argc > 1) {
+    path = argv[1];
+  } else {
+    write_session();
+  }
+
+  static input_pipeline none, normal, wide;
+  replay(path, &none, 0);
+  replay(path, &normal, 5);
+  short normal_max_lx = max_lx;
+  replay(path, &wide, 10);
+
+  printf("%u samples, %u.%u seconds\n", samples, samples / RATE, samples % RATE * 10 / RATE);
+  printf("deadzone  events  suppressed  saved\n");
+  const input_pipeline *runs[] = {&none, &normal, &wide};
+  const int deadzones[] = {0, 5, 10};
+  for (int i = 0; i < 3; i++) {
+    uint32_t saved = none.controller_events - runs[i]->controller_events;
+    printf("%7d%%  %6u  %10u  %5u (%u%%)\n", deadzones[i], runs[i]->controller_events,
+           runs[i]->stick_suppressed, saved,
+           none.controller_events ? saved * 100 / none.controller_events : 0);
+  }
+
+  if (argc > 1) {
+    return 0;
+  }
+
+  printf("%u stick changes while resting\n", resting_changes);
+  // with the default deadzone a resting thumb sends nothing, a wider one
+  // never sends more
+  CHECK(normal.stick_suppressed >= resting_changes);
+  CHECK(none.controller_events - normal.controller_events >= resting_changes);
+  CHECK(wide.controller_events <= normal.controller_events);
+  // and pushing the stick all the way still gets to full scale, less the
+  // rounding of the gain table
+  printf("left stick pushed to %d\n", normal_max_lx);
+  CHECK(normal_max_lx >= SHRT_MAX - 256);
+
+  remove(RECORD_PATH);
+  return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The compiled controller mapping against the per-poll decoding it
+// replaced, in tests/ref, on random mappings, panel sections and samples.
+// Buttons, triggers, buttons mapped to analog outputs and the touched
+// sections have to match exactly. Stick axes went through the response
+// curve since, with no deadzone and a linear curve they may only differ
+// by the change of scale inside the stick's circle, and the reverse
+// flags the old code ignored.
+
+#include "host.h"
+#include "input/pipeline.h"
+#include "ref/input_mapping_ref.h"
+
+#include <Limelight.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAPPINGS 2000
+#define SAMPLES 500
+
+static uint32_t seed = 42;
+
+static uint32_t next_random(void) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+static const uint32_t pad_bits[] = {
+  INPUT_PAD_SELECT, INPUT_PAD_L3, INPUT_PAD_R3, INPUT_PAD_START, INPUT_PAD_UP, INPUT_PAD_RIGHT,
+  INPUT_PAD_DOWN, INPUT_PAD_LEFT, INPUT_PAD_L1, INPUT_PAD_R1, INPUT_PAD_TRIANGLE, INPUT_PAD_CIRCLE,
+  INPUT_PAD_CROSS, INPUT_PAD_SQUARE,
+};
+
+static uint32_t random_source(void) {
+  switch (next_random() % 8) {
+    case 0:
+      return 0;
+    case 1:
+    case 2:
+      return pad_bits[next_random() % 14] | INPUT_TYPE_GAMEPAD;
+    case 3:
+      // a few buttons at once
+      return (next_random() & 0xffff) | INPUT_TYPE_GAMEPAD;
+    case 4:
+      return (1 << next_random() % 8) | INPUT_TYPE_TOUCHSCREEN;
+    case 5:
+    case 6:
+      // the six axes and two that don't exist
+      return next_random() % 8 | INPUT_TYPE_ANALOG;
+    default:
+      // keys and mouse buttons don't reach the controller
+      return (next_random() % 4) | (next_random() % 2 ? INPUT_TYPE_KEYBOARD : INPUT_TYPE_MOUSE);
+  }
+}
+
+static uint32_t random_special(void) {
+  switch (next_random() % 3) {
+    case 0:
+      return 0;
+    case 1:
+      return pad_bits[next_random() % 14] | INPUT_TYPE_GAMEPAD;
+    default:
+      return (LEFT_TRIGGER + next_random() % 2) | INPUT_TYPE_ANALOG;
+  }
+}
+
+static void random_settings(input_settings *s) {
+  memset(s, 0, sizeof(input_settings));
+  struct mapping *map = &s->map;
+  if (next_random() % 4 == 0) {
+    input_default_mapping(map, next_random() % 2);
+  } else {
+    uint32_t *fields[] = {
+      &map->abs_x, &map->abs_y, &map->abs_rx, &map->abs_ry,
+      &map->btn_dpad_up, &map->btn_dpad_down, &map->btn_dpad_left, &map->btn_dpad_right,
+      &map->btn_south, &map->btn_east, &map->btn_north, &map->btn_west,
+      &map->btn_select, &map->btn_start, &map->btn_thumbl, &map->btn_thumbr,
+      &map->btn_tl, &map->btn_tr, &map->btn_tl2, &map->btn_tr2,
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(*fields); i++) {
+      *fields[i] = random_source();
+    }
+  }
+  map->reverse_x = next_random() % 2;
+  map->reverse_y = next_random() % 2;
+  map->reverse_rx = next_random() % 2;
+  map->reverse_ry = next_random() % 2;
+
+  s->rate = 200;
+  s->touch = true;
+  s->back_top = next_random() % 200;
+  s->back_bottom = next_random() % 200;
+  s->back_left = next_random() % 300;
+  s->back_right = next_random() % 300;
+  s->special_size = next_random() % 150;
+  s->special_offset = next_random() % 60;
+  s->special_nw = random_special();
+  s->special_ne = random_special();
+  s->special_sw = random_special();
+  s->special_se = random_special();
+  s->stick_curve = 100;
+}
+
+static void random_touches(input_record_touch *touches, uint8_t *count) {
+  *count = next_random() % 4 == 0 ? next_random() % (INPUT_RECORD_MAX_TOUCH + 1) : next_random() % 3;
+  for (int i = 0; i < *count; i++) {
+    touches[i].id = i;
+    // often close to a corner, where the sections are
+    bool corner = next_random() % 2;
+    int x = next_random() % 1920;
+    int y = next_random() % 1088;
+    touches[i].x = corner ? (x % 400) + (next_random() % 2 ? 0 : 1519) : x;
+    touches[i].y = corner ? (y % 300) + (next_random() % 2 ? 0 : 787) : y;
+  }
+}
+
+static void random_sample(input_record_sample *sample, uint64_t time_us) {
+  memset(sample, 0, sizeof(input_record_sample));
+  sample->time_us = time_us;
+  sample->buttons = next_random() & 0xffff;
+  uint8_t *axes[] = { &sample->lx, &sample->ly, &sample->rx, &sample->ry, &sample->lt, &sample->rt };
+  for (int i = 0; i < 6; i++) {
+    uint32_t r = next_random();
+    // the ends and the centre are where the scaling goes wrong
+    *axes[i] = r % 4 == 0 ? (r >> 4) % 2 * 255 : r % 4 == 1 ? 127 + (r >> 4) % 3 : r >> 4;
+  }
+  random_touches(sample->front, &sample->front_count);
+  random_touches(sample->back, &sample->back_count);
+}
+
+static bool is_stick(uint32_t defined) {
+  return (defined & INPUT_TYPE_MASK) == INPUT_TYPE_ANALOG && (defined & INPUT_VALUE_MASK) <= RIGHTY;
+}
+
+static uint8_t stick_axis(const input_record_sample *sample, uint32_t defined) {
+  switch (defined & INPUT_VALUE_MASK) {
+    case LEFTX:
+      return sample->lx;
+    case LEFTY:
+      return sample->ly;
+    case RIGHTX:
+      return sample->rx;
+    default:
+      return sample->ry;
+  }
+}
+
+static uint32_t sticks_compared;
+
+static void check_stick(const input_record_sample *sample, uint32_t x_defined, uint32_t y_defined,
+                        bool reverse_x, bool reverse_y, short x, short y, short ref_x, short ref_y) {
+  if (!is_stick(x_defined) || !is_stick(y_defined)) {
+    // both are read the old way
+    CHECK(x == ref_x && y == ref_y);
+    return;
+  }
+
+  int cx = stick_axis(sample, x_defined) - 128;
+  int cy = stick_axis(sample, y_defined) - 128;
+  if (cx * cx + cy * cy > 127 * 127) {
+    // outside the circle the response keeps the direction at full scale
+    CHECK(cx == 0 || (x > 0) == ((cx > 0) != reverse_x));
+    CHECK(cy == 0 || (y > 0) == ((cy > 0) != reverse_y));
+    return;
+  }
+
+  int expect_x = reverse_x ? -ref_x : ref_x;
+  int expect_y = reverse_y ? -ref_y : ref_y;
+  CHECK(abs(x - expect_x) <= 2 * abs(cx) + 128);
+  CHECK(abs(y - expect_y) <= 2 * abs(cy) + 128);
+  sticks_compared++;
+}
+
+static void ignore_controller(short buttons, unsigned char lt, unsigned char rt,
+                              short lx, short ly, short rx, short ry) {
+}
+
+static void ignore_mouse_move(short dx, short dy) {
+}
+
+static void ignore_mouse_button(char action, int button) {
+}
+
+static void ignore_keyboard(short key, char action, char modifiers) {
+}
+
+static void ignore_scroll(signed char amount) {
+}
+
+static void ignore_pause(void) {
+}
+
+static const input_sink null_sink = {
+  .controller = ignore_controller,
+  .mouse_move = ignore_mouse_move,
+  .mouse_button = ignore_mouse_button,
+  .keyboard = ignore_keyboard,
+  .scroll = ignore_scroll,
+  .pause = ignore_pause,
+};
+
+int main(int argc, char **argv) {
+  static input_pipeline p;
+  input_settings settings;
+  input_record_sample sample;
+  ref_input ref;
+  uint64_t time_us = 1000000;
+
+  for (int m = 0; m < MAPPINGS; m++) {
+    random_settings(&settings);
+    input_pipeline_config(&p, &settings, &null_sink);
+    ref_input_config(&settings);
+
+    for (int i = 0; i < SAMPLES; i++) {
+      random_sample(&sample, time_us);
+      time_us += 5000;
+      input_pipeline_process(&p, &sample);
+      ref_input_process(&sample, &ref);
+
+      CHECK(p.touch.button == ref.touch_button);
+      CHECK(p.curr.button == ref.button);
+      CHECK(p.curr.lt == ref.lt && p.curr.rt == ref.rt);
+      const struct mapping *map = &settings.map;
+      check_stick(&sample, map->abs_x, map->abs_y, map->reverse_x, map->reverse_y,
+                  p.curr.lx, p.curr.ly, ref.lx, ref.ly);
+      check_stick(&sample, map->abs_rx, map->abs_ry, map->reverse_rx, map->reverse_ry,
+                  p.curr.rx, p.curr.ry, ref.rx, ref.ry);
+    }
+  }
+
+  printf("%d mappings, %d samples each, %u stick pairs compared inside the circle\n",
+         MAPPINGS, SAMPLES, sticks_compared);
+  CHECK(sticks_compared > MAPPINGS * SAMPLES / 20);
+  return 0;
+}
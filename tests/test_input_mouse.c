@@ -0,0 +1,240 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Touch traces recorded and replayed through the input pipeline, summing
+// the mouse motion it sends. The motion the gesture recognizer reports,
+// scaled by the gain for its speed, has to come out in full: the sub-pixel
+// rest is carried from move to move, so each stroke loses less than a
+// pixel however slowly it moves. Moves also have to be coalesced to one
+// packet per send window.
+
+#include "host.h"
+#include "input/pipeline.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_PATH "test_input_mouse.rec"
+#define RATE 200
+#define PERIOD_US (1000000 / RATE)
+#define SEND_WINDOW_US 8000
+#define MAX_POINTS 2000
+
+typedef struct {
+  const char *name;
+  int count;
+  short x[MAX_POINTS];
+  short y[MAX_POINTS];
+} trace;
+
+static trace traces[4];
+
+static void make_traces(void) {
+  // a slow diagonal, a third of a pixel per sample
+  trace *t = &traces[0];
+  t->name = "slow diagonal";
+  t->count = 1200;
+  for (int i = 0; i < t->count; i++) {
+    t->x[i] = 200 + i / 3;
+    t->y[i] = 100 + i / 4;
+  }
+
+  // a fast flick to the left
+  t = &traces[1];
+  t->name = "fast flick";
+  t->count = 20;
+  for (int i = 0; i < t->count; i++) {
+    t->x[i] = 900 - i * i * 2;
+    t->y[i] = 300 + i;
+  }
+
+  // a slow circle
+  t = &traces[2];
+  t->name = "circle";
+  t->count = 800;
+  for (int i = 0; i < t->count; i++) {
+    t->x[i] = 480 + lround(150 * cos(i * 2 * M_PI / t->count));
+    t->y[i] = 272 + lround(150 * sin(i * 2 * M_PI / t->count));
+  }
+
+  // a shaky random walk
+  t = &traces[3];
+  t->name = "random walk";
+  t->count = 1500;
+  uint32_t seed = 5;
+  int x = 480, y = 272;
+  for (int i = 0; i < t->count; i++) {
+    seed = seed * 1103515245 + 12345;
+    x += (int) ((seed >> 16) % 7) - 3 + (i % 200 < 100);
+    y += (int) ((seed >> 8) % 5) - 2;
+    x = x < 30 ? 30 : x > 930 ? 930 : x;
+    y = y < 30 ? 30 : y > 514 ? 514 : y;
+    t->x[i] = x;
+    t->y[i] = y;
+  }
+}
+
+// touch panels report twice the screen resolution
+static void write_trace(FILE *fd, const trace *t, uint64_t *time_us) {
+  input_record_sample sample = {0};
+  sample.lx = sample.ly = sample.rx = sample.ry = 128;
+  sample.front_count = 1;
+  for (int i = 0; i < t->count; i++) {
+    sample.time_us = *time_us;
+    sample.front[0].id = 1;
+    sample.front[0].x = t->x[i] * 2;
+    sample.front[0].y = t->y[i] * 2;
+    CHECK(input_record_write(fd, &sample));
+    *time_us += PERIOD_US;
+  }
+
+  // lift and rest long enough for the next stroke not to be a drag
+  sample.front_count = 0;
+  for (int i = 0; i < 100; i++) {
+    sample.time_us = *time_us;
+    CHECK(input_record_write(fd, &sample));
+    *time_us += PERIOD_US;
+  }
+}
+
+// What the pipeline should send for a trace: the recognizer's motion
+// scaled by the gain table, with the rest dropped when the finger lifts
+static void expected_motion(const input_pipeline *p, const trace *t, int64_t *x, int64_t *y) {
+  gesture_recognizer g;
+  gesture_init(&g, &p->gestures.config);
+  int32_t sum_x = 0, sum_y = 0;
+  gesture_event events[GESTURE_MAX_EVENTS];
+  for (int i = 0; i <= t->count; i++) {
+    gesture_touch touch = { 1, i < t->count ? t->x[i] : 0, i < t->count ? t->y[i] : 0 };
+    int n = gesture_update(&g, (uint64_t) i * PERIOD_US, &touch, i < t->count, events);
+    for (int e = 0; e < n; e++) {
+      if (events[e].type != GESTURE_MOVE) {
+        continue;
+      }
+      int speed = abs(events[e].dx) > abs(events[e].dy) ? abs(events[e].dx) : abs(events[e].dy);
+      speed = speed * RATE / 200;
+      speed = speed < INPUT_MOUSE_GAIN_STEPS ? speed : INPUT_MOUSE_GAIN_STEPS - 1;
+      sum_x += events[e].dx * p->mouse_gain[speed];
+      sum_y += events[e].dy * p->mouse_gain[speed];
+    }
+  }
+  *x = sum_x >> 8;
+  *y = sum_y >> 8;
+}
+
+static int64_t sent_x, sent_y;
+static uint32_t packets;
+static uint64_t capture_us;
+static uint64_t packet_us[4 * MAX_POINTS];
+
+static void count_mouse_move(short dx, short dy) {
+  sent_x += dx;
+  sent_y += dy;
+  CHECK(packets < 4 * MAX_POINTS);
+  packet_us[packets++] = capture_us;
+}
+
+static void ignore_controller(short buttons, unsigned char lt, unsigned char rt,
+                              short lx, short ly, short rx, short ry) {
+}
+
+static void ignore_mouse_button(char action, int button) {
+}
+
+static void ignore_keyboard(short key, char action, char modifiers) {
+}
+
+static void ignore_scroll(signed char amount) {
+}
+
+static void ignore_pause(void) {
+}
+
+static const input_sink mouse_sink = {
+  .controller = ignore_controller,
+  .mouse_move = count_mouse_move,
+  .mouse_button = ignore_mouse_button,
+  .keyboard = ignore_keyboard,
+  .scroll = ignore_scroll,
+  .pause = ignore_pause,
+};
+
+static void run(const trace *t, int acceleration, int curve) {
+  uint64_t time_us = 1000000;
+  FILE *fd = input_record_open(RECORD_PATH, RATE);
+  CHECK(fd);
+  write_trace(fd, t, &time_us);
+  fclose(fd);
+
+  input_settings settings = {0};
+  input_default_mapping(&settings.map, false);
+  settings.rate = RATE;
+  settings.touch = true;
+  settings.mouse_acceleration = acceleration;
+  settings.mouse_curve = curve;
+
+  static input_pipeline p;
+  input_pipeline_config(&p, &settings, &mouse_sink);
+
+  uint32_t rate;
+  fd = input_replay_open(RECORD_PATH, &rate);
+  CHECK(fd && rate == RATE);
+  sent_x = sent_y = 0;
+  packets = 0;
+
+  // the capture clock stands in for the sample times
+  input_record_sample sample;
+  while (input_replay_read(fd, &sample)) {
+    capture_us = sample.time_us;
+    input_pipeline_process(&p, &sample);
+  }
+  fclose(fd);
+
+  int64_t x, y;
+  expected_motion(&p, t, &x, &y);
+  int travel_x = t->x[t->count - 1] - t->x[0];
+  int travel_y = t->y[t->count - 1] - t->y[0];
+  printf("%-12s accel %3d curve %3d: travel %5d %5d, sent %5lld %5lld in %4u packets, expected %5lld %5lld\n",
+         t->name, acceleration, curve, travel_x, travel_y,
+         (long long) sent_x, (long long) sent_y, packets, (long long) x, (long long) y);
+
+  CHECK(sent_x == x && sent_y == y);
+  // one packet per window, but the last of a stroke goes out on lift
+  CHECK(packets <= (uint64_t) t->count * PERIOD_US / SEND_WINDOW_US + 2);
+  for (uint32_t i = 1; i + 1 < packets; i++) {
+    CHECK(packet_us[i] - packet_us[i - 1] >= SEND_WINDOW_US);
+  }
+}
+
+int main(int argc, char **argv) {
+  make_traces();
+  for (size_t i = 0; i < sizeof(traces) / sizeof(*traces); i++) {
+    run(&traces[i], 0, 0);
+    run(&traces[i], 50, 0);
+    run(&traces[i], 0, 80);
+  }
+
+  // with a flat gain of one half, a slow stroke comes out at half its
+  // length, not rounded away move by move
+  run(&traces[0], 0, 0);
+  CHECK(llabs(sent_x - (traces[0].x[traces[0].count - 1] - traces[0].x[0]) / 2) <= 5);
+  CHECK(sent_x > 150);
+
+  remove(RECORD_PATH);
+  return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A recording made up of the usual kinds of input, replayed through the
+// input pipeline into the capture sink the way a replay on the Vita does.
+// Replays have to give the same events every time, leave a live pipeline
+// alone, and end with every held action released in the capture.
+
+#include "host.h"
+#include "input/pipeline.h"
+
+#include <Limelight.h>
+
+#include <string.h>
+
+#define RECORD_PATH "test_input_replay.rec"
+#define RATE 200
+#define PERIOD_US (1000000 / RATE)
+
+static input_record_sample sample;
+static FILE *record;
+
+// touch panels report twice the screen resolution
+static void touch(input_record_touch *t, uint8_t id, int x, int y) {
+  t->id = id;
+  t->x = x * 2;
+  t->y = y * 2;
+}
+
+static void write_samples(int count) {
+  for (int i = 0; i < count; i++) {
+    CHECK(input_record_write(record, &sample));
+    sample.time_us += PERIOD_US;
+  }
+}
+
+static void write_recording(void) {
+  record = input_record_open(RECORD_PATH, RATE);
+  CHECK(record);
+  memset(&sample, 0, sizeof(sample));
+  sample.time_us = 1000000;
+  sample.lx = sample.ly = sample.rx = sample.ry = 128;
+
+  // sticks resting with a little noise, then a button
+  uint32_t seed = 1;
+  for (int i = 0; i < 100; i++) {
+    seed = seed * 1103515245 + 12345;
+    sample.lx = 127 + (seed >> 16) % 3;
+    sample.ry = 127 + (seed >> 20) % 3;
+    write_samples(1);
+  }
+  sample.lx = sample.ry = 128;
+  sample.buttons = INPUT_PAD_CROSS;
+  write_samples(20);
+  sample.buttons = 0;
+  write_samples(20);
+
+  // the left stick pushed right and back
+  for (int x = 128; x < 256; x += 8) {
+    sample.lx = x;
+    write_samples(1);
+  }
+  sample.lx = 255;
+  write_samples(5);
+  sample.lx = 128;
+  write_samples(20);
+
+  // the north west quarter of the back panel is l2
+  sample.back_count = 1;
+  touch(&sample.back[0], 0, 100, 100);
+  write_samples(20);
+  sample.back_count = 0;
+  write_samples(20);
+
+  // the north west corner of the front panel pauses
+  sample.front_count = 1;
+  touch(&sample.front[0], 1, 10, 10);
+  write_samples(10);
+  sample.front_count = 0;
+  write_samples(20);
+
+  // a tap, then a drag after it
+  sample.front_count = 1;
+  touch(&sample.front[0], 2, 480, 272);
+  write_samples(3);
+  sample.front_count = 0;
+  write_samples(20);
+  sample.front_count = 1;
+  for (int i = 0; i < 50; i++) {
+    touch(&sample.front[0], 3, 300 + i * 4, 200 + i * 2);
+    write_samples(1);
+  }
+  sample.front_count = 0;
+  write_samples(100);
+
+  // two fingers scrolling
+  sample.front_count = 2;
+  for (int i = 0; i < 30; i++) {
+    touch(&sample.front[0], 4, 400, 100 + i * 6);
+    touch(&sample.front[1], 5, 500, 100 + i * 6);
+    write_samples(1);
+  }
+  sample.front_count = 0;
+  write_samples(100);
+
+  // the recording ends while the action of a tap is still held
+  sample.front_count = 1;
+  touch(&sample.front[0], 6, 480, 272);
+  write_samples(3);
+  sample.front_count = 0;
+  write_samples(2);
+
+  fclose(record);
+}
+
+static input_settings settings;
+
+static void init_settings(void) {
+  memset(&settings, 0, sizeof(settings));
+  input_default_mapping(&settings.map, false);
+  settings.rate = RATE;
+  settings.touch = true;
+  settings.special_size = 60;
+  settings.special_nw = INPUT_SPECIAL_KEY_PAUSE | INPUT_TYPE_SPECIAL;
+  settings.tap = BUTTON_LEFT | INPUT_TYPE_MOUSE;
+  settings.drag = BUTTON_LEFT | INPUT_TYPE_MOUSE;
+  settings.left_deadzone = 10;
+  settings.right_deadzone = 10;
+  settings.stick_curve = 100;
+}
+
+static uint64_t clock_us(void) {
+  return host_time_us();
+}
+
+static uint32_t replay_samples;
+
+// Replays the recording on p, returns the captured events
+static char *replay(input_pipeline *p, size_t *size) {
+  uint32_t rate;
+  FILE *fd = input_replay_open(RECORD_PATH, &rate);
+  CHECK(fd && rate == RATE);
+
+  char *events;
+  FILE *capture = open_memstream(&events, size);
+  CHECK(capture);
+
+  histogram cost;
+  histogram_init(&cost, "input replay sample", 10);
+  input_settings replay_settings = settings;
+  replay_settings.rate = rate;
+  input_pipeline_config(p, &replay_settings, &input_capture_sink);
+  input_capture_start(capture);
+  replay_samples = input_pipeline_replay(p, fd, &cost, clock_us);
+  fclose(capture);
+  fclose(fd);
+  histogram_log(&cost);
+  return events;
+}
+
+static uint32_t live_calls;
+
+static void live_controller(short buttons, unsigned char lt, unsigned char rt,
+                            short lx, short ly, short rx, short ry) {
+  live_calls++;
+}
+
+static void live_mouse_move(short dx, short dy) {
+  live_calls++;
+}
+
+static void live_mouse_button(char action, int button) {
+  live_calls++;
+}
+
+static void live_keyboard(short key, char action, char modifiers) {
+  live_calls++;
+}
+
+static void live_scroll(signed char amount) {
+  live_calls++;
+}
+
+static void live_pause(void) {
+  live_calls++;
+}
+
+static const input_sink live_sink = {
+  .controller = live_controller,
+  .mouse_move = live_mouse_move,
+  .mouse_button = live_mouse_button,
+  .keyboard = live_keyboard,
+  .scroll = live_scroll,
+  .pause = live_pause,
+};
+
+static int count_lines(const char *events, const char *what) {
+  int count = 0;
+  for (const char *p = strstr(events, what); p; p = strstr(p + 1, what)) {
+    count++;
+  }
+  return count;
+}
+
+int main(int argc, char **argv) {
+  write_recording();
+  init_settings();
+
+  // a live pipeline in the middle of a stream, holding a tap action
+  static input_pipeline live;
+  input_pipeline_config(&live, &settings, &live_sink);
+  input_record_sample tap = {0};
+  tap.time_us = 1000;
+  tap.lx = tap.ly = tap.rx = tap.ry = 200;
+  tap.front_count = 1;
+  touch(&tap.front[0], 0, 480, 272);
+  input_pipeline_process(&live, &tap);
+  tap.time_us += PERIOD_US;
+  tap.front_count = 0;
+  input_pipeline_process(&live, &tap);
+  uint32_t live_events = live.controller_events;
+  uint32_t calls = live_calls;
+  CHECK(live.gesture_held != 0);
+
+  static input_pipeline first, second;
+  size_t first_size, second_size;
+  char *first_events = replay(&first, &first_size);
+  char *second_events = replay(&second, &second_size);
+  printf("%u samples, %u controller events, %u stick jitter events suppressed, %zu bytes of events\n",
+         replay_samples, first.controller_events, first.stick_suppressed, first_size);
+
+  // the same events in the same order, down to the sample times
+  CHECK(first_size == second_size && memcmp(first_events, second_events, first_size) == 0);
+  CHECK(first.controller_events == second.controller_events);
+  CHECK(first.stick_suppressed == second.stick_suppressed);
+
+  // and the same again on a pipeline that replayed before
+  char *third_events = replay(&first, &second_size);
+  CHECK(first_size == second_size && memcmp(first_events, third_events, first_size) == 0);
+
+  // every part of the recording shows up
+  char line[64];
+  snprintf(line, sizeof(line), "controller %04x 0 0 0 0 0 0", A_FLAG);
+  CHECK(count_lines(first_events, line) == 1);
+  CHECK(count_lines(first_events, "controller 0000 255 0") == 1);
+  CHECK(count_lines(first_events, "controller 0000 0 0 327") == 1);
+  CHECK(count_lines(first_events, " pause") >= 1);
+  CHECK(count_lines(first_events, "mouse_move") > 10);
+  CHECK(count_lines(first_events, "scroll") > 5);
+  snprintf(line, sizeof(line), "mouse_button %d %d", BUTTON_ACTION_PRESS, BUTTON_LEFT);
+  int presses = count_lines(first_events, line);
+  snprintf(line, sizeof(line), "mouse_button %d %d", BUTTON_ACTION_RELEASE, BUTTON_LEFT);
+  int releases = count_lines(first_events, line);
+  // the tap, the drag and the last tap
+  CHECK(presses == 3 && releases == presses);
+  // the noise stays below the deadzone
+  CHECK(first.stick_suppressed > 50);
+
+  // the last tap is released into the capture at the end of the replay
+  size_t last = first_size - 1;
+  while (last > 0 && first_events[last - 1] != '\n') {
+    last--;
+  }
+  CHECK(strstr(first_events + last, line) != NULL);
+
+  // nothing reached the live pipeline or its sink
+  CHECK(live.controller_events == live_events);
+  CHECK(live_calls == calls);
+  CHECK(live.gesture_held != 0);
+
+  free(first_events);
+  free(second_events);
+  free(third_events);
+  remove(RECORD_PATH);
+  return 0;
+}
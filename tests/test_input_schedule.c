@@ -0,0 +1,145 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The input sample schedule, first on a few fixed cases and then driven
+// the way the input thread drives it through an hour of virtual time, with
+// a video frame clock, late wake-ups and the occasional stall. Reports
+// how old the newest sample is when a frame is captured, with and without
+// the alignment.
+
+#include "host.h"
+#include "input/schedule.h"
+
+#include <stdbool.h>
+
+#define LEAD_US 2000
+
+static void test_next_sample(void) {
+  // no frame clock, or an interval too short to lead, keeps the schedule
+  CHECK(input_next_sample(1000, 5000, 0, 16667, LEAD_US) == 5000);
+  CHECK(input_next_sample(1000, 5000, 900, 1500, LEAD_US) == 5000);
+
+  // the next frame is due at 20000, sample at 18000 if that comes first
+  CHECK(input_next_sample(10000, 25000, 3333, 16667, LEAD_US) == 18000);
+  CHECK(input_next_sample(10000, 15000, 3333, 16667, LEAD_US) == 15000);
+
+  // a frame clock from the past is carried forward to the next frame
+  CHECK(input_next_sample(18000, 40000, 3333, 16667, LEAD_US) == 34667);
+  CHECK(input_next_sample(100000, 120000, 3333, 16667, LEAD_US) == 101335);
+  // never a time that already passed
+  CHECK(input_next_sample(101335, 120000, 3333, 16667, LEAD_US) == 118002);
+}
+
+typedef struct {
+  const char *name;
+  uint32_t rate;
+  uint32_t interval_us;
+  bool align;
+} scenario;
+
+#define DURATION_US 3600000000ULL
+#define MAX_WAKE_US 500
+#define COST_US 50
+#define STALL_EVERY 100000
+#define STALL_US 40000
+
+static void run(const scenario *s) {
+  uint32_t period_us = 1000000 / s->rate;
+  uint64_t first_frame_us = 1234;
+  uint64_t now = 0;
+  uint64_t scheduled_us = 0;
+  uint64_t last_sample = 0;
+  uint64_t next_frame = first_frame_us;
+  uint32_t seed = 99;
+
+  uint64_t samples = 0, frames = 0, age_sum = 0;
+  uint32_t max_gap = 0, max_age = 0, stalls = 0;
+
+  while (now < DURATION_US) {
+    // the same steps as vitainput_thread
+    if (scheduled_us == 0 || now > scheduled_us + period_us) {
+      scheduled_us = now;
+    }
+    uint64_t frame_us = 0;
+    if (s->align && now >= first_frame_us) {
+      frame_us = first_frame_us + (now - first_frame_us) / s->interval_us * s->interval_us;
+    }
+    uint64_t deadline_us = input_next_sample(now, scheduled_us, frame_us, s->interval_us, LEAD_US);
+    CHECK(deadline_us >= now || deadline_us == scheduled_us);
+
+    seed = seed * 1103515245 + 12345;
+    uint64_t wake = (deadline_us > now ? deadline_us : now) + (seed >> 8) % MAX_WAKE_US;
+    if (samples % STALL_EVERY == STALL_EVERY - 1) {
+      wake += STALL_US;
+      stalls++;
+    }
+
+    // frames captured before this sample see the previous one
+    while (next_frame <= wake) {
+      if (last_sample) {
+        uint32_t age = next_frame - last_sample;
+        age_sum += age;
+        max_age = age > max_age ? age : max_age;
+        frames++;
+      }
+      next_frame += s->interval_us;
+    }
+
+    if (last_sample) {
+      uint32_t gap = wake - last_sample;
+      if (gap < STALL_US) {
+        max_gap = gap > max_gap ? gap : max_gap;
+      }
+    }
+    last_sample = wake;
+    samples++;
+    now = wake + COST_US;
+    scheduled_us = deadline_us + period_us;
+  }
+
+  printf("%-22s %8llu samples (%5.1f/s), gap max %5u us, sample age at frame avg %5llu max %5u us\n",
+         s->name, (unsigned long long) samples, samples * 1e6 / DURATION_US, max_gap,
+         (unsigned long long) (age_sum / frames), max_age);
+
+  // the rate holds, aligning adds at most one sample per frame
+  uint64_t expected = DURATION_US / period_us;
+  CHECK(samples > expected * 99 / 100);
+  CHECK(samples < expected * 101 / 100 + (s->align ? DURATION_US / s->interval_us : 0));
+  // never more than a period apart outside of stalls, plus a late wake-up
+  CHECK(max_gap <= period_us + MAX_WAKE_US + COST_US);
+  if (s->align) {
+    // every frame but the ones right after a stall sees a fresh sample
+    CHECK(age_sum / frames <= LEAD_US + MAX_WAKE_US);
+  }
+}
+
+int main(int argc, char **argv) {
+  test_next_sample();
+
+  static const scenario scenarios[] = {
+    {"200/s, 60 fps", 200, 16667, false},
+    {"200/s, 60 fps aligned", 200, 16667, true},
+    {"60/s, 60 fps", 60, 16667, false},
+    {"60/s, 60 fps aligned", 60, 16667, true},
+    {"120/s, 30 fps aligned", 120, 33333, true},
+    {"250/s, 120 fps aligned", 250, 8333, true},
+  };
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); i++) {
+    run(&scenarios[i]);
+  }
+  return 0;
+}
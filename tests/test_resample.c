@@ -0,0 +1,218 @@
+/*
+ * This file is part of Moonlight Embedded.
+ *
+ * Moonlight is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Moonlight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Moonlight; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The resampler in two parts. First the vectorized interpolation against
+// the scalar one on random input, positions and steps, including full
+// scale swings. Then a simulation of long sessions in virtual time: a host
+// whose clock runs off by up to 500 ppm sends 5 ms packets with arrival
+// jitter, the output side plays 256 frame blocks on the Vita clock. Once
+// settled, the buffered audio has to stay within half a target of the
+// target, with no underrun or overrun. The same session without drift
+// compensation is run for comparison.
+
+#include "host.h"
+#include "audio/resample.h"
+
+#include <string.h>
+
+#define SAMPLE_RATE 48000
+#define RING_FRAMES 16384
+#define PACKET_FRAMES 240
+#define OUTPUT_FRAMES 256
+#define LATENCY_FRAMES 960
+// one hour per session, the first minute to settle
+#define SESSION_US (3600ULL * 1000000)
+#define SETTLE_US (60ULL * 1000000)
+
+static uint32_t seed = 1;
+
+static uint32_t random32() {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+static void test_interpolate() {
+  static short input[2 * (RESAMPLE_MAX_FRAMES + 16)];
+  static short vector[2 * RESAMPLE_MAX_FRAMES];
+  static short scalar[2 * RESAMPLE_MAX_FRAMES];
+
+  for (int round = 0; round < 20000; round++) {
+    int kind = round % 4;
+    for (uint32_t i = 0; i < 2 * (RESAMPLE_MAX_FRAMES + 16); i++) {
+      if (kind == 0) {
+        // full scale swings give the largest differences
+        input[i] = random32() & 1 ? 32767 : -32768;
+      } else {
+        input[i] = random32();
+      }
+    }
+
+    uint32_t frames = 1 + random32() % RESAMPLE_MAX_FRAMES;
+    uint64_t pos = random32();
+    // anything from the drift range to a wide step
+    int64_t ppm = (int64_t) (random32() % 2001) - 1000;
+    if (kind == 3) {
+      ppm = (int64_t) (random32() % 20001) - 10000;
+    }
+    uint64_t step = (1LL << 32) + ppm * (1LL << 32) / 1000000;
+    if (kind == 2) {
+      step = 1ULL << 32;
+    }
+
+    memset(vector, 0x55, sizeof(vector));
+    uint64_t end_vector = audio_resample_interpolate(vector, input, pos, step, frames);
+    uint64_t end_scalar = audio_resample_interpolate_scalar(scalar, input, pos, step, frames);
+    CHECK(end_vector == end_scalar);
+    CHECK(memcmp(vector, scalar, frames * 2 * sizeof(short)) == 0);
+    // nothing past the block
+    CHECK(vector[2 * frames] == 0x5555 || frames == RESAMPLE_MAX_FRAMES);
+  }
+
+  // without drift the input comes out unchanged
+  for (uint32_t i = 0; i < 2 * (RESAMPLE_MAX_FRAMES + 16); i++) {
+    input[i] = random32();
+  }
+  audio_resample_interpolate(vector, input, 0, 1ULL << 32, RESAMPLE_MAX_FRAMES);
+  CHECK(memcmp(vector, input, RESAMPLE_MAX_FRAMES * 2 * sizeof(short)) == 0);
+}
+
+typedef struct {
+  uint32_t underruns;
+  uint32_t overruns;
+  uint32_t min_buffered;
+  uint32_t max_buffered;
+  uint32_t target;
+  int32_t drift_ppm;
+} session_stats;
+
+static short ring_data[2 * RING_FRAMES];
+static short packet_pcm[2 * PACKET_FRAMES];
+static short output[2 * OUTPUT_FRAMES];
+static audio_resampler resampler;
+
+// The host clock runs ppm faster than the Vita one. With compensate unset
+// the output plays the ring at the nominal rate.
+static void run_session(int32_t ppm, bool compensate, session_stats *stats) {
+  pcm_ring ring;
+  pcm_ring_init(&ring, ring_data, RING_FRAMES);
+  audio_resampler_reset(&resampler);
+  audio_jitter jitter = {0};
+  uint32_t target = LATENCY_FRAMES;
+  memset(stats, 0, sizeof(*stats));
+  stats->min_buffered = UINT32_MAX;
+
+  // in ns of the Vita clock
+  uint64_t packet_interval = PACKET_FRAMES * 1000000000ULL / SAMPLE_RATE * 1000000 / (1000000 + ppm);
+  uint64_t block_interval = OUTPUT_FRAMES * 1000000000ULL / SAMPLE_RATE;
+  uint64_t next_packet = 0, next_block = 0, last_arrival = 0;
+  uint64_t n = 0;
+
+  while (next_block < SESSION_US * 1000) {
+    if (next_packet <= next_block) {
+      // up to 3 ms late, never ahead of the previous packet
+      uint64_t arrival = n * packet_interval + random32() % 3000000;
+      if (arrival < last_arrival) {
+        arrival = last_arrival;
+      }
+      last_arrival = arrival;
+      n++;
+
+      audio_jitter_update(&jitter, arrival / 1000, PACKET_FRAMES * 1000000 / SAMPLE_RATE);
+      target = audio_target_frames(LATENCY_FRAMES, jitter.jitter_us * (SAMPLE_RATE / 1000) / 1000,
+                                   OUTPUT_FRAMES, RING_FRAMES - PACKET_FRAMES);
+      bool settled = arrival >= SETTLE_US * 1000;
+      if (pcm_ring_fill_producer(&ring) > 2 * target + OUTPUT_FRAMES ||
+          !pcm_ring_push(&ring, packet_pcm, PACKET_FRAMES)) {
+        stats->overruns += settled;
+      }
+      next_packet = n * packet_interval;
+      continue;
+    }
+
+    bool settled = next_block >= SETTLE_US * 1000;
+    // as seen by the output thread when it wakes up for the block
+    uint32_t buffered = pcm_ring_fill_consumer(&ring) + resampler.staged;
+    audio_block result;
+    if (compensate) {
+      result = audio_resampler_block(&resampler, &ring, target, output, OUTPUT_FRAMES);
+    } else if (resampler.prebuffering) {
+      result = pcm_ring_fill_consumer(&ring) < target ? AUDIO_BLOCK_PREBUFFERING : AUDIO_BLOCK_PLAYED;
+      resampler.prebuffering = result == AUDIO_BLOCK_PREBUFFERING;
+      if (result == AUDIO_BLOCK_PLAYED) {
+        pcm_ring_pop(&ring, output, OUTPUT_FRAMES);
+      }
+    } else if (pcm_ring_fill_consumer(&ring) < OUTPUT_FRAMES) {
+      result = AUDIO_BLOCK_UNDERRUN;
+      resampler.prebuffering = true;
+    } else {
+      result = AUDIO_BLOCK_PLAYED;
+      pcm_ring_pop(&ring, output, OUTPUT_FRAMES);
+    }
+
+    if (result == AUDIO_BLOCK_PREBUFFERING) {
+      // the output thread polls every millisecond
+      next_block += 1000000;
+      continue;
+    }
+    if (result == AUDIO_BLOCK_UNDERRUN) {
+      stats->underruns += settled;
+      continue;
+    }
+
+    if (settled) {
+      if (buffered < stats->min_buffered) {
+        stats->min_buffered = buffered;
+      }
+      if (buffered > stats->max_buffered) {
+        stats->max_buffered = buffered;
+      }
+    }
+    next_block += block_interval;
+  }
+
+  stats->target = target;
+  stats->drift_ppm = resampler.drift_ppm;
+}
+
+static void print_session(int32_t ppm, const char *mode, const session_stats *stats) {
+  printf("%+5d ppm %-12s underruns %5u, overruns %5u, buffered %6.1f to %6.1f ms, target %5.1f ms, correction %+5d ppm\n",
+         ppm, mode, stats->underruns, stats->overruns,
+         stats->min_buffered * 1000.0 / SAMPLE_RATE, stats->max_buffered * 1000.0 / SAMPLE_RATE,
+         stats->target * 1000.0 / SAMPLE_RATE, stats->drift_ppm);
+}
+
+int main(int argc, char **argv) {
+  test_interpolate();
+
+  static const int32_t drifts[] = {-500, -200, 0, 200, 500};
+  for (size_t i = 0; i < sizeof(drifts) / sizeof(*drifts); i++) {
+    session_stats fixed, compensated;
+    run_session(drifts[i], false, &fixed);
+    run_session(drifts[i], true, &compensated);
+    print_session(drifts[i], "fixed rate", &fixed);
+    print_session(drifts[i], "compensated", &compensated);
+
+    CHECK(compensated.underruns == 0 && compensated.overruns == 0);
+    // half a target off is the full correction, a packet more or less
+    // comes from where in the packet cycle the block falls
+    CHECK(compensated.min_buffered + compensated.target / 2 + PACKET_FRAMES >= compensated.target);
+    CHECK(compensated.max_buffered <= compensated.target + compensated.target / 2 + PACKET_FRAMES);
+  }
+  return 0;
+}
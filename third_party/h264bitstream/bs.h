@@ -155,7 +155,25 @@ static inline uint32_t bs_peek_u1(bs_t* b)
 }
 
 
-static inline uint32_t bs_read_u(bs_t* b, int n)
+// advance the position by n bits, n >= 0
+static inline void bs_advance(bs_t* b, int n)
+{
+    int total = (8 - b->bits_left) + n;
+    b->p += total >> 3;
+    b->bits_left = 8 - (total & 7);
+}
+
+// load 40 bits starting at the current byte, only valid with 5 bytes left
+static inline uint64_t bs_load_window(bs_t* b)
+{
+    return ((uint64_t)b->p[0] << 32) |
+           ((uint64_t)b->p[1] << 24) |
+           ((uint64_t)b->p[2] << 16) |
+           ((uint64_t)b->p[3] <<  8) |
+           ((uint64_t)b->p[4]);
+}
+
+static inline uint32_t bs_read_u_slow(bs_t* b, int n)
 {
     uint32_t r = 0;
     int i;
@@ -166,12 +184,25 @@ static inline uint32_t bs_read_u(bs_t* b, int n)
     return r;
 }
 
+static inline uint32_t bs_read_u(bs_t* b, int n)
+{
+    // the 40 bit window always holds at least 33 unread bits; near the end of
+    // the buffer fall back to single bits so reads past the end behave as before
+    if (n <= 0 || n > 32 || b->end - b->p < 5)
+    {
+        return bs_read_u_slow(b, n);
+    }
+
+    uint64_t w = bs_load_window(b) << (24 + 8 - b->bits_left);
+    bs_advance(b, n);
+    return (uint32_t)(w >> (64 - n));
+}
+
 static inline void bs_skip_u(bs_t* b, int n)
 {
-    int i;
-    for ( i = 0; i < n; i++ )
+    if (n > 0)
     {
-        bs_skip_u1( b );
+        bs_advance(b, n);
     }
 }
 
@@ -195,6 +226,20 @@ static inline uint32_t bs_read_ue(bs_t* b)
     int32_t r = 0;
     int i = 0;
 
+    if (b->end - b->p >= 5)
+    {
+        // count the leading zeros of the next 32 bits in one go
+        uint32_t w = (uint32_t)((bs_load_window(b) << (24 + 8 - b->bits_left)) >> 32);
+        if (w != 0)
+        {
+            i = __builtin_clz(w);
+            bs_advance(b, i + 1);
+            r = bs_read_u(b, i);
+            r += (1 << i) - 1;
+            return r;
+        }
+    }
+
     while( (bs_read_u1(b) == 0) && (i < 32) && (!bs_eof(b)) )
     {
         i++;
@@ -237,10 +282,22 @@ static inline void bs_write_u1(bs_t* b, uint32_t v)
 
 static inline void bs_write_u(bs_t* b, int n, uint32_t v)
 {
-    int i;
-    for (i = 0; i < n; i++)
+    // write as many bits as fit in the current byte at a time
+    while (n > 0)
     {
-        bs_write_u1(b, (v >> ( n - i - 1 ))&0x01 );
+        int k = (n < b->bits_left) ? n : b->bits_left;
+        int shift = b->bits_left - k;
+        uint32_t mask = (1u << k) - 1;
+        uint32_t bits = (uint32_t)(((uint64_t)v >> (n - k)) & mask);
+
+        if (! bs_eof(b))
+        {
+            (*(b->p)) = ((*(b->p)) & ~(mask << shift)) | (bits << shift);
+        }
+
+        n -= k;
+        b->bits_left -= k;
+        if (b->bits_left == 0) { b->p ++; b->bits_left = 8; }
     }
 }
 
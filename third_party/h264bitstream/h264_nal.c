@@ -23,6 +23,15 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "bs.h"
 #include "h264_stream.h"
@@ -77,9 +86,61 @@ void h264_free(h264_stream_t* h)
         free(h->seis);
     }
     free(h->sh);
+    if (h->slice_data != NULL)
+    {
+        free(h->slice_data->rbsp_buf);
+        free(h->slice_data);
+    }
     free(h);
 }
 
+/**
+ Find the first zero byte in a buffer range.
+ Every start code and emulation prevention sequence begins with a zero byte, so the scanners
+ below use this to skip whole blocks of payload that cannot contain one.
+ @param[in]   buf        the buffer
+ @param[in]   start      the first offset to check
+ @param[in]   end        one past the last offset to check
+ @return                 the offset of the first zero byte, or end (or start, if start >= end) if there is none
+ */
+static int find_zero_byte(const uint8_t* buf, int start, int end)
+{
+    int i = start;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    for ( ; i + 16 <= end; i += 16)
+    {
+        uint64x2_t eq = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(buf + i), zero));
+        if ((vgetq_lane_u64(eq, 0) | vgetq_lane_u64(eq, 1)) != 0) { break; }
+    }
+#elif defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for ( ; i + 32 <= end; i += 32)
+    {
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buf + i)), zero));
+        if (mask != 0) { return i + __builtin_ctz(mask); }
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for ( ; i + 16 <= end; i += 16)
+    {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buf + i)), zero));
+        if (mask != 0) { return i + __builtin_ctz(mask); }
+    }
+#else
+    for ( ; i + 4 <= end; i += 4)
+    {
+        uint32_t v;
+        memcpy(&v, buf + i, 4);
+        if (((v - 0x01010101u) & ~v & 0x80808080u) != 0) { break; }
+    }
+#endif
+
+    while (i < end && buf[i] != 0) { i++; }
+    return i;
+}
+
 /**
  Find the beginning and end of a NAL (Network Abstraction Layer) unit in a byte buffer containing H264 bitstream data.
  @param[in]   buf        the buffer
@@ -102,7 +163,7 @@ int find_nal_unit(uint8_t* buf, int size, int* nal_start, int* nal_end)
         (buf[i] != 0 || buf[i+1] != 0 || buf[i+2] != 0 || buf[i+3] != 0x01)
         )
     {
-        i++; // skip leading zero
+        i = find_zero_byte(buf, i+1, size-4); // skip leading zero and any bytes that cannot start a start code
         if (i+4 >= size) { return 0; } // did not find nal start
     }
 
@@ -120,7 +181,7 @@ int find_nal_unit(uint8_t* buf, int size, int* nal_start, int* nal_end)
         (buf[i] != 0 || buf[i+1] != 0 || buf[i+2] != 0x01)
         )
     {
-        i++;
+        i = find_zero_byte(buf, i+1, size-3); // only a zero byte can begin the next start code
         // FIXME the next line fails when reading a nal that ends exactly at the end of the data
         if (i+3 >= size) { *nal_end = size; return -1; } // did not find nal end, stream ended first
     }
@@ -151,6 +212,17 @@ int rbsp_to_nal(const uint8_t* rbsp_buf, const int* rbsp_size, uint8_t* nal_buf,
 
     for ( i = 0; i < *rbsp_size ; i++ )
     {
+        if ( count == 0 )
+        {
+            // copy the run up to the next zero byte in one go, nothing in it needs escaping
+            int run = find_zero_byte(rbsp_buf, i, *rbsp_size) - i;
+            if ( j + run > *nal_size ) { return -1; } // error, not enough space
+            memcpy(nal_buf + j, rbsp_buf + i, run);
+            i += run;
+            j += run;
+            if ( i >= *rbsp_size ) { break; }
+        }
+
         if ( j >= *nal_size )
         {
             // error, not enough space
@@ -200,6 +272,17 @@ int nal_to_rbsp(const uint8_t* nal_buf, int* nal_size, uint8_t* rbsp_buf, int* r
 
     for( i = 0; i < *nal_size; i++ )
     {
+        if ( count == 0 )
+        {
+            // copy the run up to the next zero byte in one go, emulation prevention only follows two zeros
+            int run = find_zero_byte(nal_buf, i, *nal_size) - i;
+            if ( j + run > *rbsp_size ) { return -1; } // error, not enough space
+            memcpy(rbsp_buf + j, nal_buf + i, run);
+            i += run;
+            j += run;
+            if ( i >= *nal_size ) { break; }
+        }
+
         // in NAL unit, 0x000000, 0x000001 or 0x000002 shall not occur at any byte-aligned position
         if( ( count == 2 ) && ( nal_buf[i] < 0x03) )
         {
@@ -256,14 +339,13 @@ int peek_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
 {
     nal_t* nal = h->nal;
 
-    bs_t* b = bs_new(buf, size);
+    bs_t bs;
+    bs_t* b = bs_init(&bs, buf, size);
 
     nal->forbidden_zero_bit = bs_read_f(b,1);
     nal->nal_ref_idc = bs_read_u(b,2);
     nal->nal_unit_type = bs_read_u(b,5);
 
-    bs_free(b);
-
     // basic verification, per 7.4.1
     if ( nal->forbidden_zero_bit ) { return -1; }
     if ( nal->nal_unit_type <= 0 || nal->nal_unit_type > 20 ) { return -1; }
@@ -150,18 +150,34 @@ void read_dec_ref_pic_marking(h264_stream_t* h, bs_t* b);
 
 //7.3.1 NAL unit syntax
 int read_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
+{
+    uint8_t* rbsp_buf = (uint8_t*)calloc(1, size);
+    int rc = read_nal_unit_buf(h, buf, size, rbsp_buf, size);
+    free(rbsp_buf);
+    return rc;
+}
+
+/**
+ Read a NAL unit using a caller-supplied RBSP scratch buffer instead of a heap allocation.
+ @param[in]      rbsp_buf       scratch space for the unescaped payload
+ @param[in]      rbsp_buf_size  size of rbsp_buf, must be at least size
+ @return                        the length of the nal, or -1 on error
+ */
+int read_nal_unit_buf(h264_stream_t* h, uint8_t* buf, int size, uint8_t* rbsp_buf, int rbsp_buf_size)
 {
     nal_t* nal = h->nal;
 
     int nal_size = size;
     int rbsp_size = size;
-    uint8_t* rbsp_buf = (uint8_t*)calloc(1, rbsp_size);
+    bs_t bs;
+
+    if (rbsp_buf_size < size) { return -1; }
 
     if( 1 )
     {
     int rc = nal_to_rbsp(buf, &nal_size, rbsp_buf, &rbsp_size);
 
-    if (rc < 0) { free(rbsp_buf); return -1; } // handle conversion error
+    if (rc < 0) { return -1; } // handle conversion error
     }
 
     if( 0 )
@@ -169,7 +185,7 @@ int read_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
     rbsp_size = size*3/4; // NOTE this may have to be slightly smaller (3/4 smaller, worst case) in order to be guaranteed to fit
     }
 
-    bs_t* b = bs_new(rbsp_buf, rbsp_size);
+    bs_t* b = bs_init(&bs, rbsp_buf, rbsp_size);
     /* forbidden_zero_bit */ bs_skip_u(b, 1);
     nal->nal_ref_idc = bs_read_u(b, 2);
     nal->nal_unit_type = bs_read_u(b, 5);
@@ -218,7 +234,7 @@ int read_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
             return -1;
     }
 
-    if (bs_overrun(b)) { bs_free(b); free(rbsp_buf); return -1; }
+    if (bs_overrun(b)) { return -1; }
 
     if( 0 )
     {
@@ -226,12 +242,9 @@ int read_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
     rbsp_size = bs_pos(b);
 
     int rc = rbsp_to_nal(rbsp_buf, &rbsp_size, buf, &nal_size);
-    if (rc < 0) { bs_free(b); free(rbsp_buf); return -1; }
+    if (rc < 0) { return -1; }
     }
 
-    bs_free(b);
-    free(rbsp_buf);
-
     return nal_size;
 }
 
@@ -678,11 +691,16 @@ void read_slice_layer_rbsp(h264_stream_t* h,  bs_t* b)
 
     if ( slice_data != NULL )
     {
-        if ( slice_data->rbsp_buf != NULL ) free( slice_data->rbsp_buf );
         uint8_t *sptr = b->p + (!!b->bits_left); // CABAC-specific: skip alignment bits, if there are any
         slice_data->rbsp_size = b->end - sptr;
 
-        slice_data->rbsp_buf = (uint8_t*)malloc(slice_data->rbsp_size);
+        // keep the previous buffer when it is large enough
+        if ( slice_data->rbsp_size > slice_data->rbsp_capacity )
+        {
+            free( slice_data->rbsp_buf );
+            slice_data->rbsp_buf = (uint8_t*)malloc(slice_data->rbsp_size);
+            slice_data->rbsp_capacity = slice_data->rbsp_size;
+        }
         memcpy( slice_data->rbsp_buf, sptr, slice_data->rbsp_size );
         // ugly hack: since next NALU starts at byte border, we are going to be padded by trailing_bits;
         return;
@@ -1037,18 +1055,32 @@ void write_dec_ref_pic_marking(h264_stream_t* h, bs_t* b);
 
 //7.3.1 NAL unit syntax
 int write_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
+{
+    uint8_t* rbsp_buf = (uint8_t*)calloc(1, size);
+    int rc = write_nal_unit_buf(h, buf, size, rbsp_buf, size);
+    free(rbsp_buf);
+    return rc;
+}
+
+/**
+ Write a NAL unit using a caller-supplied RBSP scratch buffer instead of a heap allocation.
+ @param[in]      rbsp_buf       scratch space for the payload before escaping
+ @param[in]      rbsp_buf_size  size of rbsp_buf, must be at least size*3/4
+ @return                        the length of the nal, or -1 on error
+ */
+int write_nal_unit_buf(h264_stream_t* h, uint8_t* buf, int size, uint8_t* rbsp_buf, int rbsp_buf_size)
 {
     nal_t* nal = h->nal;
 
     int nal_size = size;
     int rbsp_size = size;
-    uint8_t* rbsp_buf = (uint8_t*)calloc(1, rbsp_size);
+    bs_t bs;
 
     if( 0 )
     {
     int rc = nal_to_rbsp(buf, &nal_size, rbsp_buf, &rbsp_size);
 
-    if (rc < 0) { free(rbsp_buf); return -1; } // handle conversion error
+    if (rc < 0) { return -1; } // handle conversion error
     }
 
     if( 1 )
@@ -1056,7 +1088,9 @@ int write_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
     rbsp_size = size*3/4; // NOTE this may have to be slightly smaller (3/4 smaller, worst case) in order to be guaranteed to fit
     }
 
-    bs_t* b = bs_new(rbsp_buf, rbsp_size);
+    if (rbsp_buf_size < rbsp_size) { return -1; }
+
+    bs_t* b = bs_init(&bs, rbsp_buf, rbsp_size);
     /* forbidden_zero_bit */ bs_write_u(b, 1, 0);
     bs_write_u(b, 2, nal->nal_ref_idc);
     bs_write_u(b, 5, nal->nal_unit_type);
@@ -1105,7 +1139,7 @@ int write_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
             return -1;
     }
 
-    if (bs_overrun(b)) { bs_free(b); free(rbsp_buf); return -1; }
+    if (bs_overrun(b)) { return -1; }
 
     if( 1 )
     {
@@ -1113,12 +1147,9 @@ int write_nal_unit(h264_stream_t* h, uint8_t* buf, int size)
     rbsp_size = bs_pos(b);
 
     int rc = rbsp_to_nal(rbsp_buf, &rbsp_size, buf, &nal_size);
-    if (rc < 0) { bs_free(b); free(rbsp_buf); return -1; }
+    if (rc < 0) { return -1; }
     }
 
-    bs_free(b);
-    free(rbsp_buf);
-
     return nal_size;
 }
 
@@ -1565,11 +1596,16 @@ void write_slice_layer_rbsp(h264_stream_t* h,  bs_t* b)
 
     if ( slice_data != NULL )
     {
-        if ( slice_data->rbsp_buf != NULL ) free( slice_data->rbsp_buf );
         uint8_t *sptr = b->p + (!!b->bits_left); // CABAC-specific: skip alignment bits, if there are any
         slice_data->rbsp_size = b->end - sptr;
 
-        slice_data->rbsp_buf = (uint8_t*)malloc(slice_data->rbsp_size);
+        // keep the previous buffer when it is large enough
+        if ( slice_data->rbsp_size > slice_data->rbsp_capacity )
+        {
+            free( slice_data->rbsp_buf );
+            slice_data->rbsp_buf = (uint8_t*)malloc(slice_data->rbsp_size);
+            slice_data->rbsp_capacity = slice_data->rbsp_size;
+        }
         memcpy( slice_data->rbsp_buf, sptr, slice_data->rbsp_size );
         // ugly hack: since next NALU starts at byte border, we are going to be padded by trailing_bits;
         return;
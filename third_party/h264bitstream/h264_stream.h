@@ -347,6 +347,7 @@ typedef struct
 typedef struct
 {
   int rbsp_size;
+  int rbsp_capacity;
   uint8_t* rbsp_buf;
 } slice_data_rbsp_t;
 
@@ -383,6 +384,7 @@ int rbsp_to_nal(const uint8_t* rbsp_buf, const int* rbsp_size, uint8_t* nal_buf,
 int nal_to_rbsp(const uint8_t* nal_buf, int* nal_size, uint8_t* rbsp_buf, int* rbsp_size);
 
 int read_nal_unit(h264_stream_t* h, uint8_t* buf, int size);
+int read_nal_unit_buf(h264_stream_t* h, uint8_t* buf, int size, uint8_t* rbsp_buf, int rbsp_buf_size);
 int peek_nal_unit(h264_stream_t* h, uint8_t* buf, int size);
 
 void read_seq_parameter_set_rbsp(h264_stream_t* h, bs_t* b);
@@ -410,6 +412,7 @@ void read_dec_ref_pic_marking(h264_stream_t* h, bs_t* b);
 int more_rbsp_trailing_data(h264_stream_t* h, bs_t* b);
 
 int write_nal_unit(h264_stream_t* h, uint8_t* buf, int size);
+int write_nal_unit_buf(h264_stream_t* h, uint8_t* buf, int size, uint8_t* rbsp_buf, int rbsp_buf_size);
 
 void write_seq_parameter_set_rbsp(h264_stream_t* h, bs_t* b);
 void write_scaling_list(bs_t* b, int* scalingList, int sizeOfScalingList, int* useDefaultScalingMatrixFlag );